@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/* Benchmark:
+   Latency of wtmpdb_get_id depending on the size of the database.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wtmpdb.h"
+#include "bench.h"
+
+#define CALLS 200
+
+int
+main (void)
+{
+  static const int64_t sizes[] = {1000, 10000, 100000};
+  const char *db_path = "bench-get-id.db";
+  char *error = NULL;
+
+  bench_begin ("get_id");
+
+  for (size_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+    {
+      uint64_t step = 60 * USEC_PER_SEC;
+      struct timespec start;
+      double seconds;
+
+      if (bench_fill (db_path, sizes[i], bench_now () - sizes[i] * step,
+		      step) < 0)
+	return 1;
+      if (wtmpdb_login (db_path, USER_PROCESS, "wtmpdb-bench", bench_now (),
+			"pts/bench", "localhost", "bench", &error) < 0)
+	{
+	  fprintf (stderr, "wtmpdb_login: %s\n", error ? error : "failed");
+	  free (error);
+	  return 1;
+	}
+
+      /* the first call reads the file into the page cache */
+      for (int j = -1; j < CALLS; j++)
+	{
+	  if (j == 0)
+	    clock_gettime (CLOCK_MONOTONIC, &start);
+	  if (wtmpdb_get_id (db_path, "pts/bench", &error) < 0)
+	    {
+	      fprintf (stderr, "wtmpdb_get_id: %s\n",
+		       error ? error : "failed");
+	      free (error);
+	      return 1;
+	    }
+	}
+      seconds = bench_elapsed (&start);
+      bench_result ("\"name\":\"get_id\",\"rows\":%" PRId64 ",\"calls\":%d,"
+		    "\"seconds\":%.6f,\"usec_per_call\":%.1f",
+		    sizes[i], CALLS, seconds, seconds * 1e6 / CALLS);
+    }
+
+  bench_end ();
+  remove (db_path);
+
+  return 0;
+}
@@ -0,0 +1,164 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/* Benchmark:
+   Records per second "wtmpdb import" reads from a legacy wtmp file.
+   The path of the wtmpdb binary is the only argument.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <utmp.h>
+
+enum utmp_type {
+  UTMP_BOOT_TIME = BOOT_TIME,
+  UTMP_USER_PROCESS = USER_PROCESS,
+  UTMP_DEAD_PROCESS = DEAD_PROCESS,
+};
+
+#undef EMPTY
+#undef RUN_LVL
+#undef BOOT_TIME
+#undef USER_PROCESS
+
+#include "wtmpdb.h"
+#include "bench.h"
+
+#define SESSIONS 500
+
+static void
+set_record (struct utmp *u, short type, pid_t pid, const char *user,
+	    const char *line, uint64_t usec)
+{
+  memset (u, 0, sizeof (*u));
+  u->ut_type = type;
+  u->ut_pid = pid;
+  strncpy (u->ut_user, user, sizeof (u->ut_user));
+  strncpy (u->ut_line, line, sizeof (u->ut_line));
+  strncpy (u->ut_host, "192.168.0.1", sizeof (u->ut_host));
+  u->ut_tv.tv_sec = usec / USEC_PER_SEC;
+  u->ut_tv.tv_usec = usec % USEC_PER_SEC;
+}
+
+/* Writes a boot record and SESSIONS logins and logouts.
+   Returns the number of records, -1 on failure. */
+static int
+write_wtmp (const char *path)
+{
+  uint64_t usec = bench_now () - 2 * SESSIONS * 60 * USEC_PER_SEC;
+  struct utmp u;
+  int records = 0;
+  FILE *fp;
+
+  if ((fp = fopen (path, "w")) == NULL)
+    return -1;
+
+  set_record (&u, UTMP_BOOT_TIME, 0, "reboot", "~", usec);
+  strncpy (u.ut_id, "~~", sizeof (u.ut_id));
+  fwrite (&u, sizeof (u), 1, fp);
+  records++;
+
+  for (int i = 0; i < SESSIONS; i++)
+    {
+      char line[UT_LINESIZE];
+
+      snprintf (line, sizeof (line), "pts/%d", i % 20);
+      usec += 60 * USEC_PER_SEC;
+      set_record (&u, UTMP_USER_PROCESS, 1000 + i, "user", line, usec);
+      fwrite (&u, sizeof (u), 1, fp);
+      set_record (&u, UTMP_DEAD_PROCESS, 1000 + i, "", line,
+		  usec + 30 * USEC_PER_SEC);
+      fwrite (&u, sizeof (u), 1, fp);
+      records += 2;
+    }
+
+  if (fclose (fp) != 0)
+    return -1;
+  return records;
+}
+
+int
+main (int argc, char **argv)
+{
+  const char *wtmp_path = "bench-import.wtmp";
+  const char *db_path = "bench-import.db";
+  struct timespec start;
+  double seconds;
+  int records;
+  int status;
+  pid_t pid;
+
+  if (argc < 2)
+    {
+      fprintf (stderr, "Usage: %s /path/to/wtmpdb\n", argv[0]);
+      return 1;
+    }
+
+  if ((records = write_wtmp (wtmp_path)) < 0)
+    {
+      fprintf (stderr, "Cannot write %s: %s\n", wtmp_path, strerror (errno));
+      return 1;
+    }
+  remove (db_path);
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  pid = fork ();
+  if (pid < 0)
+    {
+      perror ("fork");
+      return 1;
+    }
+  if (pid == 0)
+    {
+      execl (argv[1], argv[1], "import", "-f", db_path, wtmp_path,
+	     (char *) NULL);
+      _exit (127);
+    }
+  if (waitpid (pid, &status, 0) != pid || !WIFEXITED (status) ||
+      WEXITSTATUS (status) != 0)
+    {
+      fprintf (stderr, "%s import failed\n", argv[1]);
+      return 1;
+    }
+  seconds = bench_elapsed (&start);
+
+  bench_begin ("import");
+  bench_result ("\"name\":\"import\",\"records\":%d,"
+		"\"seconds\":%.6f,\"records_per_sec\":%.1f",
+		records, seconds, records / seconds);
+  bench_end ();
+
+  remove (wtmp_path);
+  remove (db_path);
+
+  return 0;
+}
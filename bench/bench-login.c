@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/* Benchmark:
+   wtmpdb_login and wtmpdb_logout operations per second, writing
+   directly into a database file or, with "varlink" as argument,
+   through wtmpdbd into the system database.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "wtmpdb.h"
+#include "bench.h"
+
+#define OPS 500
+
+int
+main (int argc, char **argv)
+{
+  const char *db_path = argc > 1 ? argv[1] : "bench-login.db";
+  const char *backend = strcmp (db_path, "varlink") == 0 ? "wtmpdbd" : "sqlite";
+  static int64_t ids[OPS];
+  struct timespec start;
+  char *error = NULL;
+  double seconds;
+
+  if (strcmp (backend, "wtmpdbd") == 0 && getuid () != 0)
+    return 77;
+  if (strcmp (backend, "sqlite") == 0)
+    remove (db_path);
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < OPS; i++)
+    if ((ids[i] = wtmpdb_login (db_path, USER_PROCESS, "wtmpdb-bench",
+				bench_now (), "pts/bench", "localhost",
+				"bench", &error)) < 0)
+      {
+	fprintf (stderr, "wtmpdb_login: %s\n", error ? error : "failed");
+	free (error);
+	if (ids[i] == -ECONNREFUSED || ids[i] == -ENOENT ||
+	    ids[i] == -EACCES || ids[i] == -EPROTONOSUPPORT)
+	  return 77;
+	return 1;
+      }
+  seconds = bench_elapsed (&start);
+  bench_begin ("login");
+  bench_result ("\"name\":\"login\",\"backend\":\"%s\",\"ops\":%d,"
+		"\"seconds\":%.6f,\"ops_per_sec\":%.1f",
+		backend, OPS, seconds, OPS / seconds);
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < OPS; i++)
+    if (wtmpdb_logout (db_path, ids[i], bench_now (), &error) < 0)
+      {
+	fprintf (stderr, "wtmpdb_logout: %s\n", error ? error : "failed");
+	free (error);
+	return 1;
+      }
+  seconds = bench_elapsed (&start);
+  bench_result ("\"name\":\"logout\",\"backend\":\"%s\",\"ops\":%d,"
+		"\"seconds\":%.6f,\"ops_per_sec\":%.1f",
+		backend, OPS, seconds, OPS / seconds);
+
+  bench_end ();
+
+  if (strcmp (backend, "sqlite") == 0)
+    remove (db_path);
+
+  return 0;
+}
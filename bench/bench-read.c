@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/* Benchmark:
+   Rows per second wtmpdb_read_all_v2 delivers to the callback.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "basics.h"
+
+#include "wtmpdb.h"
+#include "bench.h"
+
+#define ROWS 100000
+#define RUNS 5
+
+static int
+count_row (void *userdata, int _unused_(argc), char **_unused_(argv),
+	   char **_unused_(azColName))
+{
+  (*(int64_t *) userdata)++;
+  return 0;
+}
+
+int
+main (void)
+{
+  const char *db_path = "bench-read.db";
+  uint64_t step = 60 * USEC_PER_SEC;
+  struct timespec start;
+  char *error = NULL;
+  int64_t rows = 0;
+  double seconds;
+
+  if (bench_fill (db_path, ROWS, bench_now () - ROWS * step, step) < 0)
+    return 1;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < RUNS; i++)
+    if (wtmpdb_read_all_v2 (db_path, count_row, &rows, &error) != 0)
+      {
+	fprintf (stderr, "wtmpdb_read_all_v2: %s\n", error ? error : "failed");
+	free (error);
+	return 1;
+      }
+  seconds = bench_elapsed (&start);
+
+  bench_begin ("read_all");
+  bench_result ("\"name\":\"read_all_v2\",\"rows\":%" PRId64 ",\"runs\":%d,"
+		"\"seconds\":%.6f,\"rows_per_sec\":%.1f",
+		rows / RUNS, RUNS, seconds, rows / seconds);
+  bench_end ();
+
+  remove (db_path);
+
+  return 0;
+}
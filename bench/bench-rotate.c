@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/* Benchmark:
+   Entries per second wtmpdb_rotate_v2 moves into the backup file.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wtmpdb.h"
+#include "bench.h"
+
+#define ROWS 50000
+
+int
+main (void)
+{
+  const char *db_path = "bench-rotate.db";
+  uint64_t step = 60 * USEC_PER_SEC;
+  struct timespec start;
+  char *backup = NULL;
+  char *error = NULL;
+  uint64_t entries = 0;
+  double seconds;
+
+  /* all entries are older than 60 days */
+  if (bench_fill (db_path, ROWS, bench_now () - 100ULL * 86400 * USEC_PER_SEC,
+		  step) < 0)
+    return 1;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  if (wtmpdb_rotate_v2 (db_path, 30, NULL, NULL, &error, &backup,
+			&entries) < 0)
+    {
+      fprintf (stderr, "wtmpdb_rotate_v2: %s\n", error ? error : "failed");
+      free (error);
+      return 1;
+    }
+  seconds = bench_elapsed (&start);
+
+  bench_begin ("rotate");
+  bench_result ("\"name\":\"rotate_v2\",\"entries\":%" PRIu64 ","
+		"\"seconds\":%.6f,\"entries_per_sec\":%.1f",
+		entries, seconds, entries / seconds);
+  bench_end ();
+
+  if (backup)
+    remove (backup);
+  free (backup);
+  remove (db_path);
+
+  return 0;
+}
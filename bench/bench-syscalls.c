@@ -0,0 +1,229 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Benchmark:
+   Count the syscalls of one wtmpdb_login, wtmpdb_logout,
+   wtmpdb_get_id and wtmpdb_read_all_v2 call against an already
+   initialized database. Every operation runs in a child traced
+   with ptrace, only the syscalls between two SIGSTOPs are counted.
+*/
+
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/ptrace.h>
+#include "basics.h"
+
+#include "wtmpdb.h"
+#include "bench.h"
+
+#define DB_DIR "bench-syscalls.d"
+#define DB_PATH DB_DIR "/wtmp.db"
+#define CALLS 100
+
+static int64_t ids[CALLS];
+
+static int
+read_cb (void *_unused_(unused), int _unused_(argc),
+	 char **_unused_(argv), char **_unused_(azColName))
+{
+  return 0;
+}
+
+static int
+op_noop (int _unused_(i), char **_unused_(error))
+{
+  return 0;
+}
+
+static int
+op_login (int _unused_(i), char **error)
+{
+  return wtmpdb_login (DB_PATH, USER_PROCESS, "user", bench_now (), "pts/1",
+		       "localhost", "sshd", error) < 0 ? -1 : 0;
+}
+
+static int
+op_logout (int i, char **error)
+{
+  return wtmpdb_logout (DB_PATH, ids[i], bench_now (), error);
+}
+
+static int
+op_get_id (int _unused_(i), char **error)
+{
+  return wtmpdb_get_id (DB_PATH, "pts/1", error) < 0 ? -1 : 0;
+}
+
+static int
+op_read_all (int _unused_(i), char **error)
+{
+  return wtmpdb_read_all_v2 (DB_PATH, read_cb, NULL, error);
+}
+
+/* Returns the number of syscalls op made in CALLS calls,
+   < 0 on error, -EPERM if we are not allowed to trace. */
+static long
+count_syscalls (int (*op) (int, char **))
+{
+  long stops = 0;
+  int marks = 0;
+  int status;
+  pid_t pid;
+
+  pid = fork ();
+  if (pid < 0)
+    return -errno;
+
+  if (pid == 0)
+    {
+      char *error = NULL;
+
+      if (ptrace (PTRACE_TRACEME, 0, NULL, NULL) < 0)
+	_exit (77);
+
+      /* prepare the entries the logout calls can close */
+      if (op == op_logout)
+	for (int i = 0; i < CALLS; i++)
+	  if ((ids[i] = wtmpdb_login (DB_PATH, USER_PROCESS, "user",
+				      bench_now (), "pts/1", "localhost",
+				      "sshd", &error)) < 0)
+	    _exit (1);
+
+      raise (SIGSTOP);
+      for (int i = 0; i < CALLS; i++)
+	if (op (i, &error) < 0)
+	  {
+	    fprintf (stderr, "%s\n", error ? error : "failed");
+	    _exit (1);
+	  }
+      raise (SIGSTOP);
+      _exit (0);
+    }
+
+  while (waitpid (pid, &status, 0) == pid)
+    {
+      int sig = 0;
+
+      if (WIFEXITED (status))
+	{
+	  if (WEXITSTATUS (status) == 77)
+	    return -EPERM;
+	  if (WEXITSTATUS (status) != 0 || marks != 2)
+	    return -1;
+	  /* every syscall stops at entry and exit */
+	  return stops / 2;
+	}
+      if (WIFSIGNALED (status))
+	return -1;
+
+      if (WSTOPSIG (status) == (SIGTRAP | 0x80))
+	{
+	  if (marks == 1)
+	    stops++;
+	}
+      else if (WSTOPSIG (status) == SIGSTOP)
+	{
+	  if (marks++ == 0)
+	    ptrace (PTRACE_SETOPTIONS, pid, NULL, PTRACE_O_TRACESYSGOOD);
+	}
+      else
+	sig = WSTOPSIG (status);
+
+      if (ptrace (marks == 1 ? PTRACE_SYSCALL : PTRACE_CONT,
+		  pid, NULL, sig) < 0)
+	return -errno;
+    }
+  return -errno;
+}
+
+int
+main (void)
+{
+  static const struct {
+    const char *name;
+    int (*op) (int, char **);
+  } ops[] = {
+    {"login", op_login},
+    {"logout", op_logout},
+    {"get_id", op_get_id},
+    {"read_all", op_read_all},
+  };
+  char *error = NULL;
+  long base;
+
+  remove (DB_PATH);
+  /* initialize the database, every call below takes the common path */
+  if (mkdir (DB_DIR, 0755) < 0 && errno != EEXIST)
+    {
+      perror ("mkdir");
+      return 1;
+    }
+  if (op_login (0, &error) < 0)
+    {
+      fprintf (stderr, "%s\n", error ? error : "wtmpdb_login failed");
+      return 1;
+    }
+
+  base = count_syscalls (op_noop);
+  if (base == -EPERM)
+    {
+      fprintf (stderr, "ptrace not permitted, skipping\n");
+      return 77;
+    }
+  if (base < 0)
+    {
+      fprintf (stderr, "Counting syscalls failed\n");
+      return 1;
+    }
+
+  bench_begin ("syscalls");
+  for (size_t i = 0; i < sizeof (ops) / sizeof (ops[0]); i++)
+    {
+      long count = count_syscalls (ops[i].op);
+
+      if (count < 0)
+	{
+	  fprintf (stderr, "%s: counting syscalls failed\n", ops[i].name);
+	  return 1;
+	}
+      bench_result ("\"name\":\"%s\",\"calls\":%d,\"syscalls_per_call\":%.1f",
+		    ops[i].name, CALLS, (double) (count - base) / CALLS);
+    }
+  bench_end ();
+
+  remove (DB_PATH);
+  rmdir (DB_DIR);
+
+  return 0;
+}
@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/* Helpers shared by the benchmarks. Every benchmark prints one JSON
+   object with its results to stdout:
+   {"benchmark":"login","version":"0.75.0","results":[{...},...]} */
+
+#pragma once
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <sqlite3.h>
+
+#include "wtmpdb.h"
+
+static inline uint64_t
+bench_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_REALTIME, &ts);
+  return wtmpdb_timespec2usec (ts);
+}
+
+/* Returns the seconds since start. */
+static inline double
+bench_elapsed (const struct timespec *start)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec - start->tv_sec) + (ts.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Creates the database with libwtmpdb and adds rows closed sessions
+   directly with sqlite, the first one at usec_login, the next ones
+   step usec later. Returns 0 on success, -1 on failure. */
+static inline int
+bench_fill (const char *db_path, int64_t rows, uint64_t usec_login,
+	    uint64_t step)
+{
+  char *error = NULL;
+  char *err_msg = NULL;
+  char sql[512];
+  sqlite3 *db;
+  int64_t id;
+
+  remove (db_path);
+  if ((id = wtmpdb_login (db_path, BOOT_TIME, "reboot", usec_login, "~",
+			  "kernel", NULL, &error)) < 0 ||
+      wtmpdb_logout (db_path, id, usec_login + step * rows, &error) < 0)
+    {
+      fprintf (stderr, "Creating %s failed: %s\n", db_path,
+	       error ? error : "unknown error");
+      free (error);
+      return -1;
+    }
+
+  if (sqlite3_open (db_path, &db) != SQLITE_OK)
+    {
+      fprintf (stderr, "Cannot open %s: %s\n", db_path, sqlite3_errmsg (db));
+      sqlite3_close (db);
+      return -1;
+    }
+
+  snprintf (sql, sizeof (sql),
+	    "WITH RECURSIVE n(i) AS (SELECT 0 UNION ALL SELECT i + 1 FROM n WHERE i + 1 < %" PRId64 ") "
+	    "INSERT INTO wtmp (Type, User, Login, Logout, TTY, RemoteHost, Service) "
+	    "SELECT %d, 'user' || (i %% 50), %" PRIu64 " + i * %" PRIu64 ", "
+	    "%" PRIu64 " + i * %" PRIu64 " + %" PRIu64 ", 'pts/' || (i %% 20), "
+	    "'192.168.0.' || (i %% 250), 'sshd' FROM n",
+	    rows, USER_PROCESS, usec_login, step, usec_login, step, step / 2);
+
+  if (sqlite3_exec (db, sql, NULL, NULL, &err_msg) != SQLITE_OK)
+    {
+      fprintf (stderr, "Filling %s failed: %s\n", db_path, err_msg);
+      sqlite3_free (err_msg);
+      sqlite3_close (db);
+      return -1;
+    }
+
+  sqlite3_close (db);
+  return 0;
+}
+
+static int bench_results;
+
+static inline void
+bench_begin (const char *benchmark)
+{
+  bench_results = 0;
+  printf ("{\"benchmark\":\"%s\",\"version\":\"%s\",\"results\":[",
+	  benchmark, VERSION);
+}
+
+/* fmt contains the members of one result object without the braces. */
+static inline void
+__attribute__((format (printf, 1, 2)))
+bench_result (const char *fmt, ...)
+{
+  va_list ap;
+
+  printf ("%s\n{", bench_results++ ? "," : "");
+  va_start (ap, fmt);
+  vprintf (fmt, ap);
+  va_end (ap);
+  printf ("}");
+  fflush (stdout);
+}
+
+static inline void
+bench_end (void)
+{
+  printf ("\n]}\n");
+}
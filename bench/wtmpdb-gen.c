@@ -0,0 +1,791 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/* wtmpdb-gen writes large databases with synthetic but realistic
+   data: skewed user and host distributions, overlapping sessions,
+   reboots, soft-reboots and crashes. The same seed and options give
+   the same database. Optionally a legacy wtmp file with the same
+   history is written for "wtmpdb import", without the sessions
+   that have no terminal. */
+
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <utmp.h>
+#include <sqlite3.h>
+
+enum utmp_type {
+  UTMP_RUN_LVL = RUN_LVL,
+  UTMP_BOOT_TIME = BOOT_TIME,
+  UTMP_USER_PROCESS = USER_PROCESS,
+  UTMP_DEAD_PROCESS = DEAD_PROCESS,
+};
+
+#undef EMPTY
+#undef RUN_LVL
+#undef BOOT_TIME
+#undef USER_PROCESS
+
+#include "wtmpdb.h"
+
+#define NO_HOST UINT32_MAX
+#define USEC_PER_DAY (86400 * USEC_PER_SEC)
+
+struct config {
+  uint64_t seed;
+  size_t sessions;
+  unsigned int days;
+  size_t users;
+  size_t hosts;
+  unsigned int ttys;
+  double skew;
+  double reboot_days;
+  unsigned int soft_reboots;  /* percent of the boots */
+  unsigned int crashes;       /* percent of the boots */
+  double mean_session;        /* seconds */
+};
+
+struct boot {
+  uint64_t start;
+  uint64_t end;       /* shutdown or crash, 0 for the running system */
+  int soft;
+  int crash;
+};
+
+/* One row of the wtmp table, strings are indexes. */
+struct row {
+  uint64_t login;
+  uint64_t logout;    /* 0 is NULL */
+  uint64_t end;       /* the tty is free again */
+  uint32_t user;      /* boot number for BOOT_TIME entries */
+  uint32_t host;
+  uint16_t tty;
+  uint8_t type;
+  uint8_t service;
+};
+
+static const struct {
+  const char *name;
+  const char *tty_prefix;
+  int remote;
+  unsigned int weight;
+} services[] = {
+  {"sshd", "pts/", 1, 75},
+  {"systemd-user", "", 0, 10},
+  {"login", "tty", 0, 6},
+  {"gdm-password", "tty", 0, 4},
+  {"su", "pts/", 0, 5},
+};
+
+/* splitmix64, deterministic for a seed on every platform */
+static uint64_t rng_state;
+
+static uint64_t
+rnd (void)
+{
+  uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/* uniform in [0, 1) */
+static double
+rnd_double (void)
+{
+  return (rnd () >> 11) * 0x1.0p-53;
+}
+
+static double
+rnd_exponential (double mean)
+{
+  return -mean * log (1.0 - rnd_double ());
+}
+
+/* log-normal with the given mean, most sessions are short,
+   some last for weeks */
+static double
+rnd_lognormal (double mean, double sigma)
+{
+  double u1 = 1.0 - rnd_double ();
+  double u2 = rnd_double ();
+  double z = sqrt (-2.0 * log (u1)) * cos (2.0 * M_PI * u2);
+
+  return mean * exp (sigma * z - sigma * sigma / 2.0);
+}
+
+/* Zipf distribution over n elements, skew 0 is uniform. */
+static double *
+zipf_init (size_t n, double skew)
+{
+  double *cdf = malloc (n * sizeof (double));
+  double sum = 0;
+
+  if (cdf == NULL)
+    return NULL;
+
+  for (size_t i = 0; i < n; i++)
+    cdf[i] = (sum += 1.0 / pow (i + 1, skew));
+  for (size_t i = 0; i < n; i++)
+    cdf[i] /= sum;
+
+  return cdf;
+}
+
+static uint32_t
+zipf_pick (const double *cdf, size_t n)
+{
+  double u = rnd_double ();
+  size_t lo = 0, hi = n - 1;
+
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (cdf[mid] < u)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+static uint8_t
+pick_service (void)
+{
+  unsigned int total = 0;
+  unsigned int r;
+
+  for (size_t i = 0; i < sizeof (services) / sizeof (services[0]); i++)
+    total += services[i].weight;
+
+  r = rnd () % total;
+  for (uint8_t i = 0; i < sizeof (services) / sizeof (services[0]); i++)
+    {
+      if (r < services[i].weight)
+	return i;
+      r -= services[i].weight;
+    }
+  return 0;
+}
+
+/* Returns the number of boots, -1 on failure. */
+static ssize_t
+gen_boots (const struct config *cfg, uint64_t start, uint64_t now,
+	   struct boot **boots)
+{
+  size_t count = 0, size = 64;
+  uint64_t t = start;
+
+  *boots = malloc (size * sizeof (struct boot));
+  if (*boots == NULL)
+    return -1;
+
+  while (t < now)
+    {
+      struct boot *b;
+      uint64_t uptime = rnd_exponential (cfg->reboot_days * USEC_PER_DAY);
+
+      if (count == size)
+	{
+	  struct boot *n = realloc (*boots, (size *= 2) * sizeof (struct boot));
+
+	  if (n == NULL)
+	    return -1;
+	  *boots = n;
+	}
+
+      b = &(*boots)[count];
+      b->start = t;
+      b->soft = count > 0 && rnd () % 100 < cfg->soft_reboots;
+      b->crash = 0;
+      b->end = 0;
+      count++;
+
+      if (t + uptime >= now)
+	break;
+
+      b->end = t + uptime;
+      b->crash = rnd () % 100 < cfg->crashes;
+      /* a soft-reboot keeps the kernel, a reboot needs a minute */
+      t = b->end + (rnd () % 100 < cfg->soft_reboots ?
+		    USEC_PER_SEC : 60 * USEC_PER_SEC);
+    }
+
+  return count;
+}
+
+/* Returns the boot running at t, the next one if t is between
+   shutdown and boot. */
+static const struct boot *
+find_boot (const struct boot *boots, size_t count, uint64_t t)
+{
+  size_t lo = 0, hi = count - 1;
+
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo + 1) / 2;
+
+      if (boots[mid].start <= t)
+	lo = mid;
+      else
+	hi = mid - 1;
+    }
+  if (boots[lo].end != 0 && t >= boots[lo].end && lo + 1 < count)
+    return &boots[lo + 1];
+  return &boots[lo];
+}
+
+static int
+cmp_rows (const void *a, const void *b)
+{
+  const struct row *ra = a, *rb = b;
+
+  if (ra->login != rb->login)
+    return ra->login < rb->login ? -1 : 1;
+  /* the boot entry comes first */
+  return (int) ra->type - (int) rb->type;
+}
+
+static void
+host_name (uint32_t host, char *buf, size_t len)
+{
+  snprintf (buf, len, "10.%u.%u.%u", (host >> 16) & 0xff,
+	    (host >> 8) & 0xff, host & 0xff);
+}
+
+/* a new kernel every 50 boots */
+static void
+kernel_release (const struct row *r, char *buf, size_t len)
+{
+  snprintf (buf, len, "6.%u.%u-default", r->user / 50, r->user % 50);
+}
+
+static void
+tty_name (const struct row *r, char *buf, size_t len)
+{
+  if (services[r->service].tty_prefix[0] == '\0')
+    buf[0] = '\0';
+  else
+    snprintf (buf, len, "%s%u", services[r->service].tty_prefix, r->tty);
+}
+
+/* Gives every session the lowest free terminal like the kernel does
+   for pseudo terminals, so no two sessions share a tty at the same
+   time. The rows are sorted by login. */
+static int
+assign_ttys (const struct config *cfg, struct row *rows, size_t n)
+{
+  uint64_t *pts = calloc (cfg->ttys, sizeof (uint64_t));
+  uint64_t vt[6] = {0};
+
+  if (pts == NULL)
+    return -1;
+
+  for (size_t i = 0; i < n; i++)
+    {
+      struct row *r = &rows[i];
+      uint64_t *busy;
+      unsigned int count;
+      unsigned int k, best = 0;
+
+      if (r->type != USER_PROCESS || services[r->service].tty_prefix[0] == '\0')
+	continue;
+
+      if (services[r->service].tty_prefix[0] == 't')
+	busy = vt, count = 6;
+      else
+	busy = pts, count = cfg->ttys;
+
+      for (k = 0; k < count && busy[k] > r->login; k++)
+	if (busy[k] < busy[best])
+	  best = k;
+      /* all are busy, share the one getting free first */
+      if (k == count)
+	k = best;
+
+      busy[k] = r->end;
+      r->tty = busy == vt ? k + 1 : k;
+    }
+
+  free (pts);
+  return 0;
+}
+
+/* Returns the number of rows, -1 on failure. */
+static ssize_t
+gen_rows (const struct config *cfg, uint64_t now, struct row **rows,
+	  size_t *boot_count)
+{
+  uint64_t start = now - (uint64_t) cfg->days * USEC_PER_DAY;
+  double *user_cdf = NULL, *host_cdf = NULL;
+  struct boot *boots = NULL;
+  ssize_t nboots;
+  size_t n = 0;
+
+  if ((nboots = gen_boots (cfg, start, now, &boots)) < 0 ||
+      (user_cdf = zipf_init (cfg->users, cfg->skew)) == NULL ||
+      (host_cdf = zipf_init (cfg->hosts, cfg->skew)) == NULL ||
+      (*rows = malloc ((nboots + cfg->sessions) * sizeof (struct row))) == NULL)
+    {
+      free (boots);
+      free (user_cdf);
+      free (host_cdf);
+      return -1;
+    }
+
+  for (ssize_t i = 0; i < nboots; i++)
+    {
+      struct row *r = &(*rows)[n++];
+
+      memset (r, 0, sizeof (*r));
+      r->type = BOOT_TIME;
+      r->user = i;
+      r->login = boots[i].start;
+      r->logout = boots[i].crash ? 0 : boots[i].end;
+      r->host = NO_HOST;
+      /* the soft flag of the boot tells the user name */
+      r->service = boots[i].soft;
+    }
+
+  for (size_t i = 0; i < cfg->sessions; i++)
+    {
+      struct row *r = &(*rows)[n++];
+      uint64_t login = start + rnd () % (now - start);
+      const struct boot *b = find_boot (boots, nboots, login);
+      uint64_t length;
+
+      if (login < b->start)
+	login = b->start + 30 * USEC_PER_SEC;
+
+      r->type = USER_PROCESS;
+      r->service = pick_service ();
+      r->user = zipf_pick (user_cdf, cfg->users);
+      r->host = services[r->service].remote ?
+	zipf_pick (host_cdf, cfg->hosts) : NO_HOST;
+      r->login = login;
+
+      length = rnd_lognormal (cfg->mean_session, 1.5) * USEC_PER_SEC;
+      r->logout = r->end = login + length + 1;
+      if (b->end == 0 && r->logout >= now)
+	{
+	  r->logout = 0;     /* still logged in */
+	  r->end = UINT64_MAX;
+	}
+      else if (b->end != 0 && r->logout >= b->end)
+	{
+	  r->logout = b->crash ? 0 : b->end;
+	  r->end = b->end;
+	}
+    }
+
+  qsort (*rows, n, sizeof (struct row), cmp_rows);
+
+  if (assign_ttys (cfg, *rows, n) < 0)
+    {
+      free (*rows);
+      n = -1;
+    }
+
+  *boot_count = nboots;
+  free (boots);
+  free (user_cdf);
+  free (host_cdf);
+  return n;
+}
+
+static int
+write_db (const char *db_path, const struct row *rows, size_t n)
+{
+  const char *sql = "INSERT INTO wtmp (Type, User, Login, Logout, TTY, RemoteHost, Service) VALUES (?, ?, ?, ?, ?, ?, ?)";
+  char *error = NULL;
+  sqlite3_stmt *res;
+  sqlite3 *db;
+  int r;
+
+  if (access (db_path, F_OK) == 0)
+    {
+      fprintf (stderr, "%s exists already\n", db_path);
+      return -1;
+    }
+
+  /* let libwtmpdb create the current schema */
+  if (wtmpdb_migrate (db_path, &error) < 0)
+    {
+      fprintf (stderr, "Creating %s failed: %s\n", db_path,
+	       error ? error : "unknown error");
+      free (error);
+      return -1;
+    }
+
+  if (sqlite3_open (db_path, &db) != SQLITE_OK ||
+      sqlite3_exec (db, "PRAGMA synchronous = OFF; BEGIN", NULL, NULL,
+		    NULL) != SQLITE_OK ||
+      sqlite3_prepare_v2 (db, sql, -1, &res, NULL) != SQLITE_OK)
+    {
+      fprintf (stderr, "Cannot write %s: %s\n", db_path, sqlite3_errmsg (db));
+      sqlite3_close (db);
+      return -1;
+    }
+
+  for (size_t i = 0; i < n; i++)
+    {
+      const struct row *row = &rows[i];
+      char user[32], tty[32], host[32];
+
+      if (row->type == BOOT_TIME)
+	{
+	  snprintf (user, sizeof (user), "%s",
+		    row->service ? "soft-reboot" : "reboot");
+	  snprintf (tty, sizeof (tty), "~");
+	  kernel_release (row, host, sizeof (host));
+	}
+      else
+	{
+	  snprintf (user, sizeof (user), "user%u", row->user);
+	  tty_name (row, tty, sizeof (tty));
+	  if (row->host != NO_HOST)
+	    host_name (row->host, host, sizeof (host));
+	}
+
+      sqlite3_bind_int (res, 1, row->type);
+      sqlite3_bind_text (res, 2, user, -1, SQLITE_TRANSIENT);
+      sqlite3_bind_int64 (res, 3, row->login);
+      if (row->logout)
+	sqlite3_bind_int64 (res, 4, row->logout);
+      else
+	sqlite3_bind_null (res, 4);
+      if (tty[0])
+	sqlite3_bind_text (res, 5, tty, -1, SQLITE_TRANSIENT);
+      else
+	sqlite3_bind_null (res, 5);
+      if (row->type == BOOT_TIME || row->host != NO_HOST)
+	sqlite3_bind_text (res, 6, host, -1, SQLITE_TRANSIENT);
+      else
+	sqlite3_bind_null (res, 6);
+      if (row->type == BOOT_TIME)
+	sqlite3_bind_null (res, 7);
+      else
+	sqlite3_bind_text (res, 7, services[row->service].name, -1,
+			   SQLITE_STATIC);
+
+      if ((r = sqlite3_step (res)) != SQLITE_DONE)
+	{
+	  fprintf (stderr, "Inserting entry failed: %s\n",
+		   sqlite3_errmsg (db));
+	  sqlite3_finalize (res);
+	  sqlite3_close (db);
+	  return -1;
+	}
+      sqlite3_reset (res);
+    }
+  sqlite3_finalize (res);
+
+  if (sqlite3_exec (db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK)
+    {
+      fprintf (stderr, "Cannot write %s: %s\n", db_path, sqlite3_errmsg (db));
+      sqlite3_close (db);
+      return -1;
+    }
+
+  sqlite3_close (db);
+  return 0;
+}
+
+/* A login or a logout of a row, for the legacy file */
+struct event {
+  uint64_t time;
+  uint32_t row;
+  uint8_t logout;
+};
+
+static int
+cmp_events (const void *a, const void *b)
+{
+  const struct event *ea = a, *eb = b;
+
+  if (ea->time != eb->time)
+    return ea->time < eb->time ? -1 : 1;
+  /* logouts before logins, the shutdown before the next boot */
+  if (ea->logout != eb->logout)
+    return (int) eb->logout - (int) ea->logout;
+  return ea->row < eb->row ? -1 : ea->row > eb->row;
+}
+
+static int
+write_wtmp (const char *path, const struct row *rows, size_t n)
+{
+  struct event *events;
+  size_t count = 0;
+  FILE *fp;
+
+  if ((events = malloc (2 * n * sizeof (struct event))) == NULL)
+    return -1;
+
+  for (size_t i = 0; i < n; i++)
+    {
+      /* legacy wtmp knows only sessions on a terminal */
+      if (rows[i].type == USER_PROCESS &&
+	  services[rows[i].service].tty_prefix[0] == '\0')
+	continue;
+      events[count++] = (struct event) { rows[i].login, i, 0 };
+      if (rows[i].logout)
+	events[count++] = (struct event) { rows[i].logout, i, 1 };
+    }
+  qsort (events, count, sizeof (struct event), cmp_events);
+
+  if ((fp = fopen (path, "w")) == NULL)
+    {
+      free (events);
+      return -1;
+    }
+
+  for (size_t i = 0; i < count; i++)
+    {
+      const struct row *row = &rows[events[i].row];
+      struct utmp u;
+
+      memset (&u, 0, sizeof (u));
+      u.ut_tv.tv_sec = events[i].time / USEC_PER_SEC;
+      u.ut_tv.tv_usec = events[i].time % USEC_PER_SEC;
+
+      if (row->type == BOOT_TIME)
+	{
+	  u.ut_type = events[i].logout ? UTMP_RUN_LVL : UTMP_BOOT_TIME;
+	  strncpy (u.ut_user, events[i].logout ? "shutdown" : "reboot",
+		   sizeof (u.ut_user));
+	  strncpy (u.ut_id, "~~", sizeof (u.ut_id));
+	  strncpy (u.ut_line, "~", sizeof (u.ut_line));
+	  if (!events[i].logout)
+	    kernel_release (row, u.ut_host, sizeof (u.ut_host));
+	}
+      else
+	{
+	  char tty[32];
+
+	  u.ut_type = events[i].logout ? UTMP_DEAD_PROCESS : UTMP_USER_PROCESS;
+	  /* import matches the logout by pid */
+	  u.ut_pid = 100 + events[i].row;
+	  tty_name (row, tty, sizeof (tty));
+	  strncpy (u.ut_line, tty, sizeof (u.ut_line));
+	  if (!events[i].logout)
+	    {
+	      snprintf (u.ut_user, sizeof (u.ut_user), "user%u", row->user);
+	      if (row->host != NO_HOST)
+		host_name (row->host, u.ut_host, sizeof (u.ut_host));
+	    }
+	}
+
+      if (fwrite (&u, sizeof (u), 1, fp) != 1)
+	break;
+    }
+
+  free (events);
+  if (ferror (fp))
+    {
+      fclose (fp);
+      return -1;
+    }
+  return fclose (fp) == 0 ? 0 : -1;
+}
+
+static void
+usage (int retval)
+{
+  FILE *output = (retval != EXIT_SUCCESS) ? stderr : stdout;
+
+  fprintf (output, "Usage: wtmpdb-gen [options] database\n");
+  fputs ("Options:\n", output);
+  fputs ("  -s, --seed N           Seed of the random numbers (default 1)\n", output);
+  fputs ("  -n, --sessions N       Number of sessions (default 100000)\n", output);
+  fputs ("  -d, --days N           Days of history up to now (default 365)\n", output);
+  fputs ("  -u, --users N          Number of different users (default 1000)\n", output);
+  fputs ("  -H, --hosts N          Number of different remote hosts (default 5000)\n", output);
+  fputs ("  -t, --ttys N           Number of pseudo terminals (default 1024)\n", output);
+  fputs ("  -z, --skew X           Zipf exponent of users and hosts, 0 is uniform (default 1.0)\n", output);
+  fputs ("  -m, --mean-session S   Mean session length in seconds (default 3600)\n", output);
+  fputs ("  -r, --reboot-days X    Mean days between reboots (default 14)\n", output);
+  fputs ("  -S, --soft-reboots P   Percent of soft-reboots (default 10)\n", output);
+  fputs ("  -c, --crashes P        Percent of boots ending in a crash (default 5)\n", output);
+  fputs ("  -e, --end SECONDS      End of the history in seconds since the epoch\n", output);
+  fputs ("                         (default today 00:00 UTC)\n", output);
+  fputs ("  -w, --wtmp FILE        Write the history as legacy wtmp file, too\n", output);
+  fputs ("  -h, --help             Display this help message and exit\n", output);
+  exit (retval);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct option const longopts[] = {
+    {"seed", required_argument, NULL, 's'},
+    {"sessions", required_argument, NULL, 'n'},
+    {"days", required_argument, NULL, 'd'},
+    {"users", required_argument, NULL, 'u'},
+    {"hosts", required_argument, NULL, 'H'},
+    {"ttys", required_argument, NULL, 't'},
+    {"skew", required_argument, NULL, 'z'},
+    {"mean-session", required_argument, NULL, 'm'},
+    {"reboot-days", required_argument, NULL, 'r'},
+    {"soft-reboots", required_argument, NULL, 'S'},
+    {"crashes", required_argument, NULL, 'c'},
+    {"wtmp", required_argument, NULL, 'w'},
+    {"end", required_argument, NULL, 'e'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, '\0'}
+  };
+  struct config cfg = {
+    .seed = 1,
+    .sessions = 100000,
+    .days = 365,
+    .users = 1000,
+    .hosts = 5000,
+    .ttys = 1024,
+    .skew = 1.0,
+    .reboot_days = 14,
+    .soft_reboots = 10,
+    .crashes = 5,
+    .mean_session = 3600,
+  };
+  const char *wtmp_path = NULL;
+  struct timespec start, ts;
+  time_t end = 0;
+  struct row *rows;
+  size_t boots;
+  ssize_t n;
+  int c;
+
+  while ((c = getopt_long (argc, argv, "s:n:d:u:H:t:z:m:r:S:c:w:e:h",
+			   longopts, NULL)) != -1)
+    {
+      switch (c)
+	{
+	case 's':
+	  cfg.seed = strtoull (optarg, NULL, 10);
+	  break;
+	case 'n':
+	  cfg.sessions = strtoul (optarg, NULL, 10);
+	  break;
+	case 'd':
+	  cfg.days = strtoul (optarg, NULL, 10);
+	  break;
+	case 'u':
+	  cfg.users = strtoul (optarg, NULL, 10);
+	  break;
+	case 'H':
+	  cfg.hosts = strtoul (optarg, NULL, 10);
+	  break;
+	case 't':
+	  cfg.ttys = strtoul (optarg, NULL, 10);
+	  break;
+	case 'z':
+	  cfg.skew = strtod (optarg, NULL);
+	  break;
+	case 'm':
+	  cfg.mean_session = strtod (optarg, NULL);
+	  break;
+	case 'r':
+	  cfg.reboot_days = strtod (optarg, NULL);
+	  break;
+	case 'S':
+	  cfg.soft_reboots = strtoul (optarg, NULL, 10);
+	  break;
+	case 'c':
+	  cfg.crashes = strtoul (optarg, NULL, 10);
+	  break;
+	case 'w':
+	  wtmp_path = optarg;
+	  break;
+	case 'e':
+	  end = strtoll (optarg, NULL, 10);
+	  break;
+	case 'h':
+	  usage (EXIT_SUCCESS);
+	  break;
+	default:
+	  usage (EXIT_FAILURE);
+	  break;
+	}
+    }
+
+  if (argc != optind + 1)
+    usage (EXIT_FAILURE);
+
+  if (cfg.days == 0 || cfg.users == 0 || cfg.hosts == 0 || cfg.ttys == 0 ||
+      cfg.reboot_days <= 0 || cfg.mean_session <= 0 || cfg.skew < 0)
+    {
+      fprintf (stderr, "Days, users, hosts, ttys, reboot days and session length must be positive\n");
+      return EXIT_FAILURE;
+    }
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  rng_state = cfg.seed;
+
+  /* Without --end the history ends today at midnight UTC, so a seed
+     gives the same database for the whole day. */
+  if (end == 0)
+    {
+      clock_gettime (CLOCK_REALTIME, &ts);
+      end = ts.tv_sec - ts.tv_sec % 86400;
+    }
+  ts.tv_sec = end;
+  ts.tv_nsec = 0;
+
+  if ((n = gen_rows (&cfg, wtmpdb_timespec2usec (ts), &rows, &boots)) < 0)
+    {
+      fprintf (stderr, "Out of memory\n");
+      return EXIT_FAILURE;
+    }
+
+  if (write_db (argv[optind], rows, n) < 0)
+    {
+      free (rows);
+      return EXIT_FAILURE;
+    }
+
+  if (wtmp_path && write_wtmp (wtmp_path, rows, n) < 0)
+    {
+      fprintf (stderr, "Cannot write %s: %s\n", wtmp_path, strerror (errno));
+      free (rows);
+      return EXIT_FAILURE;
+    }
+  free (rows);
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  printf ("Wrote %zd entries (%zu boots, %zu sessions) in %.1f seconds\n",
+	  n, boots, cfg.sessions,
+	  (ts.tv_sec - start.tv_sec) + (ts.tv_nsec - start.tv_nsec) / 1e9);
+
+  return EXIT_SUCCESS;
+}
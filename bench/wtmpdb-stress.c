@@ -0,0 +1,543 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/* wtmpdb-stress forks workers which all log sessions into the same
+   database at the same time, like many sshd processes do. Every
+   session is a login, a search for its ID and a logout, either
+   through libwtmpdb or through pam_wtmpdb. Throughput, latencies,
+   failures and logouts which never made it into the database are
+   printed as JSON object. */
+
+#include <errno.h>
+#include <getopt.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#if HAVE_PAM_START_CONFDIR
+#include <security/pam_appl.h>
+#endif
+#include "basics.h"
+
+#include "wtmpdb.h"
+#include "bench.h"
+
+#define TTY_PREFIX "stress/"
+
+enum { OP_LOGIN, OP_GET_ID, OP_LOGOUT, OPS };
+static const char *op_names[OPS] = {"login", "get_id", "logout"};
+
+struct config {
+  const char *db_path;     /* NULL for the default database */
+  const char *pam_module;  /* NULL to use libwtmpdb directly */
+  const char *user;
+  unsigned int workers;
+  unsigned int iterations;
+};
+
+struct counters {
+  uint64_t sessions;
+  uint64_t busy;
+  uint64_t timeouts;
+  uint64_t errors;
+  uint64_t mismatches;
+  uint64_t busy_retries;
+};
+
+/* Shared with the workers: the latency of every operation in usec,
+   0 if it failed, and the counters of every worker. */
+static uint32_t *latencies;
+static struct counters *counters;
+
+/* not the system database or wtmpdbd */
+static int
+is_file (const char *db_path)
+{
+  return db_path != NULL && strcmp (db_path, "varlink") != 0;
+}
+
+static uint32_t
+usec_since (const struct timespec *start)
+{
+  uint32_t usec = bench_elapsed (start) * 1e6;
+
+  return usec > 0 ? usec : 1;
+}
+
+static void
+count_error (struct counters *c, int64_t r, char **error)
+{
+  if (r == -EBUSY)
+    c->busy++;
+  else if (r == -ETIME)
+    c->timeouts++;
+  else
+    {
+      c->errors++;
+      if (*error)
+	fprintf (stderr, "%s\n", *error);
+    }
+  free (*error);
+  *error = NULL;
+}
+
+/* Searches the ID of the session and compares it with id */
+static void
+get_id (const struct config *cfg, struct counters *c, const char *tty,
+	int64_t id, uint32_t *lat)
+{
+  struct timespec start;
+  char *error = NULL;
+  int64_t r;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  r = wtmpdb_get_id (cfg->db_path, tty, &error);
+  if (r < 0)
+    count_error (c, r, &error);
+  else
+    {
+      lat[OP_GET_ID] = usec_since (&start);
+      if (id >= 0 && r != id)
+	c->mismatches++;
+    }
+}
+
+static void
+run_api (const struct config *cfg, unsigned int worker)
+{
+  struct counters *c = &counters[worker];
+
+  for (unsigned int i = 0; i < cfg->iterations; i++)
+    {
+      uint32_t *lat = &latencies[((size_t) worker * cfg->iterations + i) * OPS];
+      struct timespec start;
+      char *error = NULL;
+      char tty[32];
+      int64_t id;
+      int r;
+
+      snprintf (tty, sizeof (tty), TTY_PREFIX "%u/%u", worker, i);
+
+      clock_gettime (CLOCK_MONOTONIC, &start);
+      id = wtmpdb_login (cfg->db_path, USER_PROCESS, cfg->user, bench_now (),
+			 tty, "localhost", "sshd", &error);
+      if (id < 0)
+	{
+	  count_error (c, id, &error);
+	  continue;
+	}
+      lat[OP_LOGIN] = usec_since (&start);
+
+      get_id (cfg, c, tty, id, lat);
+
+      clock_gettime (CLOCK_MONOTONIC, &start);
+      r = wtmpdb_logout (cfg->db_path, id, bench_now (), &error);
+      if (r < 0)
+	{
+	  count_error (c, r, &error);
+	  continue;
+	}
+      lat[OP_LOGOUT] = usec_since (&start);
+      c->sessions++;
+    }
+}
+
+#if HAVE_PAM_START_CONFDIR
+#define PAM_SERVICE_NAME "wtmpdb-stress"
+#define PAM_CONFDIR "wtmpdb-stress.pam.d"
+
+static int
+no_conv (int _unused_(num_msg), const struct pam_message **_unused_(msg),
+	 struct pam_response **_unused_(resp), void *_unused_(appdata_ptr))
+{
+  return PAM_CONV_ERR;
+}
+
+/* pam_wtmpdb is the only session module of our own PAM service */
+static int
+write_pam_config (const struct config *cfg)
+{
+  FILE *fp;
+
+  if (mkdir (PAM_CONFDIR, 0755) < 0 && errno != EEXIST)
+    return -1;
+  if ((fp = fopen (PAM_CONFDIR "/" PAM_SERVICE_NAME, "w")) == NULL)
+    return -1;
+  fprintf (fp, "session required %s%s%s\n", cfg->pam_module,
+	   cfg->db_path ? " database=" : "",
+	   cfg->db_path ? cfg->db_path : "");
+  return fclose (fp);
+}
+
+static void
+run_pam (const struct config *cfg, unsigned int worker)
+{
+  const struct pam_conv conv = { no_conv, NULL };
+  struct counters *c = &counters[worker];
+
+  for (unsigned int i = 0; i < cfg->iterations; i++)
+    {
+      uint32_t *lat = &latencies[((size_t) worker * cfg->iterations + i) * OPS];
+      struct timespec start;
+      pam_handle_t *pamh;
+      char tty[32];
+      int r;
+
+      snprintf (tty, sizeof (tty), TTY_PREFIX "%u/%u", worker, i);
+
+      r = pam_start_confdir (PAM_SERVICE_NAME, cfg->user, &conv,
+			     PAM_CONFDIR, &pamh);
+      if (r != PAM_SUCCESS)
+	{
+	  fprintf (stderr, "pam_start_confdir: %s\n", pam_strerror (NULL, r));
+	  c->errors++;
+	  continue;
+	}
+      pam_set_item (pamh, PAM_TTY, tty);
+      pam_set_item (pamh, PAM_RHOST, "localhost");
+
+      clock_gettime (CLOCK_MONOTONIC, &start);
+      r = pam_open_session (pamh, PAM_SILENT);
+      if (r != PAM_SUCCESS)
+	{
+	  /* pam_wtmpdb logs the reason, a timeout is ignored */
+	  c->errors++;
+	  pam_end (pamh, r);
+	  continue;
+	}
+      lat[OP_LOGIN] = usec_since (&start);
+
+      get_id (cfg, c, tty, -1, lat);
+
+      clock_gettime (CLOCK_MONOTONIC, &start);
+      r = pam_close_session (pamh, PAM_SILENT);
+      if (r != PAM_SUCCESS)
+	c->errors++;
+      else
+	{
+	  lat[OP_LOGOUT] = usec_since (&start);
+	  c->sessions++;
+	}
+      pam_end (pamh, r);
+    }
+}
+#endif
+
+struct lost {
+  uint64_t since;
+  uint64_t entries;
+  uint64_t open;
+};
+
+/* columns: ID, Type, User, Login, Logout, TTY, RemoteHost, Service */
+static int
+count_lost (void *userdata, int argc, char **argv,
+	    char **_unused_(azColName))
+{
+  struct lost *l = userdata;
+
+  if (argc < 6 || argv[3] == NULL || argv[5] == NULL ||
+      strncmp (argv[5], TTY_PREFIX, strlen (TTY_PREFIX)) != 0 ||
+      strtoull (argv[3], NULL, 10) < l->since)
+    return 0;
+
+  l->entries++;
+  if (argv[4] == NULL)
+    l->open++;
+  return 0;
+}
+
+static int
+cmp_uint32 (const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void
+print_latencies (const struct config *cfg)
+{
+  size_t total = (size_t) cfg->workers * cfg->iterations;
+  uint32_t *values = malloc (total * sizeof (uint32_t));
+
+  if (values == NULL)
+    return;
+
+  for (int op = 0; op < OPS; op++)
+    {
+      size_t n = 0;
+
+      for (size_t i = 0; i < total; i++)
+	if (latencies[i * OPS + op])
+	  values[n++] = latencies[i * OPS + op];
+      if (n == 0)
+	continue;
+
+      qsort (values, n, sizeof (uint32_t), cmp_uint32);
+      bench_result ("\"name\":\"%s\",\"ops\":%zu,\"p50_usec\":%u,"
+		    "\"p90_usec\":%u,\"p99_usec\":%u,\"p999_usec\":%u,"
+		    "\"max_usec\":%u",
+		    op_names[op], n, values[n / 2], values[n * 9 / 10],
+		    values[n * 99 / 100], values[n * 999 / 1000],
+		    values[n - 1]);
+    }
+
+  free (values);
+}
+
+static void
+usage (int retval)
+{
+  FILE *output = (retval != EXIT_SUCCESS) ? stderr : stdout;
+
+  fprintf (output, "Usage: wtmpdb-stress [options]\n");
+  fputs ("Options:\n", output);
+  fputs ("  -f, --file FILE        Use FILE as wtmpdb database (default wtmpdb-stress.db),\n", output);
+  fputs ("                         \"default\" for the system database or wtmpdbd,\n", output);
+  fputs ("                         \"varlink\" for wtmpdbd\n", output);
+  fputs ("  -w, --workers N        Number of worker processes (default 8)\n", output);
+  fputs ("  -i, --iterations N     Sessions per worker (default 100)\n", output);
+#if HAVE_PAM_START_CONFDIR
+  fputs ("  -p, --pam MODULE       Open and close the sessions with this pam_wtmpdb.so\n", output);
+#endif
+  fputs ("  -T, --timeout USEC     Limit the time a call may block, see wtmpdb_set_timeout\n", output);
+  fputs ("  -h, --help             Display this help message and exit\n", output);
+  exit (retval);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct option const longopts[] = {
+    {"file", required_argument, NULL, 'f'},
+    {"workers", required_argument, NULL, 'w'},
+    {"iterations", required_argument, NULL, 'i'},
+    {"pam", required_argument, NULL, 'p'},
+    {"timeout", required_argument, NULL, 'T'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, '\0'}
+  };
+  struct config cfg = {
+    .db_path = "wtmpdb-stress.db",
+    .workers = 8,
+    .iterations = 100,
+  };
+  struct counters total = {0};
+  struct lost lost = {0};
+  struct timespec start;
+  const struct passwd *pw;
+  char *error = NULL;
+  double seconds;
+  int barrier[2];
+  int c;
+
+  while ((c = getopt_long (argc, argv, "f:w:i:p:T:h", longopts, NULL)) != -1)
+    {
+      switch (c)
+	{
+	case 'f':
+	  cfg.db_path = strcmp (optarg, "default") == 0 ? NULL : optarg;
+	  break;
+	case 'w':
+	  cfg.workers = strtoul (optarg, NULL, 10);
+	  break;
+	case 'i':
+	  cfg.iterations = strtoul (optarg, NULL, 10);
+	  break;
+#if HAVE_PAM_START_CONFDIR
+	case 'p':
+	  cfg.pam_module = optarg;
+	  break;
+#endif
+	case 'T':
+	  wtmpdb_set_timeout (strtoull (optarg, NULL, 10));
+	  break;
+	case 'h':
+	  usage (EXIT_SUCCESS);
+	  break;
+	default:
+	  usage (EXIT_FAILURE);
+	  break;
+	}
+    }
+
+  if (argc > optind)
+    {
+      fprintf (stderr, "Unexpected argument: %s\n", argv[optind]);
+      usage (EXIT_FAILURE);
+    }
+  if (cfg.workers == 0 || cfg.iterations == 0)
+    {
+      fprintf (stderr, "Workers and iterations must be positive\n");
+      return EXIT_FAILURE;
+    }
+
+  /* pam_wtmpdb only logs users which exist */
+  if ((pw = getpwuid (getuid ())) == NULL)
+    {
+      fprintf (stderr, "Cannot find my own user name\n");
+      return EXIT_FAILURE;
+    }
+  cfg.user = strdup (pw->pw_name);
+
+  /* the workers measure the contention, not the creation */
+  if (is_file (cfg.db_path))
+    {
+      remove (cfg.db_path);
+      if (wtmpdb_migrate (cfg.db_path, &error) < 0)
+	{
+	  fprintf (stderr, "Creating %s failed: %s\n", cfg.db_path,
+		   error ? error : "unknown error");
+	  free (error);
+	  return EXIT_FAILURE;
+	}
+    }
+  else
+    {
+      /* skip like the other benchmarks if wtmpdbd is not reachable */
+      int64_t id = wtmpdb_login (cfg.db_path, USER_PROCESS, cfg.user,
+				 bench_now (), "stress/probe", NULL,
+				 "wtmpdb-stress", &error);
+
+      if (id < 0)
+	{
+	  fprintf (stderr, "wtmpdb_login: %s\n", error ? error : "failed");
+	  free (error);
+	  if (id == -ECONNREFUSED || id == -ENOENT ||
+	      id == -EACCES || id == -EPROTONOSUPPORT)
+	    return 77;
+	  return EXIT_FAILURE;
+	}
+      if (wtmpdb_logout (cfg.db_path, id, bench_now (), &error) < 0)
+	{
+	  fprintf (stderr, "wtmpdb_logout: %s\n", error ? error : "failed");
+	  free (error);
+	  return EXIT_FAILURE;
+	}
+    }
+
+#if HAVE_PAM_START_CONFDIR
+  if (cfg.pam_module && write_pam_config (&cfg) < 0)
+    {
+      fprintf (stderr, "Cannot write PAM configuration: %s\n",
+	       strerror (errno));
+      return EXIT_FAILURE;
+    }
+#endif
+
+  latencies = mmap (NULL, (size_t) cfg.workers * cfg.iterations * OPS *
+		    sizeof (uint32_t), PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  counters = mmap (NULL, cfg.workers * sizeof (struct counters),
+		   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (latencies == MAP_FAILED || counters == MAP_FAILED || pipe (barrier) < 0)
+    {
+      perror ("wtmpdb-stress");
+      return EXIT_FAILURE;
+    }
+
+  lost.since = bench_now ();
+  fflush (stdout);
+  for (unsigned int w = 0; w < cfg.workers; w++)
+    {
+      pid_t pid = fork ();
+      char dummy;
+
+      if (pid < 0)
+	{
+	  perror ("fork");
+	  return EXIT_FAILURE;
+	}
+      if (pid > 0)
+	continue;
+
+      /* start all workers at the same time */
+      close (barrier[1]);
+      if (read (barrier[0], &dummy, 1) < 0)
+	_exit (EXIT_FAILURE);
+#if HAVE_PAM_START_CONFDIR
+      if (cfg.pam_module)
+	run_pam (&cfg, w);
+      else
+#endif
+	run_api (&cfg, w);
+      counters[w].busy_retries = wtmpdb_get_busy_retries ();
+      _exit (EXIT_SUCCESS);
+    }
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  close (barrier[0]);
+  close (barrier[1]);
+  while (wait (NULL) > 0)
+    ;
+  seconds = bench_elapsed (&start);
+
+  for (unsigned int w = 0; w < cfg.workers; w++)
+    {
+      total.sessions += counters[w].sessions;
+      total.busy += counters[w].busy;
+      total.timeouts += counters[w].timeouts;
+      total.errors += counters[w].errors;
+      total.mismatches += counters[w].mismatches;
+      total.busy_retries += counters[w].busy_retries;
+    }
+
+  /* Every login which made it into the database needs its logout */
+  if (wtmpdb_read_all_v2 (cfg.db_path, count_lost, &lost, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_read_all_v2: %s\n",
+	       error ? error : "failed");
+      free (error);
+      return EXIT_FAILURE;
+    }
+
+  bench_begin ("stress");
+  bench_result ("\"name\":\"sessions\",\"mode\":\"%s\",\"workers\":%u,"
+		"\"iterations\":%u,\"sessions\":%" PRIu64 ","
+		"\"seconds\":%.6f,\"sessions_per_sec\":%.1f,"
+		"\"busy\":%" PRIu64 ",\"timeouts\":%" PRIu64 ","
+		"\"errors\":%" PRIu64 ",\"busy_retries\":%" PRIu64 ","
+		"\"id_mismatches\":%" PRIu64 ",\"entries\":%" PRIu64 ","
+		"\"lost_logouts\":%" PRIu64,
+		cfg.pam_module ? "pam" : "api", cfg.workers, cfg.iterations,
+		total.sessions, seconds, total.sessions / seconds,
+		total.busy, total.timeouts, total.errors, total.busy_retries,
+		total.mismatches, lost.entries, lost.open);
+  print_latencies (&cfg);
+  bench_end ();
+
+  if (is_file (cfg.db_path))
+    remove (cfg.db_path);
+
+  return total.errors || total.mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -65,12 +65,122 @@ extern int wtmpdb_read_all_v2 (const char *db_path,
 			       int (*cb_func) (void *unused, int argc,
 					       char **argv, char **azColName),
 			       void *userdata, char **error);
+/* Reads only entries with an ID larger than after_id, ordered by ID */
+extern int wtmpdb_read_since_id (const char *db_path, int64_t after_id,
+				 int (*cb_func)(void *unused, int argc,
+						char **argv, char **azColName),
+				 void *userdata, char **error);
+/* Reads only the entry with this ID, always from the file */
+extern int wtmpdb_read_id (const char *db_path, int64_t id,
+			   int (*cb_func)(void *unused, int argc,
+					  char **argv, char **azColName),
+			   void *userdata, char **error);
+/* Reads at most limit entries ordered by Login and ID, newest first,
+   after the entry before_login/before_id if before_id > 0. Pass the
+   Login and ID of the last entry to get the next page. */
+extern int wtmpdb_read_page (const char *db_path, uint64_t before_login,
+			     int64_t before_id, unsigned int limit,
+			     int (*cb_func)(void *unused, int argc,
+					    char **argv, char **azColName),
+			     void *userdata, char **error);
+/* Reads the entries which were active between since and until (usec,
+   0 means no upper bound): closed sessions with Login <= until and
+   Logout >= since, open sessions as for wtmpdb_read_present. Newest
+   first. */
+extern int wtmpdb_read_overlap (const char *db_path, uint64_t since,
+				uint64_t until,
+				int (*cb_func)(void *unused, int argc,
+					       char **argv, char **azColName),
+				void *userdata, char **error);
+/* Reads the entries which were active at the time at (usec): logged
+   in before and logged out after it, or still open without a boot in
+   between. Newest first. */
+extern int wtmpdb_read_present (const char *db_path, uint64_t at,
+				int (*cb_func)(void *unused, int argc,
+					       char **argv, char **azColName),
+				void *userdata, char **error);
+/* Reads the open sessions since the last boot, newest first */
+extern int wtmpdb_read_current (const char *db_path,
+				int (*cb_func)(void *unused, int argc,
+					       char **argv, char **azColName),
+				void *userdata, char **error);
+/* Creates (enable != 0) or removes the daily rollup of sessions per
+   UTC day, user and service, which is updated with every login and
+   logout and used by wtmpdb_report if possible. Works always on the database
+   file, also if wtmpdbd is running. */
+extern int wtmpdb_rollup (const char *db_path, int enable, char **error);
+/* Converts the database to (enable != 0) or back from a layout,
+   which stores every user, tty, host and service name only once.
+   The old layout is still readable as view. Like wtmpdb_rollup,
+   works always on the database file. */
+extern int wtmpdb_intern (const char *db_path, int enable, char **error);
+/* Brings the schema of the database to the newest version. Short
+   steps run with every write access already, this runs the long
+   ones, too, which block all writers until they are done. Returns
+   the schema version, < 0 on failure. Works always on the database
+   file. */
+extern int wtmpdb_migrate (const char *db_path, char **error);
+/* Groups for wtmpdb_report */
+#define WTMPDB_REPORT_USER    0
+#define WTMPDB_REPORT_HOST    1
+#define WTMPDB_REPORT_SERVICE 2
+#define WTMPDB_REPORT_TTY     3
+#define WTMPDB_REPORT_DAY     4  /* local time, YYYY-MM-DD */
+#define WTMPDB_REPORT_HOUR    5  /* local time, YYYY-MM-DD HH:00 */
+/* Aggregates the sessions with a login between since and until (usec,
+   0 means no limit), cb_func gets the columns Key, Sessions, Seconds,
+   Users and Hosts. Groups of users, hosts, services and ttys are
+   sorted by the number of sessions, limit > 0 returns only the top
+   entries. Days and hours are sorted by time. */
+extern int wtmpdb_report (const char *db_path, int group_by,
+			  uint64_t since, uint64_t until, unsigned int limit,
+			  int (*cb_func)(void *unused, int argc,
+					 char **argv, char **azColName),
+			  void *userdata, char **error);
+/* Computes the peak number of concurrent sessions per bucket of
+   bucket usec between since and until (usec, 0 means from the first
+   login and until now) in one pass over the entries. Buckets are
+   aligned to multiples of their size since the epoch, so hours are
+   full UTC hours. cb_func gets the columns Start (usec), Peak and
+   Sessions, the number of sessions active in the bucket, for every
+   bucket in time order, a return value != 0 stops. Open sessions end
+   with the next boot. */
+extern int wtmpdb_concurrency (const char *db_path, uint64_t since,
+			       uint64_t until, uint64_t bucket,
+			       int (*cb_func)(void *unused, int argc,
+					      char **argv, char **azColName),
+			       void *userdata, char **error);
 extern int wtmpdb_rotate (const char *db_path, const int days, char **error,
 			  char **wtmpdb_name, uint64_t *entries);
+/* progress_cb gets the number of moved and of all entries to move,
+   a return value != 0 aborts the rotation. */
+extern int wtmpdb_rotate_v2 (const char *db_path, const int days,
+			     int (*progress_cb) (void *userdata,
+						 uint64_t moved,
+						 uint64_t total),
+			     void *userdata, char **error,
+			     char **wtmpdb_name, uint64_t *entries);
 
 /* Returns last "BOOT_TIME" entry as usec */
 extern uint64_t wtmpdb_get_boottime (const char *db_path, char **error);
 
+/* Limit the time a call may block (database locks, varlink calls),
+   timeout in usec, 0 restores the defaults. Expired calls return
+   -EBUSY (database locked) or -ETIME (wtmpdbd did not answer). */
+extern void wtmpdb_set_timeout (uint64_t usec_timeout);
+
+/* Size of the memory mapping and the page cache in bytes for reading
+   the database, < 0 selects them from the file size (default), 0
+   disables the mapping or keeps the SQLite default cache size. */
+extern void wtmpdb_set_read_cache (int64_t mmap_size, int64_t cache_size);
+
+/* Keep the read-only database connection of the calling thread open
+   between calls (enable != 0), or close it (enable == 0). */
+extern void wtmpdb_reuse_connection (int enable);
+
+/* Number of retries on a locked database done by this process */
+extern uint64_t wtmpdb_get_busy_retries (void);
+
 /* helper function */
 extern int64_t wtmpdb_get_id (const char *db_path, const char *tty,
 			      char **error);
@@ -55,6 +55,55 @@ static int varlink_is_enforced = 0;
 
 #define VARLINK_IS_NOT_RUNNING(r) (r == -ECONNREFUSED || r == -ENOENT || r == -ECONNRESET || r == -EACCES)
 
+/*
+  Limit the time a single call may block: this covers waiting
+  for a locked database and the duration of varlink method calls.
+  timeout is in usec, 0 restores the defaults.
+ */
+void
+wtmpdb_set_timeout (uint64_t usec_timeout)
+{
+  sqlite_set_timeout (usec_timeout);
+#if WITH_WTMPDBD
+  varlink_set_timeout (usec_timeout);
+#endif
+}
+
+/*
+  Set the size of the memory mapping and of the page cache in bytes
+  used for reading the database. < 0 selects both from the size of
+  the database file, 0 disables the mapping or keeps the default
+  cache size of SQLite. Requests answered by wtmpdbd use the
+  settings of wtmpdbd.
+ */
+void
+wtmpdb_set_read_cache (int64_t mmap_size, int64_t cache_size)
+{
+  sqlite_set_read_cache (mmap_size, cache_size);
+}
+
+/*
+  Keep the read-only database connection of the calling thread open
+  between calls, so that only the first call opens the database and
+  parses the schema. enable == 0 closes it again, call this before
+  the thread exits.
+ */
+void
+wtmpdb_reuse_connection (int enable)
+{
+  sqlite_reuse_connection (enable);
+}
+
+/*
+  Returns how often this process had to wait for a locked
+  database since it was started.
+ */
+uint64_t
+wtmpdb_get_busy_retries (void)
+{
+  return sqlite_busy_retries ();
+}
+
 /*
   Add new wtmp entry to db.
   login timestamp is in usec.
@@ -168,7 +217,7 @@ wtmpdb_read_all (const char *db_path,
 #if WITH_WTMPDBD
       int r;
 
-      r = varlink_read_all (cb_func, NULL, error);
+      r = varlink_read_all (-1, 0, cb_func, NULL, error);
       if (r >= 0)
 	return r;
 
@@ -199,7 +248,7 @@ wtmpdb_read_all_v2 (const char *db_path,
 #if WITH_WTMPDBD
       int r;
 
-      r = varlink_read_all (cb_func, userdata, error);
+      r = varlink_read_all (-1, 0, cb_func, userdata, error);
       if (r >= 0)
 	return r;
 
@@ -219,13 +268,333 @@ wtmpdb_read_all_v2 (const char *db_path,
   return sqlite_read_all (db_path?db_path:_PATH_WTMPDB, cb_func, userdata, error);
 }
 
+/* Reads all entries with an ID larger than after_id, ordered by ID,
+   and calls the callback function for each entry.
+   Returns 0 on success, -1 on failure. */
+int
+wtmpdb_read_since_id (const char *db_path, int64_t after_id,
+		      int (*cb_func)(void *unused, int argc, char **argv,
+				     char **azColName),
+		      void *userdata, char **error)
+{
+  VARLINK_CHECKS
+    {
+#if WITH_WTMPDBD
+      int r;
+
+      r = varlink_read_all (after_id, 0, cb_func, userdata, error);
+      if (r >= 0)
+	return r;
+
+      if (VARLINK_IS_NOT_RUNNING(r))
+	{
+	  varlink_is_active = 0;
+	  if (error)
+	    *error = mfree (*error);
+	}
+      else
+	return r; /* return the error if wtmpdbd is active */
+#else
+      return -EPROTONOSUPPORT;
+#endif
+    }
+
+  return sqlite_read_since_id (db_path?db_path:_PATH_WTMPDB, after_id,
+			       cb_func, userdata, error);
+}
+
+/* Reads the entry with this ID and calls the callback function for
+   it. This is what wtmpdbd uses to complete its Logout events, so
+   the file is always used directly.
+   Returns 0 on success, also if there is no such entry, < 0 on
+   failure. */
+int
+wtmpdb_read_id (const char *db_path, int64_t id,
+		int (*cb_func)(void *unused, int argc, char **argv,
+			       char **azColName),
+		void *userdata, char **error)
+{
+  if (db_path != NULL && strcmp (db_path, "varlink") == 0)
+    return -EPROTONOSUPPORT;
 
-/* Reads all entries from database and calls the callback function for
-   each entry.
+  return sqlite_read_id (db_path?db_path:_PATH_WTMPDB, id,
+			 cb_func, userdata, error);
+}
+
+
+/* Reads at most limit entries, newest first ordered by Login and
+   ID, and calls the callback function for each entry. If before_id
+   is > 0, the page starts after the entry with this Login and ID,
+   which is the last entry of the previous page.
+   Returns 0 on success, < 0 on failure. */
+int
+wtmpdb_read_page (const char *db_path, uint64_t before_login,
+		  int64_t before_id, unsigned int limit,
+		  int (*cb_func)(void *unused, int argc, char **argv,
+				 char **azColName),
+		  void *userdata, char **error)
+{
+  VARLINK_CHECKS
+    {
+#if WITH_WTMPDBD
+      int r;
+
+      r = varlink_read_page (before_login, before_id, limit, cb_func,
+			     userdata, error);
+      if (r >= 0)
+	return r;
+
+      if (VARLINK_IS_NOT_RUNNING(r))
+	{
+	  varlink_is_active = 0;
+	  if (error)
+	    *error = mfree (*error);
+	}
+      else
+	return r; /* return the error if wtmpdbd is active */
+#else
+      return -EPROTONOSUPPORT;
+#endif
+    }
+
+  return sqlite_read_page (db_path?db_path:_PATH_WTMPDB, before_login,
+			   before_id, limit, cb_func, userdata, error);
+}
+
+/* Reads the entries which were active between since and until, usec,
+   newest first, and calls the callback function for each entry. until
+   0 means no upper bound.
+   Returns 0 on success, < 0 on failure. */
+int
+wtmpdb_read_overlap (const char *db_path, uint64_t since, uint64_t until,
+		     int (*cb_func)(void *unused, int argc, char **argv,
+				    char **azColName),
+		     void *userdata, char **error)
+{
+  VARLINK_CHECKS
+    {
+#if WITH_WTMPDBD
+      int r;
+
+      r = varlink_read_overlap (since, until, cb_func, userdata, error);
+      if (r >= 0)
+	return r;
+
+      if (VARLINK_IS_NOT_RUNNING(r))
+	{
+	  varlink_is_active = 0;
+	  if (error)
+	    *error = mfree (*error);
+	}
+      else
+	return r; /* return the error if wtmpdbd is active */
+#else
+      return -EPROTONOSUPPORT;
+#endif
+    }
+
+  return sqlite_read_overlap (db_path?db_path:_PATH_WTMPDB, since, until,
+			      cb_func, userdata, error);
+}
+
+/* Reads the entries which were active at the time at, usec, newest
+   first, and calls the callback function for each entry.
+   Returns 0 on success, < 0 on failure. */
+int
+wtmpdb_read_present (const char *db_path, uint64_t at,
+		     int (*cb_func)(void *unused, int argc, char **argv,
+				    char **azColName),
+		     void *userdata, char **error)
+{
+  VARLINK_CHECKS
+    {
+#if WITH_WTMPDBD
+      int r;
+
+      r = varlink_read_present (at, cb_func, userdata, error);
+      if (r >= 0)
+	return r;
+
+      if (VARLINK_IS_NOT_RUNNING(r))
+	{
+	  varlink_is_active = 0;
+	  if (error)
+	    *error = mfree (*error);
+	}
+      else
+	return r; /* return the error if wtmpdbd is active */
+#else
+      return -EPROTONOSUPPORT;
+#endif
+    }
+
+  return sqlite_read_present (db_path?db_path:_PATH_WTMPDB, at, cb_func,
+			      userdata, error);
+}
+
+/* Reads the sessions of the running system which are still open,
+   newest first, and calls the callback function for each entry.
+   Returns 0 on success, < 0 on failure. */
+int
+wtmpdb_read_current (const char *db_path,
+		     int (*cb_func)(void *unused, int argc, char **argv,
+				    char **azColName),
+		     void *userdata, char **error)
+{
+  VARLINK_CHECKS
+    {
+#if WITH_WTMPDBD
+      int r;
+
+      r = varlink_read_all (-1, 1, cb_func, userdata, error);
+      if (r >= 0)
+	return r;
+
+      if (VARLINK_IS_NOT_RUNNING(r))
+	{
+	  varlink_is_active = 0;
+	  if (error)
+	    *error = mfree (*error);
+	}
+      else
+	return r; /* return the error if wtmpdbd is active */
+#else
+      return -EPROTONOSUPPORT;
+#endif
+    }
+
+  return sqlite_read_current (db_path?db_path:_PATH_WTMPDB,
+			      cb_func, userdata, error);
+}
+
+/* Enables or disables the daily rollup. This changes the schema of
+   the database, which wtmpdbd does not do for clients, so the file
+   is always used directly.
+   Returns 0 on success, < 0 on failure. */
+int
+wtmpdb_rollup (const char *db_path, int enable, char **error)
+{
+  if (db_path != NULL && strcmp (db_path, "varlink") == 0)
+    return -EPROTONOSUPPORT;
+
+  return sqlite_rollup (db_path?db_path:_PATH_WTMPDB, enable, error);
+}
+
+/* Converts the database to or from interned strings, the same as
+   for wtmpdb_rollup applies.
+   Returns 0 on success, < 0 on failure. */
+int
+wtmpdb_intern (const char *db_path, int enable, char **error)
+{
+  if (db_path != NULL && strcmp (db_path, "varlink") == 0)
+    return -EPROTONOSUPPORT;
+
+  return sqlite_intern (db_path?db_path:_PATH_WTMPDB, enable, error);
+}
+
+/* Runs all schema migrations, the same as for wtmpdb_rollup
+   applies.
+   Returns the schema version on success, < 0 on failure. */
+int
+wtmpdb_migrate (const char *db_path, char **error)
+{
+  if (db_path != NULL && strcmp (db_path, "varlink") == 0)
+    return -EPROTONOSUPPORT;
+
+  return sqlite_migrate (db_path?db_path:_PATH_WTMPDB, error);
+}
+
+/* Runs an aggregation over the sessions, see wtmpdb.h.
+   Returns 0 on success, < 0 on failure. */
+int
+wtmpdb_report (const char *db_path, int group_by,
+	       uint64_t since, uint64_t until, unsigned int limit,
+	       int (*cb_func)(void *unused, int argc, char **argv,
+			      char **azColName),
+	       void *userdata, char **error)
+{
+  VARLINK_CHECKS
+    {
+#if WITH_WTMPDBD
+      int r;
+
+      r = varlink_report (group_by, since, until, limit,
+			  cb_func, userdata, error);
+      if (r >= 0)
+	return r;
+
+      if (VARLINK_IS_NOT_RUNNING(r))
+	{
+	  varlink_is_active = 0;
+	  if (error)
+	    *error = mfree (*error);
+	}
+      else
+	return r; /* return the error if wtmpdbd is active */
+#else
+      return -EPROTONOSUPPORT;
+#endif
+    }
+
+  return sqlite_report (db_path?db_path:_PATH_WTMPDB, group_by, since, until,
+			limit, cb_func, userdata, error);
+}
+
+/* Computes the concurrent sessions per time bucket, see wtmpdb.h.
+   Returns 0 on success, < 0 on failure. */
+int
+wtmpdb_concurrency (const char *db_path, uint64_t since, uint64_t until,
+		    uint64_t bucket,
+		    int (*cb_func)(void *unused, int argc, char **argv,
+				   char **azColName),
+		    void *userdata, char **error)
+{
+  VARLINK_CHECKS
+    {
+#if WITH_WTMPDBD
+      int r;
+
+      r = varlink_concurrency (since, until, bucket, cb_func, userdata, error);
+      if (r >= 0)
+	return r;
+
+      if (VARLINK_IS_NOT_RUNNING(r))
+	{
+	  varlink_is_active = 0;
+	  if (error)
+	    *error = mfree (*error);
+	}
+      else
+	return r; /* return the error if wtmpdbd is active */
+#else
+      return -EPROTONOSUPPORT;
+#endif
+    }
+
+  return sqlite_concurrency (db_path?db_path:_PATH_WTMPDB, since, until,
+			     bucket, cb_func, userdata, error);
+}
+
+/* Moves all entries older than days into a new database.
    Returns 0 on success, < 0 on failure. */
 int
 wtmpdb_rotate (const char *db_path, const int days, char **error,
 	       char **wtmpdb_name, uint64_t *entries)
+{
+  return wtmpdb_rotate_v2 (db_path, days, NULL, NULL, error,
+			   wtmpdb_name, entries);
+}
+
+/* Like wtmpdb_rotate, but calls progress_cb after every moved batch
+   of entries. progress_cb is not called if the request is handled
+   by wtmpdbd.
+   Returns 0 on success, < 0 on failure. */
+int
+wtmpdb_rotate_v2 (const char *db_path, const int days,
+		  int (*progress_cb)(void *userdata, uint64_t moved,
+				     uint64_t total),
+		  void *userdata, char **error,
+		  char **wtmpdb_name, uint64_t *entries)
 {
   VARLINK_CHECKS
     {
@@ -249,7 +618,8 @@ wtmpdb_rotate (const char *db_path, const int days, char **error,
 #endif
     }
 
-  return sqlite_rotate (db_path?db_path:_PATH_WTMPDB, days, wtmpdb_name, entries, error);
+  return sqlite_rotate (db_path?db_path:_PATH_WTMPDB, days, wtmpdb_name,
+			entries, progress_cb, userdata, error);
 }
 
 /* returns boottime entry on success or 0 in error case */
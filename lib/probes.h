@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+/* Static USDT probes for SystemTap and bpftrace, enabled with
+   "meson setup -Dusdt=enabled". The provider is always "wtmpdb",
+   durations are in usec, a negative result is an error:
+
+   libwtmpdb:
+     sqlite_open(path, rw, usec, result)
+     sqlite_busy(count, delay_msec)
+     sqlite_login(id, usec)
+     sqlite_logout(id, result, usec)
+     search_id(tty, id, rows, usec)
+     sqlite_read_all(result, rows, usec)
+     sqlite_rotate(days, result, rows, usec)
+     varlink_connect(socket, result, usec)
+     varlink_call(method, result, usec)
+
+   wtmpdbd:
+     method_start(method)
+     method_done(method, result, rows, payload_bytes, usec)
+
+   The sqlite_* durations include sqlite_open and all sqlite_busy
+   waits, so e.g.
+   bpftrace -e 'usdt:/usr/lib64/libwtmpdb.so.0:wtmpdb:sqlite_login { @ = hist(arg1); }'
+   shows the login latency without rebuilding anything.
+
+   Without USDT support the probes and their arguments compile to
+   nothing, the arguments are only type checked. */
+
+#include <stdint.h>
+#include <time.h>
+
+#include "basics.h"
+
+#if HAVE_USDT
+
+#include <sys/sdt.h>
+
+#define PROBE(name, ...) STAP_PROBEV(wtmpdb, name, __VA_ARGS__)
+
+static inline uint64_t
+probe_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+}
+
+#else
+
+static inline void
+probe_args (int _unused_(dummy), ...)
+{
+}
+
+#define PROBE(name, ...) do { if (0) probe_args (0, __VA_ARGS__); } while (0)
+
+static inline uint64_t
+probe_now (void)
+{
+  return 0;
+}
+
+#endif
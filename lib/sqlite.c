@@ -27,7 +27,9 @@
 
 #include "config.h"
 
+#include <ctype.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,515 +37,2945 @@
 #include <libgen.h>
 #include <string.h>
 #include <limits.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sqlite3.h>
 
 #include "wtmpdb.h"
 #include "sqlite.h"
 #include "mkdir_p.h"
+#include "basics.h"
+#include "probes.h"
 
 #define TIMEOUT 5000 /* 5 sec */
 
+static int busy_timeout = TIMEOUT;
+
+/* Set the maximal time in usec to wait for a locked database,
+   0 restores the default. */
+void
+sqlite_set_timeout (uint64_t usec_timeout)
+{
+  if (usec_timeout == 0)
+    busy_timeout = TIMEOUT;
+  else if (usec_timeout / 1000 > INT_MAX)
+    busy_timeout = INT_MAX;
+  else
+    busy_timeout = usec_timeout / 1000;
+}
+
+/* Read-only connections map the database file into memory, so
+   scans read the pages directly from the page cache of the kernel
+   instead of copying every page with a read() call. Files smaller
+   than AUTO_MMAP_MIN are read faster than they are mapped. */
+#define AUTO_MMAP_MIN (1024 * 1024)
+/* Upper limit of the automatic page cache of a connection, which is
+   only filled if the file is larger than the mapping. */
+#define AUTO_CACHE_MAX (16 * 1024 * 1024)
+
+static int64_t read_mmap_size = -1;
+static int64_t read_cache_size = -1;
+
+/* Set the mmap_size and cache_size in bytes of read-only
+   connections, < 0 selects them from the file size, 0 disables
+   the mapping or keeps the default cache size of SQLite. */
+void
+sqlite_set_read_cache (int64_t mmap_size, int64_t cache_size)
+{
+  read_mmap_size = mmap_size;
+  read_cache_size = cache_size;
+}
+
+static void
+set_read_cache (sqlite3 *db, off_t file_size)
+{
+  int64_t mmap_size = read_mmap_size;
+  int64_t cache_size = read_cache_size;
+  char sql[128];
+
+  if (mmap_size < 0)
+    /* leave room for entries added while reading */
+    mmap_size = file_size < AUTO_MMAP_MIN ? 0 :
+      (file_size / AUTO_MMAP_MIN + 2) * AUTO_MMAP_MIN;
+  if (cache_size < 0)
+    cache_size = file_size > AUTO_CACHE_MAX ? AUTO_CACHE_MAX : 0;
+
+  /* Tuning only, SQLite limits the mapping to SQLITE_MAX_MMAP_SIZE
+     and reads without it if mapping fails. */
+  if (mmap_size > 0)
+    {
+      snprintf (sql, sizeof (sql), "PRAGMA mmap_size = %lld",
+		(long long int)mmap_size);
+      sqlite3_exec (db, sql, NULL, NULL, NULL);
+    }
+  /* negative values are KiB instead of pages */
+  if (cache_size > 0)
+    {
+      snprintf (sql, sizeof (sql), "PRAGMA cache_size = -%lld",
+		(long long int)(cache_size / 1024 + (cache_size % 1024 != 0)));
+      sqlite3_exec (db, sql, NULL, NULL, NULL);
+    }
+}
+
+static uint64_t busy_retries = 0;
+
+uint64_t
+sqlite_busy_retries (void)
+{
+  return __atomic_load_n (&busy_retries, __ATOMIC_RELAXED);
+}
+
+/* End of the time a library call may wait for locks, in msec of
+   CLOCK_MONOTONIC. A call can wait several times, e.g. for the
+   schema version, at BEGIN and at INSERT, so the timeout is not per
+   wait but for all of them together. */
+static __thread uint64_t busy_deadline = 0;
+
+static uint64_t
+busy_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000 + (uint64_t) ts.tv_nsec / 1000000;
+}
+
+/* Starts the timeout of a library call. */
+static void
+busy_start (void)
+{
+  busy_deadline = busy_now () + busy_timeout;
+}
+
+/* Same delays as the sqlite3_busy_timeout() handler, but up to the
+   deadline of the call, and counts how often we had to wait for a
+   locked database. */
+static int
+busy_handler (void _unused_(*data), int count)
+{
+  static const int delays[] = { 1, 2, 5, 10, 15, 20, 25, 25, 25, 50, 50, 100 };
+  const int ndelay = sizeof (delays) / sizeof (delays[0]);
+  uint64_t now = busy_now ();
+  int delay;
+
+  if (now >= busy_deadline)
+    return 0;
+
+  delay = delays[count < ndelay ? count : ndelay - 1];
+  if (now + delay > busy_deadline)
+    delay = busy_deadline - now;
+
+  __atomic_add_fetch (&busy_retries, 1, __ATOMIC_RELAXED);
+  PROBE(sqlite_busy, count, delay);
+  usleep (delay * 1000);
+
+  return 1;
+}
+
+/* Statement profiling, enabled with WTMPDB_PROFILE=1 (summary on
+   stderr) or WTMPDB_PROFILE=/path/to/file (summary appended to
+   the file). The summary is written when the library gets unloaded,
+   for wtmpdbd this means into the journal. Statements are grouped
+   by their SQL text with the parameters unexpanded. The time sqlite
+   reports has only msec resolution, so we measure from the first
+   step to the end of every run ourselves. */
+struct profile_entry {
+  char *sql;
+  uint64_t calls;
+  uint64_t nsec;
+  uint64_t rows;
+  uint64_t fullscan_steps;
+  uint64_t sorts;
+  uint64_t autoindexes;
+  uint64_t vm_steps;
+};
+
+static pthread_once_t profile_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+static const char *profile_dest = NULL;
+static struct profile_entry *profile = NULL;
+static size_t profile_len = 0;
+
+/* Statements running in this thread, more than one only if a
+   callback of sqlite3_exec runs other statements. */
+#define PROFILE_DEPTH 8
+static __thread struct {
+  sqlite3_stmt *stmt;
+  uint64_t start;
+} profile_running[PROFILE_DEPTH];
+static __thread size_t profile_depth = 0;
+
+static uint64_t
+profile_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+/* Returns the nsec since the statement started, sqlite's estimate
+   if we missed the start. */
+static uint64_t
+profile_elapsed (sqlite3_stmt *stmt, uint64_t estimate)
+{
+  for (size_t i = profile_depth; i > 0; i--)
+    if (profile_running[i - 1].stmt == stmt)
+      {
+	uint64_t start = profile_running[i - 1].start;
+
+	profile_depth = i - 1;
+	return profile_now () - start;
+      }
+
+  return estimate;
+}
+
+static void
+profile_init (void)
+{
+  const char *env = secure_getenv ("WTMPDB_PROFILE");
+
+  if (env && *env && strcmp (env, "0") != 0)
+    profile_dest = env;
+}
+
+/* Returns the entry for sql, NULL if out of memory.
+   Must be called with profile_lock held. */
+static struct profile_entry *
+profile_find (const char *sql)
+{
+  struct profile_entry *tmp;
+
+  for (size_t i = 0; i < profile_len; i++)
+    if (strcmp (profile[i].sql, sql) == 0)
+      return &profile[i];
+
+  tmp = realloc (profile, (profile_len + 1) * sizeof (*profile));
+  if (tmp == NULL)
+    return NULL;
+  profile = tmp;
+  tmp = &profile[profile_len];
+  memset (tmp, 0, sizeof (*tmp));
+  if ((tmp->sql = strdup (sql)) == NULL)
+    return NULL;
+  profile_len++;
+
+  return tmp;
+}
+
+static int
+profile_cb (unsigned int type, void _unused_(*ctx), void *p, void *x)
+{
+  sqlite3_stmt *stmt = p;
+  const char *sql = sqlite3_sql (stmt);
+  struct profile_entry *e;
+  uint64_t nsec = 0;
+
+  if (type == SQLITE_TRACE_STMT)
+    {
+      /* triggers report their start, too */
+      if (strncmp (x, "--", 2) != 0 && profile_depth < PROFILE_DEPTH)
+	{
+	  profile_running[profile_depth].stmt = stmt;
+	  profile_running[profile_depth].start = profile_now ();
+	  profile_depth++;
+	}
+      return 0;
+    }
+
+  if (type == SQLITE_TRACE_PROFILE)
+    nsec = profile_elapsed (stmt, *(sqlite3_int64 *) x);
+
+  if (sql == NULL)
+    return 0;
+
+  pthread_mutex_lock (&profile_lock);
+  if ((e = profile_find (sql)) != NULL)
+    {
+      if (type == SQLITE_TRACE_ROW)
+	e->rows++;
+      else
+	{
+	  /* every run resets the counters, so they are per run */
+	  e->calls++;
+	  e->nsec += nsec;
+	  e->fullscan_steps += sqlite3_stmt_status (stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+	  e->sorts += sqlite3_stmt_status (stmt, SQLITE_STMTSTATUS_SORT, 1);
+	  e->autoindexes += sqlite3_stmt_status (stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+	  e->vm_steps += sqlite3_stmt_status (stmt, SQLITE_STMTSTATUS_VM_STEP, 1);
+	}
+    }
+  pthread_mutex_unlock (&profile_lock);
+
+  return 0;
+}
+
+static void
+profile_attach (sqlite3 *db)
+{
+  pthread_once (&profile_once, profile_init);
+
+  if (profile_dest)
+    sqlite3_trace_v2 (db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE |
+		      SQLITE_TRACE_ROW, profile_cb, NULL);
+}
+
+static int
+profile_cmp (const void *a, const void *b)
+{
+  const struct profile_entry *pa = a;
+  const struct profile_entry *pb = b;
+
+  return pa->nsec < pb->nsec ? 1 : pa->nsec > pb->nsec ? -1 : 0;
+}
+
+/* Prints the statement on one line. */
+static void
+profile_print_sql (FILE *fp, const char *sql)
+{
+  int space = 0;
+
+  for (; *sql; sql++)
+    if (isspace ((unsigned char) *sql))
+      space = 1;
+    else
+      {
+	if (space)
+	  fputc (' ', fp);
+	space = 0;
+	fputc (*sql, fp);
+      }
+  fputc ('\n', fp);
+}
+
+/* Writes the statements with the most time spent first. */
+static void __attribute__((destructor))
+profile_dump (void)
+{
+  FILE *fp = stderr;
+
+  if (profile_len == 0)
+    return;
+
+  if (profile_dest[0] == '/' && (fp = fopen (profile_dest, "ae")) == NULL)
+    fp = stderr;
+
+  qsort (profile, profile_len, sizeof (*profile), profile_cmp);
+
+  fprintf (fp, "wtmpdb profile of pid %ld:\n", (long) getpid ());
+  fprintf (fp, "%8s %10s %9s %9s %9s %6s %6s %10s  %s\n",
+	   "calls", "total_ms", "avg_us", "rows", "fullscan",
+	   "sorts", "autoix", "vm_steps", "statement");
+  for (size_t i = 0; i < profile_len; i++)
+    {
+      const struct profile_entry *e = &profile[i];
+
+      fprintf (fp, "%8" PRIu64 " %10.3f %9.1f %9" PRIu64 " %9" PRIu64
+	       " %6" PRIu64 " %6" PRIu64 " %10" PRIu64 " ",
+	       e->calls, e->nsec / 1e6,
+	       e->calls ? e->nsec / 1e3 / e->calls : 0.0,
+	       e->rows, e->fullscan_steps, e->sorts, e->autoindexes,
+	       e->vm_steps);
+      profile_print_sql (fp, e->sql);
+      free (e->sql);
+    }
+
+  if (fp != stderr)
+    fclose (fp);
+
+  profile = mfree (profile);
+  profile_len = 0;
+}
+
 static void
 strip_extension(char *in_str)
 {
     static const int name_min_len = 1;
     static const int max_ext_len = 4;
 
-    /* Check chars starting at end of string to find last '.' */
-    for (size_t i = strlen(in_str); i > (name_min_len + max_ext_len); i--)
+    /* Check chars starting at end of string to find last '.' */
+    for (size_t i = strlen(in_str); i > (name_min_len + max_ext_len); i--)
+    {
+        if (in_str[i] == '.')
+        {
+            in_str[i] = '\0';
+            return;
+        }
+    }
+}
+
+/* Returns 1 if the schema contains a table with this name, 0 if
+   not, < 0 on error. */
+static int
+has_table (sqlite3 *db, const char *name, char **error)
+{
+  int r;
+
+#if HAVE_SQLITE3_TABLE_COLUMN_METADATA
+  /* sqlite keeps the schema in memory once it has been read, which
+     saves the lock and the reads of a query on sqlite_master. */
+  r = sqlite3_table_column_metadata (db, NULL, name, NULL, NULL, NULL,
+				     NULL, NULL, NULL);
+  if (r == SQLITE_OK)
+    return 1;
+  if (r == SQLITE_ERROR)
+    return 0;
+#else
+  sqlite3_stmt *res;
+  char *sql = "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?";
+
+  /* reading the schema needs a lock, too */
+  if ((r = sqlite3_prepare_v2 (db, sql, -1, &res, 0)) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to prepare statement (has_table): %s",
+                      sqlite3_errmsg (db)) < 0)
+          *error = strdup ("has_table: Out of memory");
+      return r == SQLITE_BUSY ? -EBUSY : -1;
+    }
+
+  if (sqlite3_bind_text (res, 1, name, -1, SQLITE_STATIC) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to create search query for '%s': %s",
+                      name, sqlite3_errmsg (db)) < 0)
+          *error = strdup ("has_table: Out of memory");
+      sqlite3_finalize (res);
+      return -1;
+    }
+
+  r = sqlite3_step (res);
+  sqlite3_finalize (res);
+
+  if (r == SQLITE_ROW)
+    return 1;
+  if (r == SQLITE_DONE)
+    return 0;
+#endif
+
+  if (error)
+    if (asprintf (error, "Searching table '%s' failed: %s", name,
+		  sqlite3_errstr (r)) < 0)
+      *error = strdup ("has_table: Out of memory");
+  return r == SQLITE_BUSY ? -EBUSY : -1;
+}
+
+/* With interned strings, wtmp is a view on wtmp_data and the
+   lookup tables, see sqlite_intern. */
+#define is_interned(db, error) has_table (db, "wtmp_data", error)
+
+#define SQL_WTMP_TABLE \
+  "CREATE TABLE IF NOT EXISTS wtmp(ID INTEGER PRIMARY KEY, Type INTEGER, User TEXT NOT NULL, Login INTEGER, Logout INTEGER, TTY TEXT, RemoteHost TEXT, Service TEXT) STRICT;"
+
+/* wtmp_open contains only sessions without logout time, which
+   are few compared to the whole history. */
+#define SQL_OPEN_INDEX(table) \
+  "CREATE INDEX IF NOT EXISTS wtmp_open ON " table "(Login) WHERE Logout IS NULL"
+
+/* Creates the table if it does not exist.
+ * Returns 0 on success, -EBUSY if the database is locked,
+ * -1 on other failures. */
+static int64_t
+create_table (sqlite3 *db, char **error)
+{
+  char *err_msg = NULL;
+  int r;
+
+  r = is_interned (db, error);
+  if (r != 0)
+    return r < 0 ? r : 0;
+
+  if ((r = sqlite3_exec (db, SQL_WTMP_TABLE, 0, 0, &err_msg)) != SQLITE_OK)
+    {
+      if (error)
+	if (asprintf (error, "SQL error creating table: %s", err_msg) < 0)
+	  *error = strdup ("create_table: Out of memory");
+      sqlite3_free (err_msg);
+
+      return r == SQLITE_BUSY ? -EBUSY : -1;
+    }
+  return 0;
+}
+
+static int
+exec_sql (sqlite3 *db, const char *sql, const char *what, char **error)
+{
+  char *err_msg = NULL;
+  int r;
+
+  if ((r = sqlite3_exec (db, sql, 0, 0, &err_msg)) != SQLITE_OK)
+    {
+      if (error)
+	if (asprintf (error, "SQL error %s: %s", what, err_msg) < 0)
+	  *error = strdup ("exec_sql: Out of memory");
+      sqlite3_free (err_msg);
+      return r == SQLITE_BUSY ? -EBUSY : -1;
+    }
+  return 0;
+}
+
+/* Runs a query with one integer result.
+   Returns 1 and sets *value if there is a row, 0 if not, < 0 on
+   error. */
+static int
+query_int64 (sqlite3 *db, const char *sql, int64_t *value, char **error)
+{
+  sqlite3_stmt *res;
+  int r;
+
+  if ((r = sqlite3_prepare_v2 (db, sql, -1, &res, 0)) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to prepare statement %s: %s",
+                      sql, sqlite3_errmsg (db)) < 0)
+          *error = strdup ("query_int64: Out of memory");
+      return r == SQLITE_BUSY ? -EBUSY : -1;
+    }
+
+  r = sqlite3_step (res);
+  if (r == SQLITE_ROW)
+    *value = sqlite3_column_int64 (res, 0);
+  sqlite3_finalize (res);
+
+  if (r == SQLITE_ROW)
+    return 1;
+  if (r == SQLITE_DONE)
+    return 0;
+
+  if (error)
+    if (asprintf (error, "Error in %s: %s", sql, sqlite3_errstr (r)) < 0)
+      *error = strdup ("query_int64: Out of memory");
+  return r == SQLITE_BUSY ? -EBUSY : -1;
+}
+
+/* Schema versions, stored as PRAGMA user_version:
+   0: no version, created by old releases
+   1: wtmp with the index of open sessions
+   2: index of the login time
+   3: index of the session length class
+   4: WAL journal mode
+   Every version must keep wtmp readable with the same columns, as
+   table or view, so that readers of any release work with it.
+   Writers refuse a newer schema, as they do not know its rules. */
+#define SCHEMA_VERSION 4
+
+struct migration {
+  int version;
+  /* Changes the schema. Runs in the transaction, which sets the new
+     version, or which defers the rest to finish. Returns 1 if there
+     is nothing left for finish. */
+  int (*apply) (sqlite3 *db, char **error);
+  /* If not NULL, the part of the migration which is too expensive
+     for a login, e.g. indexing a large table. It runs later in one
+     transaction of its own, which blocks all writers, so only
+     "wtmpdb migrate" does it. */
+  int (*finish) (sqlite3 *db, char **error);
+  /* apply cannot run in a transaction, e.g. a change of the journal
+     mode. It runs before the transaction setting the version then,
+     so it must not hurt if others run it at the same time. Returns
+     0 if it could not be done now. */
+  int outside;
+};
+
+/* Creating an index sorts the whole table and blocks all writers
+   meanwhile, SQLite cannot build it in steps. So only small
+   databases get it with the next login, larger ones only from
+   "wtmpdb migrate", when the administrator accepts the wait. */
+#define MIGRATION_INDEX_ROWS 100000
+
+/* wtmp_login makes reading a page of the history a range seek. */
+#define SQL_LOGIN_INDEX(table) \
+  "CREATE INDEX IF NOT EXISTS wtmp_login ON " table "(Login)"
+
+/* wtmp_span groups the closed sessions by the number of decimal
+   digits of their length in usec, and orders them by Login within
+   every class. A session of class k which overlaps a time range
+   logged in less than 10^k usec before its start, so an overlap
+   query is one short range seek per class, even if some sessions
+   last for weeks. */
+#define SPAN_CLASS "length(Logout - Login)"
+#define SPAN_CLASSES 20 /* "-" and 19 digits of int64_t */
+#define SQL_SPAN_INDEX(table) \
+  "CREATE INDEX IF NOT EXISTS wtmp_span ON " table "(" SPAN_CLASS ", Login) " \
+  "WHERE Logout IS NOT NULL"
+
+static int
+create_index (sqlite3 *db, const char *sql_plain, const char *sql_interned,
+	      char **error)
+{
+  int r = is_interned (db, error);
+
+  if (r < 0)
+    return r;
+  return exec_sql (db, r ? sql_interned : sql_plain, "creating index", error);
+}
+
+/* Returns 1 if the database is small enough to create an index
+   immediately, else 0. */
+static int
+is_small_database (sqlite3 *db, char **error)
+{
+  int64_t rows = 0;
+  int r;
+
+  if ((r = is_interned (db, error)) < 0)
+    return r;
+  /* the IDs are nearly dense, MAX(ID) costs no scan */
+  r = query_int64 (db, r ? "SELECT IFNULL(MAX(ID), 0) FROM wtmp_data" :
+		   "SELECT IFNULL(MAX(ID), 0) FROM wtmp", &rows, error);
+  if (r < 0)
+    return r;
+  return rows <= MIGRATION_INDEX_ROWS;
+}
+
+static int
+create_open_index (sqlite3 *db, char **error)
+{
+  return create_index (db, SQL_OPEN_INDEX ("wtmp"),
+		       SQL_OPEN_INDEX ("wtmp_data"), error);
+}
+
+/* A database of an old release has the table, but not the index. */
+static int
+migration_create_table (sqlite3 *db, char **error)
+{
+  int r = create_table (db, error);
+
+  if (r >= 0)
+    r = is_small_database (db, error);
+  if (r <= 0)
+    return r;
+  r = create_open_index (db, error);
+  return r < 0 ? r : 1;
+}
+
+static int
+create_login_index (sqlite3 *db, char **error)
+{
+  return create_index (db, SQL_LOGIN_INDEX ("wtmp"),
+		       SQL_LOGIN_INDEX ("wtmp_data"), error);
+}
+
+static int
+migration_login_index (sqlite3 *db, char **error)
+{
+  int r = is_small_database (db, error);
+
+  if (r <= 0)
+    return r;
+  r = create_login_index (db, error);
+  return r < 0 ? r : 1;
+}
+
+static int
+create_span_index (sqlite3 *db, char **error)
+{
+  return create_index (db, SQL_SPAN_INDEX ("wtmp"),
+		       SQL_SPAN_INDEX ("wtmp_data"), error);
+}
+
+static int
+migration_span_index (sqlite3 *db, char **error)
+{
+  int r = is_small_database (db, error);
+
+  if (r <= 0)
+    return r;
+  r = create_span_index (db, error);
+  return r < 0 ? r : 1;
+}
+
+/* In WAL mode a writer neither waits for the readers nor they for
+   it, so a login does not fail because of a slow "last" or report.
+   The mode is stored in the database file. It needs a lock without
+   any reader, which the caller may not get, then it stays for the
+   next one. If the file system has no shared memory for WAL, the
+   old mode stays, too, but the version is set. */
+static int
+migration_wal (sqlite3 *db, char **error)
+{
+  sqlite3_stmt *res;
+  const char *sql = "PRAGMA journal_mode = WAL";
+  int r;
+
+  if (sqlite3_prepare_v2 (db, sql, -1, &res, 0) != SQLITE_OK)
+    {
+      if (error)
+	if (asprintf (error, "Failed to prepare statement %s: %s",
+		      sql, sqlite3_errmsg (db)) < 0)
+	  *error = strdup ("migration_wal: Out of memory");
+      return -1;
+    }
+  r = sqlite3_step (res);
+  sqlite3_finalize (res);
+
+  if (r == SQLITE_BUSY || r == SQLITE_LOCKED)
+    return 0;
+  if (r != SQLITE_ROW)
+    {
+      if (error)
+	if (asprintf (error, "Error in %s: %s", sql, sqlite3_errstr (r)) < 0)
+	  *error = strdup ("migration_wal: Out of memory");
+      return -1;
+    }
+  return 1;
+}
+
+static const struct migration migrations[] = {
+  { 1, migration_create_table, create_open_index, 0 },
+  { 2, migration_login_index, create_login_index, 0 },
+  { 3, migration_span_index, create_span_index, 0 },
+  { 4, migration_wal, NULL, 1 },
+};
+
+/* Version of a migration waiting for its finish step, the table
+   exists only while one is waiting. */
+#define SQL_MIGRATION_TABLE \
+  "CREATE TABLE wtmp_migration(Version INTEGER PRIMARY KEY) STRICT"
+
+/* Returns the schema version of the database, -ENOTSUP if it is
+   newer than this code, < 0 on other errors. */
+static int
+schema_version (sqlite3 *db, char **error)
+{
+  int64_t version = 0;
+  int r;
+
+  r = query_int64 (db, "PRAGMA user_version", &version, error);
+  if (r < 0)
+    return r;
+
+  if (version > SCHEMA_VERSION)
+    {
+      if (error)
+	if (asprintf (error, "Database schema version %" PRId64 " is newer than supported version %d",
+		      version, SCHEMA_VERSION) < 0)
+	  *error = strdup ("migrate: Out of memory");
+      return -ENOTSUP;
+    }
+  return version;
+}
+
+/* Returns 1 if the migration to version waits for its finish
+   step, 0 if not, < 0 on error. */
+static int
+migration_pending (sqlite3 *db, int version, char **error)
+{
+  int64_t count = 0;
+  char sql[80];
+  int r;
+
+  r = has_table (db, "wtmp_migration", error);
+  if (r <= 0)
+    return r;
+
+  snprintf (sql, sizeof (sql),
+	    "SELECT COUNT(*) FROM wtmp_migration WHERE Version = %d", version);
+  r = query_int64 (db, sql, &count, error);
+  return r < 0 ? r : count > 0;
+}
+
+/* Brings the database to the version of the migration, with
+   BEGIN IMMEDIATE everybody else waits meanwhile. The finish step
+   only runs if run_finish is not 0.
+   Returns 1 if the version is reached, 0 if the finish step is
+   pending, < 0 on failure. */
+static int
+migrate_step (sqlite3 *db, const struct migration *m, int run_finish,
+	      char **error)
+{
+  char sql[160];
+  int r;
+
+  if (m->outside)
+    {
+      /* a login does not wait for all readers, the next one tries again */
+      if (!run_finish)
+	sqlite3_busy_handler (db, NULL, NULL);
+      r = m->apply (db, error);
+      if (!run_finish)
+	sqlite3_busy_handler (db, busy_handler, NULL);
+      if (r <= 0)
+	return r;
+    }
+
+  if ((r = exec_sql (db, "BEGIN IMMEDIATE", "starting migration", error)) < 0)
+    return r;
+
+  /* somebody else could have been faster */
+  r = schema_version (db, error);
+  if (r >= 0 && r < m->version)
+    {
+      r = m->finish ? migration_pending (db, m->version, error) : 0;
+      if (r == 0)
+	{
+	  r = m->outside ? 1 : m->apply (db, error);
+	  if (r == 0 && m->finish)
+	    {
+	      snprintf (sql, sizeof (sql),
+			SQL_MIGRATION_TABLE "; INSERT INTO wtmp_migration VALUES (%d)",
+			m->version);
+	      r = exec_sql (db, sql, "deferring migration", error);
+	    }
+	  else if (r >= 0)
+	    {
+	      snprintf (sql, sizeof (sql), "PRAGMA user_version = %d", m->version);
+	      r = exec_sql (db, sql, "setting schema version", error);
+	      m = NULL; /* nothing to finish */
+	    }
+	}
+    }
+  else if (r >= m->version)
+    m = NULL;
+
+  if (r < 0)
+    {
+      sqlite3_exec (db, "ROLLBACK", 0, 0, NULL);
+      return r;
+    }
+  if ((r = exec_sql (db, "COMMIT", "committing migration", error)) < 0)
+    {
+      sqlite3_exec (db, "ROLLBACK", 0, 0, NULL);
+      return r;
+    }
+
+  if (m == NULL || m->finish == NULL)
+    return 1;
+  if (!run_finish)
+    return 0;
+
+  if ((r = exec_sql (db, "BEGIN IMMEDIATE", "finishing migration", error)) < 0)
+    return r;
+
+  /* read again, another process may have finished it */
+  r = migration_pending (db, m->version, error);
+  if (r > 0)
+    {
+      r = m->finish (db, error);
+      if (r >= 0)
+	{
+	  snprintf (sql, sizeof (sql),
+		    "DROP TABLE wtmp_migration; PRAGMA user_version = %d",
+		    m->version);
+	  r = exec_sql (db, sql, "finishing migration", error);
+	}
+    }
+
+  if (r < 0)
+    {
+      sqlite3_exec (db, "ROLLBACK", 0, 0, NULL);
+      return r;
+    }
+  if ((r = exec_sql (db, "COMMIT", "committing migration", error)) < 0)
+    {
+      sqlite3_exec (db, "ROLLBACK", 0, 0, NULL);
+      return r;
+    }
+  return 1;
+}
+
+/* Runs all migrations from the version of the database to
+   SCHEMA_VERSION. Every step is committed on its own, so an
+   interrupted migration continues with the next call. Finish steps
+   are only deferred if run_finish is 0, and later versions wait
+   for them.
+   Returns the schema version on success, < 0 on failure. */
+static int
+migrate (sqlite3 *db, int run_finish, char **error)
+{
+  int pending = 0;
+  int version;
+  int r;
+
+  /* The version and the schema are read with one lock, checking
+     for tables afterwards costs no I/O then. */
+  if ((r = exec_sql (db, "BEGIN", "reading schema version", error)) < 0)
+    return r;
+  version = schema_version (db, error);
+  if (version >= 0 && (r = is_interned (db, error)) < 0)
+    version = r;
+  /* A deferred migration stays pending until "wtmpdb migrate", all
+     other callers see that without taking the write lock. */
+  if (version >= 0 && version < SCHEMA_VERSION && !run_finish)
+    {
+      for (size_t i = 0; i < sizeof (migrations) / sizeof (migrations[0]); i++)
+	if (migrations[i].version > version)
+	  {
+	    if (migrations[i].finish &&
+		(r = migration_pending (db, migrations[i].version, error)) != 0)
+	      {
+		if (r < 0)
+		  version = r;
+		pending = 1;
+	      }
+	    break;
+	  }
+    }
+  sqlite3_exec (db, "COMMIT", 0, 0, NULL);
+  if (version < 0 || version == SCHEMA_VERSION || pending)
+    return version;
+
+  for (size_t i = 0; i < sizeof (migrations) / sizeof (migrations[0]); i++)
+    {
+      if (migrations[i].version <= version)
+	continue;
+
+      r = migrate_step (db, &migrations[i], run_finish, error);
+      if (r <= 0)
+	return r < 0 ? r : version;
+      version = migrations[i].version;
+    }
+
+  return version;
+}
+
+/* In WAL mode the last connection deletes the -wal and -shm files
+   on close, and a reader without write access to the directory,
+   e.g. "last" of a normal user, cannot create them again. So every
+   connection keeps them, a reader can use them read-only. The -wal
+   file gets truncated after a checkpoint, so that it does not keep
+   old pages for a database file created again under its name. */
+static void
+keep_wal_files (sqlite3 *db)
+{
+  int persist = 1;
+
+  sqlite3_file_control (db, "main", SQLITE_FCNTL_PERSIST_WAL, &persist);
+  sqlite3_exec (db, "PRAGMA journal_size_limit = 0", 0, 0, NULL);
+}
+
+/* Read-only connection of the calling thread, kept open between
+   calls if enabled with sqlite_reuse_connection(). "idle" is not used
+   by anybody, "in_use" is the connection described by path, dev, ino
+   and size while a call uses it. */
+static __thread struct {
+  int enabled;
+  sqlite3 *idle;
+  sqlite3 *in_use;
+  char *path;
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+} ro_conn;
+
+/* Keep the read-only connection of the calling thread open between
+   calls (enable != 0), or close it (enable == 0). */
+void
+sqlite_reuse_connection (int enable)
+{
+  if (ro_conn.idle)
+    sqlite3_close (ro_conn.idle);
+  ro_conn.idle = NULL;
+  ro_conn.in_use = NULL;
+  free (ro_conn.path);
+  ro_conn.path = NULL;
+  ro_conn.enabled = enable;
+}
+
+/* Returns the idle connection of the thread if it still belongs to
+   the file at path, else closes it. */
+static sqlite3 *
+reuse_database_ro (const char *path, const struct stat *statbuf)
+{
+  sqlite3 *db = ro_conn.idle;
+
+  if (db == NULL)
+    return NULL;
+  ro_conn.idle = NULL;
+
+  /* the file was replaced or another database is requested */
+  if (strcmp (path, ro_conn.path) != 0 ||
+      statbuf->st_dev != ro_conn.dev || statbuf->st_ino != ro_conn.ino)
+    {
+      sqlite3_close (db);
+      return NULL;
+    }
+
+  if (statbuf->st_size != ro_conn.size)
+    {
+      set_read_cache (db, statbuf->st_size);
+      ro_conn.size = statbuf->st_size;
+    }
+  ro_conn.in_use = db;
+
+  return db;
+}
+
+/* Remember which file db belongs to, so that it can be reused. */
+static void
+track_database_ro (sqlite3 *db, const char *path, const struct stat *statbuf)
+{
+  if (ro_conn.in_use != NULL)
+    return;
+
+  if (ro_conn.path == NULL || strcmp (path, ro_conn.path) != 0)
+    {
+      char *p = strdup (path);
+
+      if (p == NULL)
+	return;
+      free (ro_conn.path);
+      ro_conn.path = p;
+    }
+  ro_conn.dev = statbuf->st_dev;
+  ro_conn.ino = statbuf->st_ino;
+  ro_conn.size = statbuf->st_size;
+  ro_conn.in_use = db;
+}
+
+static int
+open_database_ro (const char *path, sqlite3 **db, char **error)
+{
+  uint64_t start = probe_now ();
+  struct stat statbuf;
+  int empty_file;
+  int r;
+
+  busy_start ();
+
+  if (stat(path, &statbuf) != 0)
+    statbuf.st_size = -1;
+  empty_file = statbuf.st_size == 0;
+
+  if (ro_conn.enabled && statbuf.st_size > 0 &&
+      (*db = reuse_database_ro (path, &statbuf)) != NULL)
+    {
+      PROBE(sqlite_open, path, 0, probe_now () - start, 0);
+      return 0;
+    }
+
+  r = sqlite3_open_v2 (path, db, empty_file ?
+                       SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY :
+                       SQLITE_OPEN_READONLY, NULL);
+  if (r != SQLITE_OK)
+    {
+      if (error)
+	if (asprintf(error, "Cannot open database (%s) read-only: %s",
+		     path, sqlite3_errmsg(*db)) < 0)
+	  *error = strdup("open_database_ro: Out of memory");
+      sqlite3_close(*db);
+      *db = NULL;
+      PROBE(sqlite_open, path, 0, probe_now () - start, -r);
+      return r;
+    }
+
+  sqlite3_busy_handler(*db, busy_handler, NULL);
+  if (!empty_file)
+    {
+      keep_wal_files (*db);
+      set_read_cache (*db, statbuf.st_size);
+    }
+  profile_attach (*db);
+
+  if (empty_file)
+    r = create_table (*db, error);
+  else if (ro_conn.enabled && statbuf.st_size > 0)
+    track_database_ro (*db, path, &statbuf);
+
+  PROBE(sqlite_open, path, 0, probe_now () - start, r == SQLITE_OK ? 0 : -1);
+  return r == SQLITE_OK ? 0 : -1;
+}
+
+/* Counterpart of open_database_ro(), keeps the connection for the
+   next call of the thread if it holds no statement or transaction,
+   which would block writers. */
+static void
+close_database_ro (sqlite3 *db)
+{
+  if (db != NULL && db == ro_conn.in_use)
+    {
+      ro_conn.in_use = NULL;
+      if (ro_conn.enabled && ro_conn.idle == NULL &&
+	  sqlite3_get_autocommit (db) && sqlite3_next_stmt (db, NULL) == NULL)
+	{
+	  ro_conn.idle = db;
+	  return;
+	}
+    }
+  sqlite3_close (db);
+}
+
+static int
+open_database_rw (const char *path, sqlite3 **db, char **error)
+{
+  uint64_t start = probe_now ();
+  int r;
+
+  busy_start ();
+
+  /* The database exists nearly always, only the first login
+     needs to create it and its directory. */
+  r = sqlite3_open_v2 (path, db, SQLITE_OPEN_READWRITE, NULL);
+  if (r == SQLITE_CANTOPEN)
+    {
+      sqlite3_close (*db);
+
+      char *buf = strdup(path);
+      if (buf)
+	mkdir_p(dirname(buf), 0755);
+      free(buf);
+
+#if WITH_WTMPDBD
+      mode_t old_umask = umask(0077);
+#endif
+
+      r = sqlite3_open (path, db);
+#if WITH_WTMPDBD
+      umask (old_umask);
+#endif
+    }
+  if (r != SQLITE_OK)
+    {
+      if (error)
+	if (asprintf (error, "Cannot create/open database (%s): %s",
+		      path, sqlite3_errmsg (*db)) < 0)
+	  *error = strdup ("open_database_rw: Out of memory");
+
+      sqlite3_close (*db);
+      *db = NULL;
+      PROBE(sqlite_open, path, 1, probe_now () - start, -r);
+      return -r;
+    }
+
+  sqlite3_busy_handler(*db, busy_handler, NULL);
+  keep_wal_files (*db);
+  profile_attach (*db);
+
+  r = migrate (*db, 0, error);
+  if (r < 0)
+    {
+      sqlite3_close (*db);
+      *db = NULL;
+    }
+  PROBE(sqlite_open, path, 1, probe_now () - start, r < 0 ? r : 0);
+  return r < 0 ? r : 0;
+}
+
+/* Runs all pending migrations, including the deferred finish steps.
+   Returns the schema version on success, < 0 on failure. */
+int
+sqlite_migrate (const char *db_path, char **error)
+{
+  sqlite3 *db;
+  int r;
+
+  r = open_database_rw (db_path, &db, error);
+  if (r < 0)
+    return r;
+
+  r = migrate (db, 1, error);
+
+  sqlite3_close (db);
+
+  return r;
+}
+
+static int64_t
+insert_entry (sqlite3 *db, int type, const char *user,
+	      uint64_t usec_login, const char *tty, const char *rhost,
+	      const char *service, char **error)
+{
+  sqlite3_stmt *res;
+  char *sql_insert = "INSERT INTO wtmp (Type,User,Login,TTY,RemoteHost,Service) VALUES(?,?,?,?,?,?);";
+
+  if (sqlite3_prepare_v2 (db, sql_insert, -1, &res, 0) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to prepare statement (add_entry): %s",
+                      sqlite3_errmsg (db)) < 0)
+          *error = strdup ("add_entry: Out of memory");
+
+      return -1;
+    }
+
+  if (sqlite3_bind_int (res, 1, type) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to create add statement for 'type': %s",
+                      sqlite3_errmsg (db)) < 0)
+          *error = strdup("add_entry: Out of memory");
+
+      sqlite3_finalize(res);
+      return -1;
+    }
+
+  if (sqlite3_bind_text (res, 2, user, -1, SQLITE_STATIC) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to create add statement for 'user': %s",
+                      sqlite3_errmsg (db)) < 0)
+          *error = strdup ("add_entry: Out of memory");
+
+      sqlite3_finalize (res);
+      return -1;
+    }
+
+  if (sqlite3_bind_int64 (res, 3, usec_login) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to create add statement for 'login' time (add_entry): %s",
+                      sqlite3_errmsg (db)) < 0)
+          *error = strdup("add_entry: Out of memory");
+
+      sqlite3_finalize(res);
+      return -1;
+    }
+
+  if (sqlite3_bind_text (res, 4, tty, -1, SQLITE_STATIC) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to create add statement for 'tty': %s",
+                      sqlite3_errmsg (db)) < 0)
+          *error = strdup("add_entry: Out of memory");
+
+      sqlite3_finalize(res);
+      return -1;
+    }
+
+  if (sqlite3_bind_text (res, 5, rhost, -1, SQLITE_STATIC) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to create add statement for 'rhost': %s",
+                      sqlite3_errmsg (db)) < 0)
+          *error = strdup("add_entry: Out of memory");
+
+      sqlite3_finalize(res);
+      return -1;
+    }
+
+  if (sqlite3_bind_text (res, 6, service, -1, SQLITE_STATIC) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to create add statement for 'service': %s",
+                      sqlite3_errmsg (db)) < 0)
+          *error = strdup("add_entry: Out of memory");
+
+      sqlite3_finalize(res);
+      return -1;
+    }
+
+  int step = sqlite3_step (res);
+
+  if (step != SQLITE_DONE)
+    {
+      if (error)
+        if (asprintf (error, "Adding an entry failed: %s",
+                      sqlite3_errstr(step)) < 0)
+          *error = strdup("add_entry: Out of memory");
+
+      sqlite3_finalize(res);
+      return step == SQLITE_BUSY ? -EBUSY : -1;
+    }
+
+  sqlite3_finalize(res);
+
+  return sqlite3_last_insert_rowid(db);
+}
+
+/* Returns the highest ID in wtmp_data, < 0 on failure. */
+static int64_t
+max_data_id (sqlite3 *db, char **error)
+{
+  sqlite3_stmt *res;
+  char *sql = "SELECT MAX(ID) FROM wtmp_data";
+  int64_t id = -1;
+
+  if (sqlite3_prepare_v2 (db, sql, -1, &res, 0) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to prepare statement (max_data_id): %s",
+                      sqlite3_errmsg (db)) < 0)
+          *error = strdup ("max_data_id: Out of memory");
+      return -1;
+    }
+
+  if (sqlite3_step (res) == SQLITE_ROW &&
+      sqlite3_column_type (res, 0) == SQLITE_INTEGER)
+    id = sqlite3_column_int64 (res, 0);
+  else if (error)
+    if (asprintf (error, "Cannot find ID of new entry: %s",
+		  sqlite3_errmsg (db)) < 0)
+      *error = strdup ("max_data_id: Out of memory");
+
+  sqlite3_finalize (res);
+
+  return id;
+}
+
+/* Add a new entry. Returns ID (>=0) on success, -EBUSY if the
+   database stayed locked, -1 on other failures. */
+static int64_t
+add_entry (sqlite3 *db, int type, const char *user,
+	   uint64_t usec_login, const char *tty, const char *rhost,
+	   const char *service, char **error)
+{
+  int64_t id;
+  int r;
+
+  r = is_interned (db, error);
+  if (r < 0)
+    return r;
+  if (r == 0)
+    return insert_entry (db, type, user, usec_login, tty, rhost,
+			 service, error);
+
+  /* The trigger of the view inserts the row, which hides the
+     rowid from sqlite3_last_insert_rowid(). The savepoint keeps
+     other writers away until the new ID is known and works inside
+     the transactions of rotate, too. */
+  if ((r = sqlite3_exec (db, "SAVEPOINT add_entry", 0, 0, NULL)) != SQLITE_OK)
+    {
+      if (error)
+	if (asprintf (error, "SQL error starting transaction: %s",
+		      sqlite3_errmsg (db)) < 0)
+	  *error = strdup ("add_entry: Out of memory");
+      return r == SQLITE_BUSY ? -EBUSY : -1;
+    }
+
+  id = insert_entry (db, type, user, usec_login, tty, rhost, service, error);
+  if (id >= 0)
+    id = max_data_id (db, error);
+
+  if (id < 0)
+    sqlite3_exec (db, "ROLLBACK TO add_entry", 0, 0, NULL);
+  if ((r = sqlite3_exec (db, "RELEASE add_entry", 0, 0, NULL)) != SQLITE_OK &&
+      id >= 0)
+    {
+      if (error)
+	if (asprintf (error, "SQL error committing entry: %s",
+		      sqlite3_errmsg (db)) < 0)
+	  *error = strdup ("add_entry: Out of memory");
+      sqlite3_exec (db, "ROLLBACK", 0, 0, NULL);
+      return r == SQLITE_BUSY ? -EBUSY : -1;
+    }
+
+  return id;
+}
+
+/*
+  Add new wtmp entry to db.
+  login timestamp is in usec.
+  Returns ID on success, < 0 on failure.
+ */
+int64_t
+sqlite_login(const char *db_path, int type, const char *user,
+	     uint64_t usec_login, const char *tty, const char *rhost,
+	     const char *service, char **error)
+{
+  uint64_t start = probe_now ();
+  sqlite3 *db;
+  int64_t id;
+  int r;
+
+  r = open_database_rw(db_path, &db, error);
+  if (r < 0)
+    id = r;
+  else
+    {
+      id = add_entry(db, type, user, usec_login, tty, rhost, service, error);
+      sqlite3_close(db);
+    }
+
+  PROBE(sqlite_login, id, probe_now () - start);
+  return id;
+}
+
+/* Updates logout field.
+   logout timestamp is in usec.
+   Returns 0 on success, -EBUSY if the database stayed locked,
+   -1 on other failures. */
+static int
+update_logout (sqlite3 *db, int64_t id, uint64_t usec_logout, char **error)
+{
+  sqlite3_stmt *res;
+  char *sql = "UPDATE wtmp SET Logout = ? WHERE ID = ?";
+  int r;
+
+  /* sqlite3_changes() does not count rows changed by the trigger
+     of the view, update the table directly. */
+  r = is_interned (db, error);
+  if (r < 0)
+    return r;
+  if (r > 0)
+    sql = "UPDATE wtmp_data SET Logout = ? WHERE ID = ?";
+
+  if (sqlite3_prepare_v2 (db, sql, -1, &res, 0) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to prepare statement (update_logout): %s",
+                      sqlite3_errmsg (db)) < 0)
+          *error = strdup ("update_logout: Out of memory");
+
+      return -1;
+    }
+
+  if (sqlite3_bind_int64 (res, 1, usec_logout) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to create update query (logout): %s",
+                      sqlite3_errmsg (db)) < 0)
+          *error = strdup("update_logout: Out of memory");
+
+      sqlite3_finalize(res);
+      return -1;
+    }
+
+  if (sqlite3_bind_int64 (res, 2, id) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to create update query (ID): %s",
+                      sqlite3_errmsg (db)) < 0)
+          *error = strdup("update_logout: Out of memory");
+
+      sqlite3_finalize(res);
+      return -1;
+    }
+
+  int step = sqlite3_step (res);
+
+  if (step != SQLITE_DONE)
+    {
+      if (error)
+        if (asprintf (error, "Updating logout time failed: %s",
+                      sqlite3_errstr(step)) < 0)
+          *error = strdup("update_logout: Out of memory");
+
+      sqlite3_finalize(res);
+      return step == SQLITE_BUSY ? -EBUSY : -1;
+    }
+
+  int changes;
+  if ((changes = sqlite3_changes (db)) != 1)
+    {
+      if (error)
+        if (asprintf (error, "Update of logout time changed wrong number of rows, expected 1, got %d",
+                      changes) < 0)
+          *error = strdup("update_logout: Out of memory");
+
+      sqlite3_finalize(res);
+      return -1;
+    }
+
+  sqlite3_finalize (res);
+
+  return 0;
+}
+
+
+/*
+  Add logout timestamp to existingentry.
+  logout timestamp is in usec.
+  ID is the return value of wtmpdb_login/logwtmpdb.
+  Returns 0 on success, < 0 on failure.
+ */
+int
+sqlite_logout (const char *db_path, int64_t id, uint64_t usec_logout,
+	       char **error)
+{
+  uint64_t start = probe_now ();
+  sqlite3 *db;
+  int r;
+
+  r = open_database_rw (db_path, &db, error);
+  if (r == 0)
+    {
+      r = update_logout(db, id, usec_logout, error);
+      sqlite3_close (db);
+    }
+
+  PROBE(sqlite_logout, id, r, probe_now () - start);
+  return r;
+}
+
+static int64_t
+search_id (sqlite3 *db, const char *tty, char **error)
+{
+  uint64_t start = probe_now ();
+  int64_t id = -1;
+  sqlite3_stmt *res;
+  char *sql = "SELECT ID FROM wtmp WHERE TTY = ? AND Logout IS NULL ORDER BY Login DESC LIMIT 1";
+
+  int rc = sqlite3_prepare_v2 (db, sql, -1, &res, 0);
+  if (rc != SQLITE_OK)
+    {
+      int r = rc == SQLITE_BUSY ? -EBUSY : -ENOTSUP;
+      if (error)
+        if (asprintf (error, "Failed to prepare statement (search_id): %s",
+                      sqlite3_errmsg (db)) < 0)
+	  {
+	    r = -ENOMEM;
+	    *error = strdup ("search_id: Out of memory");
+	  }
+      return r;
+    }
+
+  if (sqlite3_bind_text (res, 1, tty, -1, SQLITE_STATIC) != SQLITE_OK)
+    {
+      int r = -EPROTO;
+      if (error)
+        if (asprintf (error, "Failed to create search query 'tty': %s",
+                      sqlite3_errmsg (db)) < 0)
+	  {
+	    r = -ENOMEM;
+	    *error = strdup("search_id: Out of memory");
+	  }
+
+      sqlite3_finalize(res);
+      return r;
+    }
+
+  int step = sqlite3_step (res);
+
+  if (step == SQLITE_ROW)
+    id = sqlite3_column_int64 (res, 0);
+  else if (step == SQLITE_DONE)
+    {
+      id = -ENOENT;
+      if (error)
+        if (asprintf (error, "Open entry for tty '%s' not found (search_id)", tty) < 0)
+	  {
+	    *error = strdup("search_id: Out of memory");
+	    id = -ENOMEM;
+	  }
+    }
+  else
+    {
+      id = step == SQLITE_BUSY ? -EBUSY : -ENOENT;
+      if (error)
+        if (asprintf (error, "Error searching open entry for tty '%s': %s",
+		      tty, sqlite3_errstr(step)) < 0)
+	  {
+	    *error = strdup("search_id: Out of memory");
+	    id = -ENOMEM;
+	  }
+    }
+
+  sqlite3_finalize (res);
+
+  PROBE(search_id, tty, id, id >= 0 ? 1 : 0, probe_now () - start);
+  return id;
+}
+
+int64_t
+sqlite_get_id (const char *db_path, const char *tty, char **error)
+{
+  sqlite3 *db;
+  int64_t retval;
+  int r;
+
+  r = open_database_ro (db_path, &db, error);
+  if (r != 0)
+    return -r;
+
+  retval = search_id (db, tty, error);
+
+  close_database_ro (db);
+
+  return retval;
+}
+
+#if HAVE_USDT
+/* Counts the rows passed to the callback for the sqlite_read_all
+   probe. */
+struct count_rows {
+  int (*cb_func)(void *unused, int argc, char **argv, char **azColName);
+  void *userdata;
+  uint64_t rows;
+};
+
+static int
+count_rows_cb (void *data, int argc, char **argv, char **azColName)
+{
+  struct count_rows *cr = data;
+
+  cr->rows++;
+  return cr->cb_func (cr->userdata, argc, argv, azColName);
+}
+#endif
+
+/* Reads all entries from database and calls the callback function for
+   each entry.
+   Returns 0 on success, -1 on failure. */
+int
+sqlite_read_all (const char *db_path,
+		 int (*cb_func)(void *unused, int argc, char **argv,
+				char **azColName),
+		 void *userdata, char **error)
+{
+  uint64_t start = probe_now ();
+  sqlite3 *db;
+  char *err_msg = 0;
+  int r;
+
+  r = open_database_ro (db_path, &db, error);
+  if (r != 0)
+    {
+      PROBE(sqlite_read_all, -r, 0, probe_now () - start);
+      return -r;
+    }
+
+  char *sql = "SELECT * FROM wtmp ORDER BY Login DESC, Logout ASC";
+
+#if HAVE_USDT
+  struct count_rows cr = {cb_func, userdata, 0};
+  r = sqlite3_exec (db, sql, count_rows_cb, &cr, &err_msg);
+  PROBE(sqlite_read_all, -r, cr.rows, probe_now () - start);
+#else
+  r = sqlite3_exec (db, sql, cb_func, userdata, &err_msg);
+#endif
+  close_database_ro (db);
+  if (r != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "sqlite_read_all: SQL error: %s", err_msg) < 0)
+          *error = strdup ("sqlite_read_all: Out of memory");
+
+      sqlite3_free (err_msg);
+      return -r;
+    }
+
+  return 0;
+}
+
+/* Uses the primary key, so only the new entries are visited. */
+int
+sqlite_read_since_id (const char *db_path, int64_t after_id,
+		      int (*cb_func)(void *unused, int argc, char **argv,
+				     char **azColName),
+		      void *userdata, char **error)
+{
+  sqlite3 *db;
+  char *err_msg = 0;
+  char *sql;
+  int r;
+
+  r = open_database_ro (db_path, &db, error);
+  if (r != 0)
+    return -r;
+
+  sql = sqlite3_mprintf ("SELECT * FROM wtmp WHERE ID > %lld ORDER BY ID ASC",
+			 (long long int)after_id);
+  if (sql == NULL)
+    {
+      close_database_ro (db);
+      if (error)
+	*error = strdup ("sqlite_read_since_id: Out of memory");
+      return -1;
+    }
+
+  r = sqlite3_exec (db, sql, cb_func, userdata, &err_msg);
+  sqlite3_free (sql);
+  close_database_ro (db);
+  if (r != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "sqlite_read_since_id: SQL error: %s", err_msg) < 0)
+          *error = strdup ("sqlite_read_since_id: Out of memory");
+
+      sqlite3_free (err_msg);
+      return -r;
+    }
+
+  return 0;
+}
+
+/* Reads the single entry with this ID, the callback is not called
+   if there is none. */
+int
+sqlite_read_id (const char *db_path, int64_t id,
+		int (*cb_func)(void *unused, int argc, char **argv,
+			       char **azColName),
+		void *userdata, char **error)
+{
+  sqlite3 *db;
+  char *err_msg = 0;
+  char *sql;
+  int r;
+
+  r = open_database_ro (db_path, &db, error);
+  if (r != 0)
+    return -r;
+
+  sql = sqlite3_mprintf ("SELECT * FROM wtmp WHERE ID = %lld",
+			 (long long int)id);
+  if (sql == NULL)
+    {
+      close_database_ro (db);
+      if (error)
+	*error = strdup ("sqlite_read_id: Out of memory");
+      return -1;
+    }
+
+  r = sqlite3_exec (db, sql, cb_func, userdata, &err_msg);
+  sqlite3_free (sql);
+  close_database_ro (db);
+  if (r != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "sqlite_read_id: SQL error: %s", err_msg) < 0)
+          *error = strdup ("sqlite_read_id: Out of memory");
+
+      sqlite3_free (err_msg);
+      return -r;
+    }
+
+  return 0;
+}
+
+
+/* Keyset pagination: the entries are ordered by Login and ID, the
+   page continues after the last entry of the previous one. With
+   wtmp_login this is a range seek, so every page costs the same,
+   regardless of how deep in the history it is. */
+int
+sqlite_read_page (const char *db_path, uint64_t before_login,
+		  int64_t before_id, unsigned int limit,
+		  int (*cb_func)(void *unused, int argc, char **argv,
+				 char **azColName),
+		  void *userdata, char **error)
+{
+  /* 0 means all entries */
+  long long int sql_limit = limit ? (long long int)limit : -1;
+  sqlite3 *db;
+  char *err_msg = 0;
+  char *sql;
+  int r;
+
+  r = open_database_ro (db_path, &db, error);
+  if (r != 0)
+    return -r;
+
+  if (before_id > 0)
+    sql = sqlite3_mprintf ("SELECT * FROM wtmp WHERE Login <= %lld "
+			   "AND (Login < %lld OR ID < %lld) "
+			   "ORDER BY Login DESC, ID DESC LIMIT %lld",
+			   (long long int)before_login,
+			   (long long int)before_login,
+			   (long long int)before_id, sql_limit);
+  else
+    sql = sqlite3_mprintf ("SELECT * FROM wtmp ORDER BY Login DESC, ID DESC "
+			   "LIMIT %lld", sql_limit);
+  if (sql == NULL)
+    {
+      close_database_ro (db);
+      if (error)
+	*error = strdup ("sqlite_read_page: Out of memory");
+      return -1;
+    }
+
+  r = sqlite3_exec (db, sql, cb_func, userdata, &err_msg);
+  sqlite3_free (sql);
+  close_database_ro (db);
+  if (r != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "sqlite_read_page: SQL error: %s", err_msg) < 0)
+          *error = strdup ("sqlite_read_page: Out of memory");
+
+      sqlite3_free (err_msg);
+      return -r;
+    }
+
+  return 0;
+}
+
+/* Reads the entries which overlap [since, until]: closed sessions
+   with Login <= until and Logout >= since, and open sessions logged
+   in until "until" and since the last boot before "since". The closed
+   ones are read with one range seek of wtmp_span per length class,
+   the open ones with wtmp_open. until 0 means no upper bound. */
+int
+sqlite_read_overlap (const char *db_path, uint64_t since, uint64_t until,
+		     int (*cb_func)(void *unused, int argc, char **argv,
+				    char **azColName),
+		     void *userdata, char **error)
+{
+  long long int from = (long long int) since;
+  long long int to = until && until < INT64_MAX ? (long long int) until : INT64_MAX;
+  long long int length = 1;
+  sqlite3_str *str;
+  sqlite3 *db;
+  char *err_msg = 0;
+  char *sql;
+  int r;
+
+  r = open_database_ro (db_path, &db, error);
+  if (r != 0)
+    return -r;
+
+  str = sqlite3_str_new (db);
+  sqlite3_str_appendf (str, "SELECT * FROM wtmp WHERE Logout IS NULL "
+		       "AND Login <= %lld AND Login >= IFNULL((SELECT Login FROM wtmp "
+		       "WHERE Type = %d AND Login <= %lld "
+		       "ORDER BY Login DESC LIMIT 1), 0)",
+		       to, BOOT_TIME, from);
+  for (int class = 1; class <= SPAN_CLASSES; class++)
+    {
+      /* sessions of this class are shorter than 10^class usec */
+      length = length > INT64_MAX / 10 ? INT64_MAX : length * 10;
+      sqlite3_str_appendf (str, " UNION ALL SELECT * FROM wtmp "
+			   "WHERE Logout IS NOT NULL AND " SPAN_CLASS " = %d "
+			   "AND Login > %lld AND Login <= %lld AND Logout >= %lld",
+			   class, from - length, to, from);
+    }
+  sqlite3_str_appendall (str, " ORDER BY 4 DESC, 1 DESC");
+  sql = sqlite3_str_finish (str);
+  if (sql == NULL)
+    {
+      close_database_ro (db);
+      if (error)
+	*error = strdup ("sqlite_read_overlap: Out of memory");
+      return -1;
+    }
+
+  r = sqlite3_exec (db, sql, cb_func, userdata, &err_msg);
+  sqlite3_free (sql);
+  close_database_ro (db);
+  if (r != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "sqlite_read_overlap: SQL error: %s", err_msg) < 0)
+          *error = strdup ("sqlite_read_overlap: Out of memory");
+
+      sqlite3_free (err_msg);
+      return -r;
+    }
+
+  return 0;
+}
+
+/* Reads the entries which were active at the time "at": logged in
+   before, and logged out after it or never, but then without a boot
+   in between. No session survives a boot, so all of them logged in
+   since the last boot before "at", which is found by walking
+   wtmp_login back from "at". The result is a range seek of the
+   length of one boot, regardless of the size of the history. */
+int
+sqlite_read_present (const char *db_path, uint64_t at,
+		     int (*cb_func)(void *unused, int argc, char **argv,
+				    char **azColName),
+		     void *userdata, char **error)
+{
+  sqlite3 *db;
+  char *err_msg = 0;
+  char *sql;
+  int r;
+
+  r = open_database_ro (db_path, &db, error);
+  if (r != 0)
+    return -r;
+
+  sql = sqlite3_mprintf ("SELECT * FROM wtmp WHERE Login <= %lld "
+			 "AND Login >= IFNULL((SELECT Login FROM wtmp "
+			 "WHERE Type = %d AND Login <= %lld "
+			 "ORDER BY Login DESC LIMIT 1), 0) "
+			 "AND (Logout IS NULL OR Logout >= %lld) "
+			 "ORDER BY Login DESC, ID DESC",
+			 (long long int)at, BOOT_TIME, (long long int)at,
+			 (long long int)at);
+  if (sql == NULL)
+    {
+      close_database_ro (db);
+      if (error)
+	*error = strdup ("sqlite_read_present: Out of memory");
+      return -1;
+    }
+
+  r = sqlite3_exec (db, sql, cb_func, userdata, &err_msg);
+  sqlite3_free (sql);
+  close_database_ro (db);
+  if (r != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "sqlite_read_present: SQL error: %s", err_msg) < 0)
+          *error = strdup ("sqlite_read_present: Out of memory");
+
+      sqlite3_free (err_msg);
+      return -r;
+    }
+
+  return 0;
+}
+
+/* Reads the sessions without logout time since the last boot,
+   newest first. Old sessions which were never closed because the
+   system crashed are ignored. Only the wtmp_open index is used. */
+int
+sqlite_read_current (const char *db_path,
+		     int (*cb_func)(void *unused, int argc, char **argv,
+				    char **azColName),
+		     void *userdata, char **error)
+{
+  sqlite3 *db;
+  char *err_msg = 0;
+  char *sql;
+  int r;
+
+  r = open_database_ro (db_path, &db, error);
+  if (r != 0)
+    return -r;
+
+  sql = sqlite3_mprintf ("SELECT * FROM wtmp WHERE Logout IS NULL AND Type = %d "
+			 "AND Login >= (SELECT IFNULL(MAX(Login), 0) FROM wtmp "
+			 "WHERE Logout IS NULL AND Type = %d) "
+			 "ORDER BY Login DESC", USER_PROCESS, BOOT_TIME);
+  if (sql == NULL)
+    {
+      close_database_ro (db);
+      if (error)
+	*error = strdup ("sqlite_read_current: Out of memory");
+      return -1;
+    }
+
+  r = sqlite3_exec (db, sql, cb_func, userdata, &err_msg);
+  sqlite3_free (sql);
+  close_database_ro (db);
+  if (r != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "sqlite_read_current: SQL error: %s", err_msg) < 0)
+          *error = strdup ("sqlite_read_current: Out of memory");
+
+      sqlite3_free (err_msg);
+      return -r;
+    }
+
+  return 0;
+}
+
+/* strftime(..., 'localtime') calls localtime_r() for every row. The
+   logins are mostly visited in chronological order, so remember the
+   last local day or hour and its key, as long as the UTC offset does
+   not change within it. */
+struct time_bucket {
+  int hour;
+  time_t start;
+  time_t end;
+  char key[24];
+};
+
+static void
+time_bucket_func (sqlite3_context *ctx, int _unused_(argc),
+		  sqlite3_value **argv)
+{
+  struct time_bucket *b = sqlite3_user_data (ctx);
+  time_t t = sqlite3_value_int64 (argv[0]) / USEC_PER_SEC;
+
+  if (t < b->start || t >= b->end)
+    {
+      struct tm tm, tm_end;
+      time_t len = b->hour ? 3600 : 86400;
+
+      if (localtime_r (&t, &tm) == NULL)
+	{
+	  sqlite3_result_null (ctx);
+	  return;
+	}
+      strftime (b->key, sizeof (b->key), b->hour ? "%Y-%m-%d %H:00" : "%Y-%m-%d", &tm);
+
+      b->start = t - tm.tm_min * 60 - tm.tm_sec;
+      if (!b->hour)
+	b->start -= tm.tm_hour * 3600;
+      b->end = b->start + len;
+
+      time_t last = b->end - 1;
+      if (localtime_r (&last, &tm_end) == NULL ||
+	  tm_end.tm_gmtoff != tm.tm_gmtoff)
+	b->start = b->end = 0; /* don't cache this one */
+    }
+
+  sqlite3_result_text (ctx, b->key, -1, SQLITE_TRANSIENT);
+}
+
+/* Optional daily rollup: per UTC day of the login, user and service
+   the number of sessions, their length and the remote hosts.
+   Triggers keep it up to date in the same transaction as the insert
+   or the logout, no matter which program writes the entry. The day
+   must not depend on the time zone of the writer, so it is not the
+   local one. Rotation deletes only from wtmp and only whole days, so
+   the rollup keeps the whole history, but reports use only the days
+   still in wtmp to get the same numbers as without rollup. */
+#define STRINGIFY(x) STRINGIFY2(x)
+#define STRINGIFY2(x) #x
+#define ROLLUP_DAY(x) "date(" x ".Login/1000000, 'unixepoch')"
+#define ROLLUP_LENGTH(x) "(CASE WHEN " x ".Logout > " x ".Login THEN (" x ".Logout - " x ".Login)/1000000 ELSE 0 END)"
+
+static const char *sql_rollup_create =
+  "CREATE TABLE wtmp_daily(Day TEXT NOT NULL, User TEXT NOT NULL, Service TEXT NOT NULL, "
+  "Sessions INTEGER NOT NULL, Seconds INTEGER NOT NULL, Hosts INTEGER NOT NULL, "
+  "PRIMARY KEY (Day, User, Service)) WITHOUT ROWID, STRICT;"
+  "CREATE TABLE wtmp_daily_hosts(Day TEXT NOT NULL, User TEXT NOT NULL, Service TEXT NOT NULL, "
+  "RemoteHost TEXT NOT NULL, PRIMARY KEY (Day, User, Service, RemoteHost)) WITHOUT ROWID, STRICT;"
+  /* existing entries */
+  "INSERT INTO wtmp_daily_hosts SELECT DISTINCT " ROLLUP_DAY("wtmp") ", User, IFNULL(Service, ''), RemoteHost "
+  "FROM wtmp WHERE Type = " STRINGIFY(USER_PROCESS) " AND RemoteHost IS NOT NULL;"
+  "INSERT INTO wtmp_daily SELECT " ROLLUP_DAY("wtmp") " AS D, User, IFNULL(Service, '') AS S, "
+  "COUNT(*), SUM(" ROLLUP_LENGTH("wtmp") "), 0 FROM wtmp WHERE Type = " STRINGIFY(USER_PROCESS) " GROUP BY D, User, S;"
+  "UPDATE wtmp_daily SET Hosts = (SELECT COUNT(*) FROM wtmp_daily_hosts h WHERE h.Day = wtmp_daily.Day "
+  "AND h.User = wtmp_daily.User AND h.Service = wtmp_daily.Service);";
+
+/* Triggers for new entries in tbl, user, service and host are
+   the values of the NEW row. */
+#define ROLLUP_TRIGGERS(tbl, user, service, host)			\
+  "CREATE TRIGGER wtmp_daily_insert AFTER INSERT ON " tbl " WHEN NEW.Type = " STRINGIFY(USER_PROCESS) " BEGIN " \
+  "INSERT INTO wtmp_daily VALUES (" ROLLUP_DAY("NEW") ", " user ", IFNULL(" service ", ''), 1, " \
+  ROLLUP_LENGTH("NEW") ", 0) ON CONFLICT (Day, User, Service) DO UPDATE " \
+  "SET Sessions = Sessions + 1, Seconds = Seconds + excluded.Seconds;" \
+  "INSERT OR IGNORE INTO wtmp_daily_hosts SELECT " ROLLUP_DAY("NEW") ", " user ", IFNULL(" service ", ''), " \
+  host " WHERE " host " IS NOT NULL;"					\
+  "UPDATE wtmp_daily SET Hosts = (SELECT COUNT(*) FROM wtmp_daily_hosts h WHERE h.Day = wtmp_daily.Day " \
+  "AND h.User = wtmp_daily.User AND h.Service = wtmp_daily.Service) " \
+  "WHERE Day = " ROLLUP_DAY("NEW") " AND User = " user " AND Service = IFNULL(" service ", '');" \
+  "END;"								\
+  "CREATE TRIGGER wtmp_daily_logout AFTER UPDATE OF Logout ON " tbl " WHEN NEW.Type = " STRINGIFY(USER_PROCESS) " BEGIN " \
+  "UPDATE wtmp_daily SET Seconds = Seconds + " ROLLUP_LENGTH("NEW") " - " ROLLUP_LENGTH("OLD") " " \
+  "WHERE Day = " ROLLUP_DAY("NEW") " AND User = " user " AND Service = IFNULL(" service ", '');" \
+  "END;"
+
+#define INTERNED_NAME(tbl, id) "(SELECT Name FROM " tbl " WHERE ID = " id ")"
+
+static const char *sql_rollup_triggers =
+  ROLLUP_TRIGGERS ("wtmp", "NEW.User", "NEW.Service", "NEW.RemoteHost");
+
+static const char *sql_rollup_triggers_interned =
+  ROLLUP_TRIGGERS ("wtmp_data", INTERNED_NAME ("wtmp_users", "NEW.UserID"),
+		   INTERNED_NAME ("wtmp_services", "NEW.ServiceID"),
+		   INTERNED_NAME ("wtmp_hosts", "NEW.HostID"));
+
+static const char *sql_rollup_drop =
+  "DROP TRIGGER IF EXISTS wtmp_daily_insert;"
+  "DROP TRIGGER IF EXISTS wtmp_daily_logout;"
+  "DROP TABLE IF EXISTS wtmp_daily;"
+  "DROP TABLE IF EXISTS wtmp_daily_hosts;";
+
+#define has_rollup(db, error) has_table (db, "wtmp_daily", error)
+
+/* Creates and fills (enable != 0) or removes the rollup tables.
+   Enabling it again keeps the existing rollup.
+   Returns 0 on success, < 0 on failure. */
+int
+sqlite_rollup (const char *db_path, int enable, char **error)
+{
+  sqlite3 *db;
+  char *err_msg = NULL;
+  int r;
+
+  r = open_database_rw (db_path, &db, error);
+  if (r < 0)
+    return r;
+
+  if (sqlite3_exec (db, "BEGIN IMMEDIATE", 0, 0, &err_msg) != SQLITE_OK)
+    {
+      if (error)
+	if (asprintf (error, "SQL error starting transaction: %s", err_msg) < 0)
+	  *error = strdup ("sqlite_rollup: Out of memory");
+      sqlite3_free (err_msg);
+      sqlite3_close (db);
+      return -EBUSY;
+    }
+
+  r = has_rollup (db, error);
+  if (r >= 0 && (r == 0) == (enable != 0))
     {
-        if (in_str[i] == '.')
-        {
-            in_str[i] = '\0';
-            return;
-        }
+      int interned = enable ? is_interned (db, error) : 0;
+
+      if (interned < 0)
+	r = interned;
+      else
+	{
+	  r = sqlite3_exec (db, enable ? sql_rollup_create : sql_rollup_drop,
+			    0, 0, &err_msg);
+	  if (r == SQLITE_OK && enable)
+	    r = sqlite3_exec (db, interned ? sql_rollup_triggers_interned :
+			      sql_rollup_triggers, 0, 0, &err_msg);
+	  if (r != SQLITE_OK)
+	    {
+	      if (error)
+		if (asprintf (error, "SQL error %s rollup: %s",
+			      enable ? "creating" : "removing", err_msg) < 0)
+		  *error = strdup ("sqlite_rollup: Out of memory");
+	      sqlite3_free (err_msg);
+	      r = r == SQLITE_BUSY ? -EBUSY : -1;
+	    }
+	}
+    }
+  else if (r > 0)
+    r = 0; /* nothing to do */
+
+  if (r < 0)
+    sqlite3_exec (db, "ROLLBACK", 0, 0, NULL);
+  else if (sqlite3_exec (db, "COMMIT", 0, 0, &err_msg) != SQLITE_OK)
+    {
+      if (error)
+	if (asprintf (error, "SQL error committing rollup: %s", err_msg) < 0)
+	  *error = strdup ("sqlite_rollup: Out of memory");
+      sqlite3_free (err_msg);
+      r = -1;
     }
+
+  sqlite3_close (db);
+
+  return r < 0 ? r : 0;
 }
 
-/* Creates the table if it does not exist.
- * Returns 0 on success, -1 on failure. */
-static int64_t
-create_table (sqlite3 *db, char **error)
+/* Interned strings: wtmp_data stores the IDs of the user, tty,
+   host and service names in the lookup tables instead of the
+   strings, which repeat on nearly every row. wtmp becomes a view
+   with the old columns, so all readers keep working, and the
+   triggers of the view intern the strings of new entries. */
+#define INTERN(tbl, value) \
+  "INSERT OR IGNORE INTO " tbl " (Name) SELECT " value " WHERE " value " IS NOT NULL;"
+#define LOOKUP(tbl, value) "(SELECT ID FROM " tbl " WHERE Name = " value ")"
+#define INTERN_NEW \
+  INTERN ("wtmp_users", "NEW.User") INTERN ("wtmp_ttys", "NEW.TTY") \
+  INTERN ("wtmp_hosts", "NEW.RemoteHost") INTERN ("wtmp_services", "NEW.Service")
+/* LEFT JOIN keeps wtmp_data the outer loop, so a view with it can
+   use the indexes of wtmp_data. */
+#define INTERNED_ROWS \
+  "SELECT d.ID AS ID, d.Type AS Type, u.Name AS User, d.Login AS Login, d.Logout AS Logout, " \
+  "t.Name AS TTY, h.Name AS RemoteHost, s.Name AS Service FROM wtmp_data d " \
+  "LEFT JOIN wtmp_users u ON u.ID = d.UserID LEFT JOIN wtmp_ttys t ON t.ID = d.TTYID " \
+  "LEFT JOIN wtmp_hosts h ON h.ID = d.HostID LEFT JOIN wtmp_services s ON s.ID = d.ServiceID"
+
+static const char *sql_intern_create =
+  "CREATE TABLE wtmp_users(ID INTEGER PRIMARY KEY, Name TEXT NOT NULL UNIQUE) STRICT;"
+  "CREATE TABLE wtmp_ttys(ID INTEGER PRIMARY KEY, Name TEXT NOT NULL UNIQUE) STRICT;"
+  "CREATE TABLE wtmp_hosts(ID INTEGER PRIMARY KEY, Name TEXT NOT NULL UNIQUE) STRICT;"
+  "CREATE TABLE wtmp_services(ID INTEGER PRIMARY KEY, Name TEXT NOT NULL UNIQUE) STRICT;"
+  "INSERT INTO wtmp_users (Name) SELECT DISTINCT User FROM wtmp;"
+  "INSERT INTO wtmp_ttys (Name) SELECT DISTINCT TTY FROM wtmp WHERE TTY IS NOT NULL;"
+  "INSERT INTO wtmp_hosts (Name) SELECT DISTINCT RemoteHost FROM wtmp WHERE RemoteHost IS NOT NULL;"
+  "INSERT INTO wtmp_services (Name) SELECT DISTINCT Service FROM wtmp WHERE Service IS NOT NULL;"
+  "CREATE TABLE wtmp_data(ID INTEGER PRIMARY KEY, Type INTEGER, UserID INTEGER NOT NULL, Login INTEGER, Logout INTEGER, "
+  "TTYID INTEGER, HostID INTEGER, ServiceID INTEGER) STRICT;"
+  "INSERT INTO wtmp_data SELECT w.ID, w.Type, u.ID, w.Login, w.Logout, t.ID, h.ID, s.ID FROM wtmp w "
+  "JOIN wtmp_users u ON u.Name = w.User LEFT JOIN wtmp_ttys t ON t.Name = w.TTY "
+  "LEFT JOIN wtmp_hosts h ON h.Name = w.RemoteHost LEFT JOIN wtmp_services s ON s.Name = w.Service "
+  "ORDER BY w.ID;"
+  /* removes the index and the triggers of the rollup, too */
+  "DROP TABLE wtmp;"
+  SQL_OPEN_INDEX ("wtmp_data") ";"
+  SQL_LOGIN_INDEX ("wtmp_data") ";"
+  SQL_SPAN_INDEX ("wtmp_data") ";"
+  "CREATE VIEW wtmp AS " INTERNED_ROWS ";"
+  "CREATE TRIGGER wtmp_insert INSTEAD OF INSERT ON wtmp BEGIN " INTERN_NEW
+  "INSERT INTO wtmp_data VALUES (NEW.ID, NEW.Type, " LOOKUP ("wtmp_users", "NEW.User") ", "
+  "NEW.Login, NEW.Logout, " LOOKUP ("wtmp_ttys", "NEW.TTY") ", "
+  LOOKUP ("wtmp_hosts", "NEW.RemoteHost") ", " LOOKUP ("wtmp_services", "NEW.Service") ");"
+  "END;"
+  "CREATE TRIGGER wtmp_update INSTEAD OF UPDATE ON wtmp BEGIN " INTERN_NEW
+  "UPDATE wtmp_data SET ID = NEW.ID, Type = NEW.Type, UserID = " LOOKUP ("wtmp_users", "NEW.User") ", "
+  "Login = NEW.Login, Logout = NEW.Logout, TTYID = " LOOKUP ("wtmp_ttys", "NEW.TTY") ", "
+  "HostID = " LOOKUP ("wtmp_hosts", "NEW.RemoteHost") ", "
+  "ServiceID = " LOOKUP ("wtmp_services", "NEW.Service") " WHERE ID = OLD.ID;"
+  "END;"
+  "CREATE TRIGGER wtmp_delete INSTEAD OF DELETE ON wtmp BEGIN "
+  "DELETE FROM wtmp_data WHERE ID = OLD.ID;"
+  "END;";
+
+static const char *sql_intern_drop =
+  /* removes the triggers of the view */
+  "DROP VIEW wtmp;"
+  "DROP INDEX wtmp_open;"
+  "DROP INDEX IF EXISTS wtmp_login;"
+  "DROP INDEX IF EXISTS wtmp_span;"
+  SQL_WTMP_TABLE
+  SQL_OPEN_INDEX ("wtmp") ";"
+  "INSERT INTO wtmp " INTERNED_ROWS " ORDER BY d.ID;"
+  SQL_LOGIN_INDEX ("wtmp") ";"
+  SQL_SPAN_INDEX ("wtmp") ";"
+  /* removes the triggers of the rollup, too */
+  "DROP TABLE wtmp_data;"
+  "DROP TABLE wtmp_users;"
+  "DROP TABLE wtmp_ttys;"
+  "DROP TABLE wtmp_hosts;"
+  "DROP TABLE wtmp_services;";
+
+/* Converts the database to (enable != 0) or back from interned
+   strings. The rollup, if it exists, is kept.
+   Returns 0 on success, < 0 on failure. */
+int
+sqlite_intern (const char *db_path, int enable, char **error)
 {
+  sqlite3 *db;
   char *err_msg = NULL;
-  char *sql_table = "CREATE TABLE IF NOT EXISTS wtmp(ID INTEGER PRIMARY KEY, Type INTEGER, User TEXT NOT NULL, Login INTEGER, Logout INTEGER, TTY TEXT, RemoteHost TEXT, Service TEXT) STRICT;";
+  int r;
+
+  r = open_database_rw (db_path, &db, error);
+  if (r < 0)
+    return r;
 
-  if (sqlite3_exec (db, sql_table, 0, 0, &err_msg) != SQLITE_OK)
+  if (sqlite3_exec (db, "BEGIN IMMEDIATE", 0, 0, &err_msg) != SQLITE_OK)
     {
       if (error)
-	if (asprintf (error, "SQL error creating table: %s", err_msg) < 0)
-	  *error = strdup ("create_table: Out of memory");
+	if (asprintf (error, "SQL error starting transaction: %s", err_msg) < 0)
+	  *error = strdup ("sqlite_intern: Out of memory");
       sqlite3_free (err_msg);
+      sqlite3_close (db);
+      return -EBUSY;
+    }
 
-      return -1;
+  r = is_interned (db, error);
+  if (r >= 0 && (r == 0) == (enable != 0))
+    {
+      int rollup = has_rollup (db, error);
+
+      if (rollup < 0)
+	r = rollup;
+      else
+	{
+	  r = sqlite3_exec (db, enable ? sql_intern_create : sql_intern_drop,
+			    0, 0, &err_msg);
+	  if (r == SQLITE_OK && rollup)
+	    r = sqlite3_exec (db, enable ? sql_rollup_triggers_interned :
+			      sql_rollup_triggers, 0, 0, &err_msg);
+	  if (r != SQLITE_OK)
+	    {
+	      if (error)
+		if (asprintf (error, "SQL error %s interned strings: %s",
+			      enable ? "creating" : "removing", err_msg) < 0)
+		  *error = strdup ("sqlite_intern: Out of memory");
+	      sqlite3_free (err_msg);
+	      r = r == SQLITE_BUSY ? -EBUSY : -1;
+	    }
+	}
     }
-  return 0;
+  else if (r > 0)
+    {
+      r = 0; /* nothing to do */
+      enable = 0;
+    }
+
+  if (r < 0)
+    sqlite3_exec (db, "ROLLBACK", 0, 0, NULL);
+  else if (sqlite3_exec (db, "COMMIT", 0, 0, &err_msg) != SQLITE_OK)
+    {
+      if (error)
+	if (asprintf (error, "SQL error committing interned strings: %s",
+		      err_msg) < 0)
+	  *error = strdup ("sqlite_intern: Out of memory");
+      sqlite3_free (err_msg);
+      r = -1;
+    }
+  /* give the space of the old strings back to the filesystem */
+  else if (enable && sqlite3_exec (db, "VACUUM", 0, 0, &err_msg) != SQLITE_OK)
+    {
+      if (error)
+	if (asprintf (error, "SQL error shrinking database: %s", err_msg) < 0)
+	  *error = strdup ("sqlite_intern: Out of memory");
+      sqlite3_free (err_msg);
+      r = -1;
+    }
+
+  sqlite3_close (db);
+
+  return r < 0 ? r : 0;
 }
 
+/* The rollup can answer a report if the range starts and ends at
+   midnight UTC. day_from and day_to get the first and the last day
+   of the range, see rollup_first_day for the rotated days. */
 static int
-open_database_ro (const char *path, sqlite3 **db, char **error)
+rollup_range (uint64_t since, uint64_t until, char *day_from, char *day_to,
+	      size_t len)
 {
-  struct stat statbuf;
-  int empty_file;
-  int r;
+  struct tm tm;
+  time_t t;
 
-  empty_file = stat(path, &statbuf) == 0 && statbuf.st_size == 0;
-  r = sqlite3_open_v2 (path, db, empty_file ?
-                       SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY :
-                       SQLITE_OPEN_READONLY, NULL);
-  if (r != SQLITE_OK)
+  if (since == 0)
+    snprintf (day_from, len, "0000-00-00");
+  else
     {
-      if (error)
-	if (asprintf(error, "Cannot open database (%s) read-only: %s",
-		     path, sqlite3_errmsg(*db)) < 0)
-	  *error = strdup("open_database_ro: Out of memory");
-      sqlite3_close(*db);
-      *db = NULL;
-      return r;
+      if (since % (86400 * USEC_PER_SEC) != 0)
+	return 0;
+      t = since / USEC_PER_SEC;
+      if (gmtime_r (&t, &tm) == NULL)
+	return 0;
+      strftime (day_from, len, "%Y-%m-%d", &tm);
     }
 
-  sqlite3_busy_timeout(*db, TIMEOUT);
-
-  if (empty_file)
-    r = create_table (*db, error);
+  if (until == 0)
+    snprintf (day_to, len, "9999-99-99");
+  else
+    {
+      if ((until + 1) % (86400 * USEC_PER_SEC) != 0)
+	return 0;
+      t = until / USEC_PER_SEC;
+      if (gmtime_r (&t, &tm) == NULL)
+	return 0;
+      strftime (day_to, len, "%Y-%m-%d", &tm);
+    }
 
-  return r == SQLITE_OK ? 0 : -1;
+  return 1;
 }
 
+/* Moves day_from to the first day still in wtmp. The days before
+   were rotated away completely, so a report from the rollup gets the
+   same numbers as one reading wtmp. Returns 0 on success. */
 static int
-open_database_rw (const char *path, sqlite3 **db, char **error)
+rollup_first_day (sqlite3 *db, char *day_from, size_t len)
 {
+  sqlite3_stmt *res;
+  int interned = is_interned (db, NULL);
   int r;
 
-  char *buf = strdup(path);
-  mkdir_p(dirname(buf), 0755);
-  free(buf);
-
-#if WITH_WTMPDBD
-  mode_t old_umask = umask(0077);
-#endif
-
-  r = sqlite3_open (path, db);
-#if WITH_WTMPDBD
-  umask (old_umask);
-#endif
-  if (r != SQLITE_OK)
+  if (interned < 0)
+    return -1;
+  /* with wtmp_login an index seek */
+  if (sqlite3_prepare_v2 (db, interned ?
+			  "SELECT date(MIN(Login)/1000000, 'unixepoch') FROM wtmp_data" :
+			  "SELECT date(MIN(Login)/1000000, 'unixepoch') FROM wtmp",
+			  -1, &res, 0) != SQLITE_OK)
+    return -1;
+
+  r = sqlite3_step (res);
+  if (r == SQLITE_ROW)
     {
-      if (error)
-	if (asprintf (error, "Cannot create/open database (%s): %s",
-		      path, sqlite3_errmsg (*db)) < 0)
-	  *error = strdup ("open_database_rw: Out of memory");
+      const char *first = (const char *) sqlite3_column_text (res, 0);
 
-      sqlite3_close (*db);
-      *db = NULL;
-      return -r;
+      /* an empty wtmp leaves no day */
+      if (first == NULL)
+	snprintf (day_from, len, "9999-99-99");
+      else if (strcmp (first, day_from) > 0)
+	snprintf (day_from, len, "%s", first);
     }
+  sqlite3_finalize (res);
 
-  sqlite3_busy_timeout(*db, TIMEOUT);
-
-  r = create_table (*db, error);
-  return r == SQLITE_OK ? 0 : -1;
+  return r == SQLITE_ROW ? 0 : -1;
 }
 
-/* Add a new entry. Returns ID (>=0) on success, -1 on failure. */
-static int64_t
-add_entry (sqlite3 *db, int type, const char *user,
-	   uint64_t usec_login, const char *tty, const char *rhost,
-	   const char *service, char **error)
+/* Aggregates the sessions (USER_PROCESS entries) with a login time
+   in the given range. Columns of the result: Key, Sessions, Seconds,
+   Users, Hosts. Seconds is the sum of the length of all closed
+   sessions, every session rounded down to full seconds like last
+   does. */
+int
+sqlite_report (const char *db_path, int group_by,
+	       uint64_t since, uint64_t until, unsigned int limit,
+	       int (*cb_func)(void *unused, int argc, char **argv,
+			      char **azColName),
+	       void *userdata, char **error)
 {
-  sqlite3_stmt *res;
-  char *sql_insert = "INSERT INTO wtmp (Type,User,Login,TTY,RemoteHost,Service) VALUES(?,?,?,?,?,?);";
+  struct time_bucket bucket = { .start = 0, .end = 0 };
+  sqlite3 *db;
+  char *err_msg = 0;
+  const char *key;
+  const char *id_key, *id_name;
+  int by_time = 0;
+  char *sql;
+  int r;
 
-  if (sqlite3_prepare_v2 (db, sql_insert, -1, &res, 0) != SQLITE_OK)
+  /* With interned strings, group by the IDs and look up only the
+     names of the groups. NULL and the empty string are one group
+     in both cases. */
+#define ID_KEY(col, tbl) "IFNULL(" col ", (SELECT ID FROM " tbl " WHERE Name = ''))"
+#define ID_NAME(tbl) "IFNULL((SELECT Name FROM " tbl " WHERE ID = K), '')"
+  switch (group_by)
     {
+    case WTMPDB_REPORT_USER:
+      key = "User";
+      id_key = ID_KEY ("UserID", "wtmp_users");
+      id_name = ID_NAME ("wtmp_users");
+      break;
+    case WTMPDB_REPORT_HOST:
+      key = "IFNULL(RemoteHost, '')";
+      id_key = ID_KEY ("HostID", "wtmp_hosts");
+      id_name = ID_NAME ("wtmp_hosts");
+      break;
+    case WTMPDB_REPORT_SERVICE:
+      key = "IFNULL(Service, '')";
+      id_key = ID_KEY ("ServiceID", "wtmp_services");
+      id_name = ID_NAME ("wtmp_services");
+      break;
+    case WTMPDB_REPORT_TTY:
+      key = "IFNULL(TTY, '')";
+      id_key = ID_KEY ("TTYID", "wtmp_ttys");
+      id_name = ID_NAME ("wtmp_ttys");
+      break;
+    case WTMPDB_REPORT_DAY:
+    case WTMPDB_REPORT_HOUR:
+      key = id_key = "time_bucket(Login)";
+      id_name = "K";
+      bucket.hour = (group_by == WTMPDB_REPORT_HOUR);
+      by_time = 1;
+      break;
+    default:
       if (error)
-        if (asprintf (error, "Failed to prepare statement (add_entry): %s",
-                      sqlite3_errmsg (db)) < 0)
-          *error = strdup ("add_entry: Out of memory");
-
-      return -1;
+	if (asprintf (error, "sqlite_report: invalid group %d", group_by) < 0)
+	  *error = strdup ("sqlite_report: Out of memory");
+      return -EINVAL;
     }
 
-  if (sqlite3_bind_int (res, 1, type) != SQLITE_OK)
-    {
-      if (error)
-        if (asprintf (error, "Failed to create add statement for 'type': %s",
-                      sqlite3_errmsg (db)) < 0)
-          *error = strdup("add_entry: Out of memory");
+  r = open_database_ro (db_path, &db, error);
+  if (r != 0)
+    return -r;
 
-      sqlite3_finalize(res);
-      return -1;
+  if (by_time)
+    {
+      tzset ();
+      r = sqlite3_create_function (db, "time_bucket", 1,
+				   SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+				   &bucket, time_bucket_func, NULL, NULL);
+      if (r != SQLITE_OK)
+	{
+	  if (error)
+	    if (asprintf (error, "sqlite_report: cannot create function: %s",
+			  sqlite3_errmsg (db)) < 0)
+	      *error = strdup ("sqlite_report: Out of memory");
+	  close_database_ro (db);
+	  return -1;
+	}
     }
 
-  if (sqlite3_bind_text (res, 2, user, -1, SQLITE_STATIC) != SQLITE_OK)
-    {
-      if (error)
-        if (asprintf (error, "Failed to create add statement for 'user': %s",
-                      sqlite3_errmsg (db)) < 0)
-          *error = strdup ("add_entry: Out of memory");
+  char day_from[16], day_to[16];
+  const char *rollup_key = NULL;
 
-      sqlite3_finalize (res);
-      return -1;
+  switch (group_by)
+    {
+    case WTMPDB_REPORT_USER:
+      rollup_key = "User";
+      break;
+    case WTMPDB_REPORT_SERVICE:
+      rollup_key = "NULLIF(Service, '')";
+      break;
+    case WTMPDB_REPORT_DAY:
+      /* the report groups by local days, the rollup by UTC days */
+      if (timezone == 0 && !daylight)
+	rollup_key = "Day";
+      break;
     }
 
-  if (sqlite3_bind_int64 (res, 3, usec_login) != SQLITE_OK)
+  /* Reports over whole UTC days by user, service or day are answered
+     from the rollup, if it exists. */
+  if (rollup_key &&
+      rollup_range (since, until, day_from, day_to, sizeof (day_from)) &&
+      has_rollup (db, NULL) == 1 &&
+      rollup_first_day (db, day_from, sizeof (day_from)) == 0)
+    sql = sqlite3_mprintf ("SELECT d.Key AS Key, Sessions, Seconds, Users, IFNULL(Hosts, 0) AS Hosts FROM "
+			   "(SELECT %s AS Key, SUM(Sessions) AS Sessions, SUM(Seconds) AS Seconds, "
+			   "%s AS Users FROM wtmp_daily WHERE Day >= %Q AND Day <= %Q GROUP BY Key) d "
+			   "LEFT JOIN "
+			   "(SELECT %s AS Key, COUNT(DISTINCT RemoteHost) AS Hosts FROM wtmp_daily_hosts "
+			   "WHERE Day >= %Q AND Day <= %Q GROUP BY Key) h "
+			   "ON d.Key IS h.Key ORDER BY %s LIMIT %lld",
+			   rollup_key,
+			   group_by == WTMPDB_REPORT_USER ? "1" : "COUNT(DISTINCT User)",
+			   day_from, day_to, rollup_key, day_from, day_to,
+			   by_time ? "Key ASC" : "Sessions DESC, Key ASC",
+			   limit ? (long long int)limit : -1LL);
+  else if (is_interned (db, NULL) == 1)
+    sql = sqlite3_mprintf ("SELECT %s AS Key, Sessions, Seconds, Users, Hosts FROM "
+			   "(SELECT %s AS K, COUNT(*) AS Sessions, "
+			   "SUM(CASE WHEN Logout > Login THEN (Logout - Login)/1000000 ELSE 0 END) AS Seconds, "
+			   "%s AS Users, %s AS Hosts "
+			   "FROM wtmp_data WHERE Type = %d AND Login >= %lld AND Login <= %lld "
+			   "GROUP BY K) ORDER BY %s LIMIT %lld",
+			   id_name, id_key,
+			   group_by == WTMPDB_REPORT_USER ? "1" : "COUNT(DISTINCT UserID)",
+			   group_by == WTMPDB_REPORT_HOST ?
+			   "MAX(HostID IS NOT NULL AND HostID IS NOT (SELECT ID FROM wtmp_hosts WHERE Name = ''))" :
+			   "COUNT(DISTINCT HostID)",
+			   USER_PROCESS, (long long int)since,
+			   until ? (long long int)until : (long long int)INT64_MAX,
+			   by_time ? "Key ASC" : "Sessions DESC, Key ASC",
+			   limit ? (long long int)limit : -1LL);
+  else
     {
-      if (error)
-        if (asprintf (error, "Failed to create add statement for 'login' time (add_entry): %s",
-                      sqlite3_errmsg (db)) < 0)
-          *error = strdup("add_entry: Out of memory");
-
-      sqlite3_finalize(res);
-      return -1;
+      /* Every COUNT(DISTINCT) needs a temporary b-tree per group,
+	 avoid them if the result is known. */
+      sql = sqlite3_mprintf ("SELECT %s AS Key, COUNT(*) AS Sessions, "
+			     "SUM(CASE WHEN Logout > Login THEN (Logout - Login)/1000000 ELSE 0 END) AS Seconds, "
+			     "%s AS Users, %s AS Hosts "
+			     "FROM wtmp WHERE Type = %d AND Login >= %lld AND Login <= %lld "
+			     "GROUP BY Key ORDER BY %s LIMIT %lld",
+			     key,
+			     group_by == WTMPDB_REPORT_USER ? "1" : "COUNT(DISTINCT User)",
+			     group_by == WTMPDB_REPORT_HOST ? "MAX(IFNULL(RemoteHost, '') != '')" : "COUNT(DISTINCT RemoteHost)",
+			     USER_PROCESS, (long long int)since,
+			     until ? (long long int)until : (long long int)INT64_MAX,
+			     by_time ? "Key ASC" : "Sessions DESC, Key ASC",
+			     limit ? (long long int)limit : -1LL);
     }
 
-  if (sqlite3_bind_text (res, 4, tty, -1, SQLITE_STATIC) != SQLITE_OK)
+  if (sql == NULL)
     {
+      close_database_ro (db);
       if (error)
-        if (asprintf (error, "Failed to create add statement for 'tty': %s",
-                      sqlite3_errmsg (db)) < 0)
-          *error = strdup("add_entry: Out of memory");
-
-      sqlite3_finalize(res);
+	*error = strdup ("sqlite_report: Out of memory");
       return -1;
     }
 
-  if (sqlite3_bind_text (res, 5, rhost, -1, SQLITE_STATIC) != SQLITE_OK)
+  r = sqlite3_exec (db, sql, cb_func, userdata, &err_msg);
+  sqlite3_free (sql);
+  /* bucket is gone after return, but the connection may be reused */
+  if (by_time)
+    sqlite3_create_function (db, "time_bucket", 1, SQLITE_UTF8,
+			     NULL, NULL, NULL, NULL);
+  close_database_ro (db);
+  if (r != SQLITE_OK)
     {
       if (error)
-        if (asprintf (error, "Failed to create add statement for 'rhost': %s",
-                      sqlite3_errmsg (db)) < 0)
-          *error = strdup("add_entry: Out of memory");
+        if (asprintf (error, "sqlite_report: SQL error: %s", err_msg) < 0)
+          *error = strdup ("sqlite_report: Out of memory");
 
-      sqlite3_finalize(res);
-      return -1;
+      sqlite3_free (err_msg);
+      return -r;
     }
 
-  if (sqlite3_bind_text (res, 6, service, -1, SQLITE_STATIC) != SQLITE_OK)
-    {
-      if (error)
-        if (asprintf (error, "Failed to create add statement for 'service': %s",
-                      sqlite3_errmsg (db)) < 0)
-          *error = strdup("add_entry: Out of memory");
+  return 0;
+}
 
-      sqlite3_finalize(res);
-      return -1;
-    }
+/* Sweep line over the logins and logouts for sqlite_concurrency.
+   Only the logout times of the active sessions are kept, in a min
+   heap, so the memory depends on the number of concurrent sessions,
+   not on the size of the history. Sessions are active from login
+   until, but not including, logout. */
+struct sweep {
+  uint64_t *logouts; /* heap of the active closed sessions */
+  size_t n_logouts;
+  size_t max_logouts;
+  uint64_t unbounded; /* active sessions without logout */
+  uint64_t bucket;
+  uint64_t start; /* of the current bucket */
+  uint64_t peak;
+  uint64_t sessions;
+  int started;
+  int aborted;
+  int (*cb_func)(void *unused, int argc, char **argv, char **azColName);
+  void *userdata;
+};
 
-  int step = sqlite3_step (res);
+static int
+sweep_push (struct sweep *s, uint64_t logout)
+{
+  size_t i;
 
-  if (step != SQLITE_DONE)
+  if (s->n_logouts == s->max_logouts)
     {
-      if (error)
-        if (asprintf (error, "Adding an entry failed: %s",
-                      sqlite3_errstr(step)) < 0)
-          *error = strdup("add_entry: Out of memory");
+      size_t n = s->max_logouts ? s->max_logouts * 2 : 64;
+      uint64_t *p = realloc (s->logouts, n * sizeof (uint64_t));
 
-      sqlite3_finalize(res);
-      return -1;
+      if (p == NULL)
+	return -ENOMEM;
+      s->logouts = p;
+      s->max_logouts = n;
     }
 
-  sqlite3_finalize(res);
+  for (i = s->n_logouts++; i > 0 && s->logouts[(i - 1) / 2] > logout;
+       i = (i - 1) / 2)
+    s->logouts[i] = s->logouts[(i - 1) / 2];
+  s->logouts[i] = logout;
 
-  return sqlite3_last_insert_rowid(db);
+  return 0;
 }
 
-/*
-  Add new wtmp entry to db.
-  login timestamp is in usec.
-  Returns ID on success, < 0 on failure.
- */
-int64_t
-sqlite_login(const char *db_path, int type, const char *user,
-	     uint64_t usec_login, const char *tty, const char *rhost,
-	     const char *service, char **error)
+static void
+sweep_pop (struct sweep *s)
 {
-  sqlite3 *db;
-  int64_t id;
-  int r;
+  uint64_t last = s->logouts[--s->n_logouts];
+  size_t i = 0;
 
-  r = open_database_rw(db_path, &db, error);
-  if (r < 0)
-    return r;
+  for (;;)
+    {
+      size_t c = 2 * i + 1;
+
+      if (c >= s->n_logouts)
+	break;
+      if (c + 1 < s->n_logouts && s->logouts[c + 1] < s->logouts[c])
+	c++;
+      if (s->logouts[c] >= last)
+	break;
+      s->logouts[i] = s->logouts[c];
+      i = c;
+    }
+  s->logouts[i] = last;
+}
+
+static uint64_t
+sweep_active (const struct sweep *s)
+{
+  return s->n_logouts + s->unbounded;
+}
 
-  id = add_entry(db, type, user, usec_login, tty, rhost, service, error);
+static void
+sweep_emit (struct sweep *s)
+{
+  static char *azColName[3] = {"Start", "Peak", "Sessions"};
+  char start[21], peak[21], sessions[21];
+  char *argv[3] = {start, peak, sessions};
+
+  snprintf (start, sizeof (start), "%" PRIu64, s->start);
+  snprintf (peak, sizeof (peak), "%" PRIu64, s->peak);
+  snprintf (sessions, sizeof (sessions), "%" PRIu64, s->sessions);
+  if (s->cb_func (s->userdata, 3, argv, azColName) != 0)
+    s->aborted = 1;
+}
 
-  sqlite3_close(db);
+/* Processes all logouts and bucket ends until t. */
+static void
+sweep_advance (struct sweep *s, uint64_t t)
+{
+  while (!s->aborted)
+    {
+      uint64_t end = s->start + s->bucket;
 
-  return id;
+      if (s->n_logouts > 0 && s->logouts[0] <= t && s->logouts[0] <= end)
+	sweep_pop (s);
+      else if (end <= t)
+	{
+	  sweep_emit (s);
+	  s->start = end;
+	  s->peak = s->sessions = sweep_active (s);
+	}
+      else
+	break;
+    }
 }
 
-/* Updates logout field.
-   logout timestamp is in usec.
-   Returns 0 on success, < 0 on failure. */
 static int
-update_logout (sqlite3 *db, int64_t id, uint64_t usec_logout, char **error)
+sweep_login (struct sweep *s, uint64_t login, uint64_t logout)
 {
-  sqlite3_stmt *res;
-  char *sql = "UPDATE wtmp SET Logout = ? WHERE ID = ?";
-
-  if (sqlite3_prepare_v2 (db, sql, -1, &res, 0) != SQLITE_OK)
+  if (!s->started)
     {
-      if (error)
-        if (asprintf (error, "Failed to prepare statement (update_logout): %s",
-                      sqlite3_errmsg (db)) < 0)
-          *error = strdup ("update_logout: Out of memory");
+      s->start = login - login % s->bucket;
+      s->started = 1;
+    }
+  sweep_advance (s, login);
 
-      return -1;
+  s->sessions++;
+  if (logout == 0)
+    s->unbounded++;
+  else if (logout > login)
+    {
+      int r = sweep_push (s, logout);
+      if (r < 0)
+	return r;
     }
+  if (sweep_active (s) > s->peak)
+    s->peak = sweep_active (s);
 
-  if (sqlite3_bind_int64 (res, 1, usec_logout) != SQLITE_OK)
+  return 0;
+}
+
+/* Sessions without logout end with the next boot. */
+static void
+sweep_boot (struct sweep *s, uint64_t boot)
+{
+  if (!s->started)
+    return;
+  sweep_advance (s, boot);
+  s->unbounded = 0;
+}
+
+/* Runs the rows of sql, Type, Login and Logout, through the sweep. */
+static int
+sweep_rows (sqlite3 *db, struct sweep *s, const char *sql, char **error)
+{
+  sqlite3_stmt *res;
+  int r = SQLITE_DONE;
+
+  if (sql == NULL)
     {
       if (error)
-        if (asprintf (error, "Failed to create update query (logout): %s",
-                      sqlite3_errmsg (db)) < 0)
-          *error = strdup("update_logout: Out of memory");
-
-      sqlite3_finalize(res);
-      return -1;
+	*error = strdup ("sqlite_concurrency: Out of memory");
+      return -ENOMEM;
     }
 
-  if (sqlite3_bind_int64 (res, 2, id) != SQLITE_OK)
+  if (sqlite3_prepare_v2 (db, sql, -1, &res, 0) != SQLITE_OK)
     {
       if (error)
-        if (asprintf (error, "Failed to create update query (ID): %s",
-                      sqlite3_errmsg (db)) < 0)
-          *error = strdup("update_logout: Out of memory");
-
-      sqlite3_finalize(res);
+	if (asprintf (error, "sqlite_concurrency: Failed to execute statement: %s",
+		      sqlite3_errmsg (db)) < 0)
+	  *error = strdup ("sqlite_concurrency: Out of memory");
       return -1;
     }
 
-  int step = sqlite3_step (res);
-
-  if (step != SQLITE_DONE)
+  while (!s->aborted && (r = sqlite3_step (res)) == SQLITE_ROW)
     {
-      if (error)
-        if (asprintf (error, "Updating logout time failed: %s",
-                      sqlite3_errstr(step)) < 0)
-          *error = strdup("update_logout: Out of memory");
+      uint64_t login = sqlite3_column_int64 (res, 1);
 
-      sqlite3_finalize(res);
-      return -1;
+      if (sqlite3_column_int (res, 0) == BOOT_TIME)
+	sweep_boot (s, login);
+      else if ((r = sweep_login (s, login, sqlite3_column_int64 (res, 2))) < 0)
+	{
+	  sqlite3_finalize (res);
+	  if (error)
+	    *error = strdup ("sqlite_concurrency: Out of memory");
+	  return r;
+	}
     }
+  sqlite3_finalize (res);
 
-  int changes;
-  if ((changes = sqlite3_changes (db)) != 1)
+  if (!s->aborted && r != SQLITE_DONE)
     {
       if (error)
-        if (asprintf (error, "Update of logout time changed wrong number of rows, expected 1, got %d",
-                      changes) < 0)
-          *error = strdup("update_logout: Out of memory");
-
-      sqlite3_finalize(res);
+	if (asprintf (error, "sqlite_concurrency: SQL error: %s",
+		      sqlite3_errmsg (db)) < 0)
+	  *error = strdup ("sqlite_concurrency: Out of memory");
       return -1;
     }
 
-  sqlite3_finalize (res);
-
   return 0;
 }
 
-
-/*
-  Add logout timestamp to existingentry.
-  logout timestamp is in usec.
-  ID is the return value of wtmpdb_login/logwtmpdb.
-  Returns 0 on success, < 0 on failure.
- */
+/* Computes the peak number of concurrent sessions (USER_PROCESS
+   entries) per bucket of bucket usec between since and until (0 means
+   the first login and now). Buckets are aligned to multiples of their
+   size since the epoch. Columns of the result: Start (usec), Peak and
+   Sessions, the number of sessions active in the bucket. The entries
+   are read once in the order of the login time, open sessions end
+   with the next boot. A return value != 0 of cb_func stops. */
 int
-sqlite_logout (const char *db_path, int64_t id, uint64_t usec_logout,
-	       char **error)
+sqlite_concurrency (const char *db_path, uint64_t since, uint64_t until,
+		    uint64_t bucket,
+		    int (*cb_func)(void *unused, int argc, char **argv,
+				   char **azColName),
+		    void *userdata, char **error)
 {
+  struct sweep s = {
+    .bucket = bucket,
+    .cb_func = cb_func,
+    .userdata = userdata,
+  };
   sqlite3 *db;
+  char *sql;
   int r;
 
-  r = open_database_rw (db_path, &db, error);
-  if (r < 0)
-    return r;
+  if (bucket == 0)
+    {
+      if (error)
+	*error = strdup ("sqlite_concurrency: bucket size must not be 0");
+      return -EINVAL;
+    }
 
-  r = update_logout(db, id, usec_logout, error);
+  if (until == 0)
+    {
+      struct timespec ts;
 
-  sqlite3_close (db);
+      clock_gettime (CLOCK_REALTIME, &ts);
+      until = wtmpdb_timespec2usec (ts);
+    }
+  if (until > INT64_MAX)
+    until = INT64_MAX;
+
+  r = open_database_ro (db_path, &db, error);
+  if (r != 0)
+    return -r;
+
+  if (since > 0)
+    {
+      /* the sessions active at the start of the first bucket, which
+	 all logged in since the last boot before it */
+      s.start = since - since % bucket;
+      s.started = 1;
+      sql = sqlite3_mprintf ("SELECT Type, Login, Logout FROM wtmp WHERE Type = %d "
+			     "AND Login <= %lld AND Login >= IFNULL((SELECT Login FROM wtmp "
+			     "WHERE Type = %d AND Login <= %lld "
+			     "ORDER BY Login DESC LIMIT 1), 0) "
+			     "AND (Logout IS NULL OR Logout > %lld) ORDER BY Login",
+			     USER_PROCESS, (long long int)s.start, BOOT_TIME,
+			     (long long int)s.start, (long long int)s.start);
+      r = sweep_rows (db, &s, sql, error);
+      sqlite3_free (sql);
+      if (r < 0)
+	goto out;
+      /* they were all active before */
+      s.sessions = s.peak = sweep_active (&s);
+    }
+
+  sql = sqlite3_mprintf ("SELECT Type, Login, Logout FROM wtmp "
+			 "WHERE Type IN (%d, %d) AND Login > %lld AND Login <= %lld "
+			 "ORDER BY Login",
+			 BOOT_TIME, USER_PROCESS, (long long int)s.start,
+			 (long long int)until);
+  r = sweep_rows (db, &s, sql, error);
+  sqlite3_free (sql);
+  if (r < 0)
+    goto out;
+
+  if (s.started)
+    {
+      sweep_advance (&s, until);
+      if (!s.aborted)
+	sweep_emit (&s);
+    }
 
+ out:
+  free (s.logouts);
+  close_database_ro (db);
   return r;
 }
 
-static int64_t
-search_id (sqlite3 *db, const char *tty, char **error)
+/* Number of entries moved per transaction. The source database is
+   only locked while a batch is moved, so other writers get a chance
+   to run between batches. */
+#define ROTATE_BATCH 1000
+
+/* Counts all entries with Login <= login_t.
+   Returns 0 on success, <0 on failure. */
+static int
+count_rotate_entries (sqlite3 *db, uint64_t login_t, uint64_t *count,
+		      char **error)
 {
-  int64_t id = -1;
   sqlite3_stmt *res;
-  char *sql = "SELECT ID FROM wtmp WHERE TTY = ? AND Logout IS NULL ORDER BY Login DESC LIMIT 1";
+  char *sql = "SELECT COUNT(*) FROM wtmp WHERE Login <= ?";
 
   if (sqlite3_prepare_v2 (db, sql, -1, &res, 0) != SQLITE_OK)
     {
-      int r = -ENOTSUP;
       if (error)
-        if (asprintf (error, "Failed to prepare statement (search_id): %s",
-                      sqlite3_errmsg (db)) < 0)
-	  {
-	    r = -ENOMEM;
-	    *error = strdup ("search_id: Out of memory");
-	  }
-      return r;
+        if (asprintf (error, "Failed to prepare statement %s (sqlite_rotate): %s",
+		      sql, sqlite3_errmsg (db)) < 0)
+          *error = strdup ("sqlite_rotate: Out of memory");
+      return -1;
     }
 
-  if (sqlite3_bind_text (res, 1, tty, -1, SQLITE_STATIC) != SQLITE_OK)
+  if (sqlite3_bind_int64 (res, 1, login_t) != SQLITE_OK)
     {
-      int r = -EPROTO;
       if (error)
-        if (asprintf (error, "Failed to create search query 'tty': %s",
+        if (asprintf (error, "Failed to create count statement for 'login' time: %s",
                       sqlite3_errmsg (db)) < 0)
-	  {
-	    r = -ENOMEM;
-	    *error = strdup("search_id: Out of memory");
-	  }
+          *error = strdup("sqlite_rotate: Out of memory");
 
       sqlite3_finalize(res);
-      return r;
+      return -1;
     }
 
   int step = sqlite3_step (res);
 
-  if (step == SQLITE_ROW)
-    id = sqlite3_column_int64 (res, 0);
-  else if (step == SQLITE_DONE)
-    {
-      id = -ENOENT;
-      if (error)
-        if (asprintf (error, "Open entry for tty '%s' not found (search_id)", tty) < 0)
-	  {
-	    *error = strdup("search_id: Out of memory");
-	    id = -ENOMEM;
-	  }
-    }
-  else
+  if (step != SQLITE_ROW)
     {
-      id = -ENOENT;
       if (error)
-        if (asprintf (error, "Error searching open entry for tty '%s': %s",
-		      tty, sqlite3_errstr(step)) < 0)
-	  {
-	    *error = strdup("search_id: Out of memory");
-	    id = -ENOMEM;
-	  }
-    }
-
-  sqlite3_finalize (res);
-
-  return id;
-}
-
-int64_t
-sqlite_get_id (const char *db_path, const char *tty, char **error)
-{
-  sqlite3 *db;
-  int64_t retval;
-  int r;
-
-  r = open_database_ro (db_path, &db, error);
-  if (r != 0)
-    return -r;
+        if (asprintf (error, "Error counting entries to rotate: %s",
+                      sqlite3_errstr(step)) < 0)
+          *error = strdup("sqlite_rotate: Out of memory");
 
-  retval = search_id (db, tty, error);
+      sqlite3_finalize(res);
+      return -1;
+    }
 
-  sqlite3_close (db);
+  *count = sqlite3_column_int64 (res, 0);
+  sqlite3_finalize(res);
 
-  return retval;
+  return 0;
 }
 
-/* Reads all entries from database and calls the callback function for
-   each entry.
-   Returns 0 on success, -1 on failure. */
-int
-sqlite_read_all (const char *db_path,
-		 int (*cb_func)(void *unused, int argc, char **argv,
-				char **azColName),
-		 void *userdata, char **error)
+/* Moves up to ROTATE_BATCH entries with Login <= login_t and
+   ID > *last_id from db_src to the attached database "archive".
+   Copy and delete run in one transaction of db_src, so a logout
+   cannot change a copied entry before it is deleted, and an error
+   leaves the entry in exactly one of both databases. *last_id is
+   updated to the ID of the last moved entry.
+   Returns the number of moved entries, <0 on failure. */
+static int
+rotate_batch (sqlite3 *db_src, uint64_t login_t, int64_t *last_id,
+	      char **error)
 {
-  sqlite3 *db;
-  char *err_msg = 0;
+  sqlite3_stmt *res;
+  char *sql_range = "SELECT COUNT(*), IFNULL(MAX(ID), 0) FROM "
+    "(SELECT ID FROM main.wtmp WHERE ID > ? AND Login <= ? ORDER BY ID LIMIT ?)";
+  char *sql_copy = "INSERT INTO archive.wtmp (Type, User, Login, Logout, TTY, RemoteHost, Service) "
+    "SELECT Type, User, Login, Logout, TTY, RemoteHost, Service FROM main.wtmp "
+    "WHERE ID > ?1 AND ID <= ?2 AND Login <= ?3 ORDER BY ID";
+  char *sql_delete = "DELETE FROM main.wtmp WHERE ID > ?1 AND ID <= ?2 AND Login <= ?3";
+  int64_t first_id = *last_id;
+  int64_t batch_id = 0;
+  int counter = 0;
   int r;
 
-  r = open_database_ro (db_path, &db, error);
-  if (r != 0)
-    return -r;
+  /* every batch is a write of its own, with its own timeout */
+  busy_start ();
+  if ((r = exec_sql (db_src, "BEGIN IMMEDIATE", "starting rotation", error)) < 0)
+    return r;
 
-  char *sql = "SELECT * FROM wtmp ORDER BY Login DESC, Logout ASC";
+  if (sqlite3_prepare_v2 (db_src, sql_range, -1, &res, 0) != SQLITE_OK)
+    {
+      if (error)
+        if (asprintf (error, "Failed to prepare statement %s (sqlite_rotate): %s",
+		      sql_range, sqlite3_errmsg (db_src)) < 0)
+          *error = strdup ("sqlite_rotate: Out of memory");
+      sqlite3_exec (db_src, "ROLLBACK", 0, 0, NULL);
+      return -1;
+    }
 
-  r = sqlite3_exec (db, sql, cb_func, userdata, &err_msg);
-  sqlite3_close (db);
-  if (r != SQLITE_OK)
+  if (sqlite3_bind_int64 (res, 1, first_id) != SQLITE_OK ||
+      sqlite3_bind_int64 (res, 2, login_t) != SQLITE_OK ||
+      sqlite3_bind_int (res, 3, ROTATE_BATCH) != SQLITE_OK ||
+      sqlite3_step (res) != SQLITE_ROW)
     {
       if (error)
-        if (asprintf (error, "sqlite_read_all: SQL error: %s", err_msg) < 0)
-          *error = strdup ("sqlite_read_all: Out of memory");
+        if (asprintf (error, "Error selecting entries to rotate: %s",
+                      sqlite3_errmsg (db_src)) < 0)
+          *error = strdup("sqlite_rotate: Out of memory");
 
-      sqlite3_free (err_msg);
-      return -r;
+      sqlite3_finalize(res);
+      sqlite3_exec (db_src, "ROLLBACK", 0, 0, NULL);
+      return -1;
     }
+  counter = sqlite3_column_int (res, 0);
+  batch_id = sqlite3_column_int64 (res, 1);
+  sqlite3_finalize(res);
 
-  return 0;
-}
+  for (int i = 0; counter > 0 && i < 2; i++)
+    {
+      const char *sql = i == 0 ? sql_copy : sql_delete;
 
-static int
-export_row (sqlite3 *db_dest, sqlite3_stmt *sqlStatement, char **error)
-{
-  char *endptr;
-
-  const int type = sqlite3_column_int( sqlStatement, 1 );
-  const char *user = (const char*)sqlite3_column_text( sqlStatement, 2 );
-  const char *tty = (const char*)sqlite3_column_text( sqlStatement, 5 );
-  const char *host = (const char*)sqlite3_column_text( sqlStatement, 6 );
-  const char *service = (const char*)sqlite3_column_text( sqlStatement, 7 );
-  uint64_t login_t = strtoul((const char*)sqlite3_column_text( sqlStatement, 3 ), &endptr, 10);
-  if ((errno == ERANGE && login_t == UINT64_MAX)
-      || (endptr == (const char *)sqlite3_column_text( sqlStatement, 3 )) || (*endptr != '\0'))
-    fprintf (stderr, "export_row: Invalid numeric time entry for 'login': '%s'\n",
-	     sqlite3_column_text( sqlStatement, 5 ));
-
-  int64_t id = add_entry (db_dest, type, user, login_t, tty, host,
-			  service, error);
-  if (id >=0)
-    {
-      const char *logout = (const char*)sqlite3_column_text( sqlStatement, 4 );
-      if (logout)
+      if (sqlite3_prepare_v2 (db_src, sql, -1, &res, 0) != SQLITE_OK)
 	{
-          uint64_t logout_t = strtoul(logout, &endptr, 10);
-	  if ((errno == ERANGE && logout_t == INT64_MAX)
-	      || (endptr == logout) || (*endptr != '\0'))
-	  {
-	    fprintf (stderr, "export_row: Invalid numeric time entry for 'logout': '%s'\n", sqlite3_column_text( sqlStatement, 3 ));
-	    return -1;
-	  }
-          if (update_logout (db_dest, id, logout_t, error) == -1)
-	  {
-            fprintf (stderr, "export_row: Cannot update DB value: '%s'\n", *error);
-	    return -1;
-	  }
+	  if (error)
+	    if (asprintf (error, "Failed to prepare statement %s (sqlite_rotate): %s",
+			  sql, sqlite3_errmsg (db_src)) < 0)
+	      *error = strdup ("sqlite_rotate: Out of memory");
+	  sqlite3_exec (db_src, "ROLLBACK", 0, 0, NULL);
+	  return -1;
+	}
+
+      if (sqlite3_bind_int64 (res, 1, first_id) != SQLITE_OK ||
+	  sqlite3_bind_int64 (res, 2, batch_id) != SQLITE_OK ||
+	  sqlite3_bind_int64 (res, 3, login_t) != SQLITE_OK ||
+	  sqlite3_step (res) != SQLITE_DONE)
+	{
+	  if (error)
+	    if (asprintf (error, "Error rotating entries: %s",
+			  sqlite3_errmsg (db_src)) < 0)
+	      *error = strdup("sqlite_rotate: Out of memory");
+
+	  sqlite3_finalize(res);
+	  sqlite3_exec (db_src, "ROLLBACK", 0, 0, NULL);
+	  return -1;
 	}
+      sqlite3_finalize(res);
     }
-  else
+
+  if ((r = exec_sql (db_src, "COMMIT", "committing rotation", error)) < 0)
     {
-       fprintf (stderr, "export_row: Cannot insert DB value: '%s'\n", *error);
-       return -1;
+      sqlite3_exec (db_src, "ROLLBACK", 0, 0, NULL);
+      return r;
     }
 
-  return 0;
+  if (counter > 0)
+    *last_id = batch_id;
+  return counter;
 }
 
-/* Reads all entries from database and calls the callback function for
-   each entry.
+/* Moves all entries older than days into a new database.
+   progress_cb, if not NULL, is called after every batch with the
+   number of moved entries and the number of all entries to move,
+   a return value != 0 aborts the rotation.
    Returns 0 on success, <0 on failure. */
 int
 sqlite_rotate(const char *db_path, const int days, char **wtmpdb_name,
-	      uint64_t *entries, char **error)
+	      uint64_t *entries,
+	      int (*progress_cb)(void *userdata, uint64_t moved,
+				 uint64_t total),
+	      void *userdata, char **error)
 {
+  uint64_t start = probe_now ();
   sqlite3 *db_src;
   sqlite3 *db_dest;
   uint64_t counter = 0;
+  uint64_t total = 0;
+  int64_t last_id = -1;
   struct timespec threshold;
   clock_gettime (CLOCK_REALTIME, &threshold);
   threshold.tv_sec -= days * 86400;
@@ -563,6 +2995,7 @@ sqlite_rotate(const char *db_path, const int days, char **wtmpdb_name,
       return -ENOMEM;
     }
 
+  /* creates the archive with the current schema */
   r = open_database_rw(dest_path, &db_dest, error);
   if (r < 0)
     {
@@ -570,117 +3003,68 @@ sqlite_rotate(const char *db_path, const int days, char **wtmpdb_name,
       free(dest_file);
       return r;
     }
+  /* The archive is a plain file without -wal and -shm, to be moved
+     or compressed like any other. So with wtmp in WAL mode, every
+     batch is committed in both files one after the other, a crash
+     in between leaves the batch in both. */
+  int persist = 0;
+  sqlite3_file_control (db_dest, "main", SQLITE_FCNTL_PERSIST_WAL, &persist);
+  sqlite3_exec (db_dest, "PRAGMA journal_mode = DELETE", 0, 0, NULL);
+  sqlite3_close (db_dest);
 
   r = open_database_rw (db_path, &db_src, error);
   if (r < 0)
     {
       free(dest_path);
       free(dest_file);
-      sqlite3_close (db_dest);
       return r;
     }
 
-  char *sql_select = "SELECT * FROM wtmp where Login <= ?";
-  sqlite3_stmt *res;
-  if (sqlite3_prepare_v2 (db_src, sql_select, -1, &res, 0) != SQLITE_OK)
+  char *sql = sqlite3_mprintf ("ATTACH DATABASE %Q AS archive", dest_path);
+  if (sql == NULL)
     {
       if (error)
-        if (asprintf (error, "Failed to prepare statement %s (sqlite_rotate): %s",
-		      sql_select,
-                      sqlite3_errmsg (db_src)) < 0)
-          *error = strdup ("sqlite_rotate: Out of memory");
-      sqlite3_close (db_src);
-      sqlite3_close (db_dest);
-      free(dest_path);
-      free(dest_file);
-      return -1;
+	*error = strdup ("sqlite_rotate: Out of memory");
+      r = -ENOMEM;
     }
-
-  if (sqlite3_bind_int64 (res, 1, login_t) != SQLITE_OK)
+  else
+    r = exec_sql (db_src, sql, "attaching archive", error);
+  sqlite3_free (sql);
+  if (r < 0)
     {
-      if (error)
-        if (asprintf (error, "Failed to create rotate statement for 'login' time: %s",
-                      sqlite3_errmsg (db_src)) < 0)
-          *error = strdup("sqlite_rotate: Out of memory");
-
-      sqlite3_finalize(res);
-      sqlite3_close (db_src);
-      sqlite3_close (db_dest);
       free(dest_path);
       free(dest_file);
-      return -1;
-    }
-
-  int rc;
-  while ((rc = sqlite3_step(res)) == SQLITE_ROW) {
-    export_row (db_dest, res, error);
-    ++counter;
-  }
-  if (rc != SQLITE_DONE)
-    {
-      if (asprintf (error, "SQL error rotating db: %s", sqlite3_errmsg(db_src)) < 0)
-	*error = strdup ("sqlite_rotate: Out of memory");
-
-      sqlite3_finalize(res);
       sqlite3_close (db_src);
-      sqlite3_close (db_dest);
-      free(dest_path);
-      free(dest_file);
-      return -1;
+      return r;
     }
 
-  sqlite3_finalize(res);
-
-  char *sql_delete = "DELETE FROM wtmp where Login <= ?";
-  if (sqlite3_prepare_v2 (db_src, sql_delete, -1, &res, 0) != SQLITE_OK)
-    {
-      if (error)
-        if (asprintf (error, "Failed to prepare statement %s (sqlite_rotate): %s",
-		      sql_delete,
-                      sqlite3_errmsg (db_src)) < 0)
-          *error = strdup ("sqlite_rotate: Out of memory");
-      sqlite3_close (db_src);
-      sqlite3_close (db_dest);
-      free(dest_path);
-      free(dest_file);
-      return -1;
-    }
+  /* With a rollup, move only whole UTC days, so that every day is
+     either completely in wtmp or not at all, see sqlite_report. */
+  if (has_rollup (db_src, NULL) == 1)
+    login_t -= (login_t + 1) % (86400 * USEC_PER_SEC);
 
-  if (sqlite3_bind_int64 (res, 1, login_t) != SQLITE_OK)
+  if (progress_cb)
     {
-      if (error)
-        if (asprintf (error, "Failed to create rotate statement for 'login' time: %s",
-                      sqlite3_errmsg (db_src)) < 0)
-          *error = strdup("sqlite_rotate: Out of memory");
-
-      sqlite3_finalize(res);
-      sqlite3_close (db_src);
-      sqlite3_close (db_dest);
-      free(dest_path);
-      free(dest_file);
-      return -1;
+      r = count_rotate_entries (db_src, login_t, &total, error);
+      if (r == 0 && progress_cb (userdata, 0, total) != 0)
+	r = -ECANCELED;
     }
 
-  int step = sqlite3_step (res);
-
-  if (step != SQLITE_DONE)
+  while (r == 0)
     {
-      if (error)
-        if (asprintf (error, "Error rotating entry: %s",
-                      sqlite3_errstr(step)) < 0)
-          *error = strdup("sqlite_rotate: Out of memory");
-
-      sqlite3_finalize(res);
-      sqlite3_close (db_src);
-      sqlite3_close (db_dest);
-      free(dest_path);
-      free(dest_file);
-      return -1;
+      r = rotate_batch (db_src, login_t, &last_id, error);
+      if (r <= 0)
+	break;
+      counter += r;
+      r = 0;
+      if (progress_cb && progress_cb (userdata, counter, total) != 0)
+	r = -ECANCELED;
     }
 
-  sqlite3_finalize(res);
   sqlite3_close (db_src);
-  sqlite3_close (db_dest);
+
+  if (r == -ECANCELED && error && *error == NULL)
+    *error = strdup ("sqlite_rotate: Rotation aborted");
 
   if (counter > 0)
     {
@@ -695,7 +3079,8 @@ sqlite_rotate(const char *db_path, const int days, char **wtmpdb_name,
   free(dest_path);
   free(dest_file);
 
-  return 0;
+  PROBE(sqlite_rotate, days, r < 0 ? r : 0, counter, probe_now () - start);
+  return r < 0 ? r : 0;
 }
 
 static uint64_t
@@ -748,7 +3133,7 @@ sqlite_get_boottime (const char *db_path,
 
   *boottime = search_boottime (db, error);
 
-  sqlite3_close (db);
+  close_database_ro (db);
 
   return 0;
 }
@@ -29,6 +29,11 @@
 
 #include <stdint.h>
 
+extern void sqlite_set_timeout (uint64_t usec_timeout);
+extern uint64_t sqlite_busy_retries (void);
+extern void sqlite_set_read_cache (int64_t mmap_size, int64_t cache_size);
+extern void sqlite_reuse_connection (int enable);
+
 extern int64_t sqlite_login (const char *db_path, int type, const char *user,
 			     uint64_t usec_login, const char *tty,
 			     const char *rhost, const char *service,
@@ -41,8 +46,49 @@ extern int sqlite_read_all (const char *db_path,
 			    int (*cb_func)(void *unused, int argc, char **argv,
 					   char **azColName),
 			    void *userdata, char **error);
+extern int sqlite_read_since_id (const char *db_path, int64_t after_id,
+				 int (*cb_func)(void *unused, int argc, char **argv,
+						char **azColName),
+				 void *userdata, char **error);
+extern int sqlite_read_id (const char *db_path, int64_t id,
+			   int (*cb_func)(void *unused, int argc, char **argv,
+					  char **azColName),
+			   void *userdata, char **error);
+extern int sqlite_read_page (const char *db_path, uint64_t before_login,
+			     int64_t before_id, unsigned int limit,
+			     int (*cb_func)(void *unused, int argc, char **argv,
+					    char **azColName),
+			     void *userdata, char **error);
+extern int sqlite_read_overlap (const char *db_path, uint64_t since,
+				uint64_t until,
+				int (*cb_func)(void *unused, int argc, char **argv,
+					       char **azColName),
+				void *userdata, char **error);
+extern int sqlite_read_present (const char *db_path, uint64_t at,
+				int (*cb_func)(void *unused, int argc, char **argv,
+					       char **azColName),
+				void *userdata, char **error);
+extern int sqlite_read_current (const char *db_path,
+				int (*cb_func)(void *unused, int argc, char **argv,
+					       char **azColName),
+				void *userdata, char **error);
+extern int sqlite_concurrency (const char *db_path, uint64_t since,
+			       uint64_t until, uint64_t bucket,
+			       int (*cb_func)(void *unused, int argc, char **argv,
+					      char **azColName),
+			       void *userdata, char **error);
+extern int sqlite_rollup (const char *db_path, int enable, char **error);
+extern int sqlite_intern (const char *db_path, int enable, char **error);
+extern int sqlite_migrate (const char *db_path, char **error);
+extern int sqlite_report (const char *db_path, int group_by,
+			  uint64_t since, uint64_t until, unsigned int limit,
+			  int (*cb_func)(void *unused, int argc, char **argv,
+					 char **azColName),
+			  void *userdata, char **error);
 extern int sqlite_get_boottime(const char *db_path, uint64_t *boottime,
 			       char **error);
 extern int sqlite_rotate (const char *db_path, const int days,
 			  char **wtmpdb_name, uint64_t *entries,
-			  char **error);
+			  int (*progress_cb)(void *userdata, uint64_t moved,
+					     uint64_t total),
+			  void *userdata, char **error);
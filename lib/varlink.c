@@ -37,27 +37,28 @@
 #include "basics.h"
 #include "varlink.h"
 #include "wtmpdb.h"
+#include "probes.h"
 
-/* Takes inspiration from Rust's Option::take() method: reads and returns a pointer, but at the same time
- * resets it to NULL. See: https://doc.rust-lang.org/std/option/enum.Option.html#method.take */
-#define TAKE_GENERIC(var, type, nullvalue)                       \
-        ({                                                       \
-                type *_pvar_ = &(var);                           \
-                type _var_ = *_pvar_;                            \
-                type _nullvalue_ = nullvalue;                    \
-                *_pvar_ = _nullvalue_;                           \
-                _var_;                                           \
-        })
-#define TAKE_PTR_TYPE(ptr, type) TAKE_GENERIC(ptr, type, NULL)
-#define TAKE_PTR(ptr) TAKE_PTR_TYPE(ptr, typeof(ptr))
+/* 0 means use the sd-varlink default */
+static uint64_t call_timeout = 0;
+
+/* Set the maximal time in usec a method call may take,
+   0 restores the default. */
+void
+varlink_set_timeout (uint64_t usec_timeout)
+{
+  call_timeout = usec_timeout;
+}
 
 static int
 connect_to_wtmpdbd(sd_varlink **ret, const char *socket, char **error)
 {
   _cleanup_(sd_varlink_unrefp) sd_varlink *link = NULL;
+  uint64_t start = probe_now ();
   int r;
 
   r = sd_varlink_connect_address(&link, socket);
+  PROBE(varlink_connect, socket, r < 0 ? r : 0, probe_now () - start);
   if (r < 0)
     {
       if (error)
@@ -67,10 +68,36 @@ connect_to_wtmpdbd(sd_varlink **ret, const char *socket, char **error)
       return r;
     }
 
+  if (call_timeout > 0)
+    {
+      r = sd_varlink_set_relative_timeout(link, call_timeout);
+      if (r < 0)
+	{
+	  if (error)
+	    if (asprintf (error, "Failed to set timeout for %s: %s",
+			  socket, strerror(-r)) < 0)
+	      *error = strdup ("Out of memory");
+	  return r;
+	}
+    }
+
   *ret = TAKE_PTR(link);
   return 0;
 }
 
+static int
+call_wtmpdbd (sd_varlink *link, const char *method,
+	      sd_json_variant *parameters, sd_json_variant **ret_parameters,
+	      const char **ret_error_id)
+{
+  uint64_t start = probe_now ();
+  int r;
+
+  r = sd_varlink_call(link, method, parameters, ret_parameters, ret_error_id);
+  PROBE(varlink_call, method, r < 0 ? r : 0, probe_now () - start);
+  return r;
+}
+
 struct id_error {
   int64_t id;
   char *error;
@@ -82,6 +109,16 @@ id_error_free (struct id_error *var)
   var->error = mfree(var->error);
 }
 
+/* wtmpdbd waited for the database as long as allowed, report it
+   like a locked database and not as failure. */
+static int
+error_to_errno (const char *error_id)
+{
+  if (strcmp (error_id, "org.openSUSE.wtmpdb.DatabaseBusy") == 0)
+    return -EBUSY;
+  return -EIO;
+}
+
 /*
   Add new wtmp entry to db via varlink
   login timestamp is in usec.
@@ -130,7 +167,7 @@ varlink_login (int type, const char *user, uint64_t usec_login,
     }
 
   const char *error_id;
-  r = sd_varlink_call(link, "org.openSUSE.wtmpdb.Login", params, &result, &error_id);
+  r = call_wtmpdbd(link, "org.openSUSE.wtmpdb.Login", params, &result, &error_id);
   if (r < 0)
     {
       if (error)
@@ -161,7 +198,7 @@ varlink_login (int type, const char *user, uint64_t usec_login,
 	  else
 	    *error = strdup(error_id);
 	}
-      return -EIO;
+      return error_to_errno (error_id);
     }
 
   return p.id;
@@ -212,7 +249,7 @@ varlink_logout (int64_t id, uint64_t usec_logout, char **error)
     }
 
   const char *error_id;
-  r = sd_varlink_call(link, "org.openSUSE.wtmpdb.Logout", params, &result, &error_id);
+  r = call_wtmpdbd(link, "org.openSUSE.wtmpdb.Logout", params, &result, &error_id);
   if (r < 0)
     {
       if (error)
@@ -243,7 +280,7 @@ varlink_logout (int64_t id, uint64_t usec_logout, char **error)
 	  else
 	    *error = strdup(error_id);
 	}
-      return -EIO;
+      return error_to_errno (error_id);
     }
 
   return 0;
@@ -282,7 +319,7 @@ varlink_get_id (const char *tty, char **error)
       return r;
     }
 
-  r = sd_varlink_call(link, "org.openSUSE.wtmpdb.GetID", params, &result, &error_id);
+  r = call_wtmpdbd(link, "org.openSUSE.wtmpdb.GetID", params, &result, &error_id);
   if (r < 0)
     {
       if (error)
@@ -357,7 +394,7 @@ varlink_get_boottime (uint64_t *boottime, char **error)
   if (r < 0)
     return r;
 
-  r = sd_varlink_call(link, "org.openSUSE.wtmpdb.GetBootTime", NULL, &result, &error_id);
+  r = call_wtmpdbd(link, "org.openSUSE.wtmpdb.GetBootTime", NULL, &result, &error_id);
   if (r < 0)
     {
       if (error)
@@ -437,6 +474,21 @@ varlink_rotate (const int days, char **backup_name, uint64_t *entries, char **er
   if (r < 0)
     return r;
 
+  /* Moving a large database can take longer than the default
+     varlink timeout, wait until it is done if not told otherwise. */
+  if (call_timeout == 0)
+    {
+      r = sd_varlink_set_relative_timeout(link, UINT64_MAX);
+      if (r < 0)
+	{
+	  if (error)
+	    if (asprintf (error, "Failed to set timeout: %s",
+			  strerror(-r)) < 0)
+	      *error = strdup ("Out of memory");
+	  return r;
+	}
+    }
+
   r = sd_json_buildo(&params, SD_JSON_BUILD_PAIR("Days", SD_JSON_BUILD_INTEGER(days)));
   if (r < 0)
     {
@@ -448,7 +500,7 @@ varlink_rotate (const int days, char **backup_name, uint64_t *entries, char **er
     }
 
   const char *error_id;
-  r = sd_varlink_call(link, "org.openSUSE.wtmpdb.Rotate", params, &result, &error_id);
+  r = call_wtmpdbd(link, "org.openSUSE.wtmpdb.Rotate", params, &result, &error_id);
   if (r < 0)
     {
       if (error)
@@ -522,10 +574,13 @@ wtmpdb_entry_free (struct wtmpdb_entry *var)
   var->service = mfree(var->service);
 }
 
-int
-varlink_read_all (int (*cb_func)(void *unused, int argc, char **argv,
-				 char **azColName),
-		  void *userdata, char **error)
+/* Calls ReadAll with params and the callback function for every
+   returned entry. */
+static int
+call_read_all (sd_json_variant *params,
+	       int (*cb_func)(void *unused, int argc, char **argv,
+			      char **azColName),
+	       void *userdata, char **error)
 {
   _cleanup_(read_all_free) struct read_all p = {
     .success = false,
@@ -547,7 +602,7 @@ varlink_read_all (int (*cb_func)(void *unused, int argc, char **argv,
     return r;
 
   const char *error_id;
-  r = sd_varlink_call(link, "org.openSUSE.wtmpdb.ReadAll", NULL, &result, &error_id);
+  r = call_wtmpdbd(link, "org.openSUSE.wtmpdb.ReadAll", params, &result, &error_id);
   if (r < 0)
     {
       if (error)
@@ -665,4 +720,390 @@ varlink_read_all (int (*cb_func)(void *unused, int argc, char **argv,
   return 0;
 }
 
+/* Reads all entries or, if after_id is not negative, only the
+   entries with a larger ID, or with current set only the open
+   sessions of the running system. */
+int
+varlink_read_all (int64_t after_id, int current,
+		  int (*cb_func)(void *unused, int argc, char **argv,
+				 char **azColName),
+		  void *userdata, char **error)
+{
+  _cleanup_(sd_json_variant_unrefp) sd_json_variant *params = NULL;
+  int r;
+
+  if (after_id >= 0 || current)
+    {
+      r = sd_json_buildo(&params,
+			 SD_JSON_BUILD_PAIR_CONDITION(after_id >= 0, "AfterID", SD_JSON_BUILD_INTEGER(after_id)),
+			 SD_JSON_BUILD_PAIR_CONDITION(current, "Current", SD_JSON_BUILD_BOOLEAN(true)));
+      if (r < 0)
+	{
+	  if (error)
+	    if (asprintf (error, "Failed to build JSON data: %s",
+			  strerror(-r)) < 0)
+	      *error = strdup ("Out of memory");
+	  return r;
+	}
+    }
+
+  return call_read_all (params, cb_func, userdata, error);
+}
+
+/* Reads at most limit entries ordered by Login and ID, starting
+   after before_login/before_id if before_id is > 0. */
+int
+varlink_read_page (uint64_t before_login, int64_t before_id,
+		   unsigned int limit,
+		   int (*cb_func)(void *unused, int argc, char **argv,
+				  char **azColName),
+		   void *userdata, char **error)
+{
+  _cleanup_(sd_json_variant_unrefp) sd_json_variant *params = NULL;
+  int r;
+
+  r = sd_json_buildo(&params,
+		     SD_JSON_BUILD_PAIR("Limit", SD_JSON_BUILD_UNSIGNED(limit)),
+		     SD_JSON_BUILD_PAIR_CONDITION(before_id > 0, "BeforeLogin", SD_JSON_BUILD_UNSIGNED(before_login)),
+		     SD_JSON_BUILD_PAIR_CONDITION(before_id > 0, "BeforeID", SD_JSON_BUILD_INTEGER(before_id)));
+  if (r < 0)
+    {
+      if (error)
+	if (asprintf (error, "Failed to build JSON data: %s",
+		      strerror(-r)) < 0)
+	  *error = strdup ("Out of memory");
+      return r;
+    }
+
+  return call_read_all (params, cb_func, userdata, error);
+}
+
+/* Reads the entries which were active between since and until, usec,
+   until 0 means no upper bound. */
+int
+varlink_read_overlap (uint64_t since, uint64_t until,
+		      int (*cb_func)(void *unused, int argc, char **argv,
+				     char **azColName),
+		      void *userdata, char **error)
+{
+  _cleanup_(sd_json_variant_unrefp) sd_json_variant *params = NULL;
+  int r;
+
+  r = sd_json_buildo(&params,
+		     SD_JSON_BUILD_PAIR("Since", SD_JSON_BUILD_UNSIGNED(since)),
+		     SD_JSON_BUILD_PAIR_CONDITION(until > 0, "Until", SD_JSON_BUILD_UNSIGNED(until)));
+  if (r < 0)
+    {
+      if (error)
+	if (asprintf (error, "Failed to build JSON data: %s",
+		      strerror(-r)) < 0)
+	  *error = strdup ("Out of memory");
+      return r;
+    }
+
+  return call_read_all (params, cb_func, userdata, error);
+}
+
+/* Reads the entries which were active at the time at, usec. */
+int
+varlink_read_present (uint64_t at,
+		      int (*cb_func)(void *unused, int argc, char **argv,
+				     char **azColName),
+		      void *userdata, char **error)
+{
+  _cleanup_(sd_json_variant_unrefp) sd_json_variant *params = NULL;
+  int r;
+
+  r = sd_json_buildo(&params,
+		     SD_JSON_BUILD_PAIR("Present", SD_JSON_BUILD_UNSIGNED(at)));
+  if (r < 0)
+    {
+      if (error)
+	if (asprintf (error, "Failed to build JSON data: %s",
+		      strerror(-r)) < 0)
+	  *error = strdup ("Out of memory");
+      return r;
+    }
+
+  return call_read_all (params, cb_func, userdata, error);
+}
+
+struct report_entry {
+  char *key;
+  uint64_t sessions;
+  uint64_t seconds;
+  uint64_t users;
+  uint64_t hosts;
+};
+
+static void
+report_entry_free (struct report_entry *var)
+{
+  var->key = mfree(var->key);
+}
+
+int
+varlink_report (int group_by, uint64_t since, uint64_t until,
+		unsigned int limit,
+		int (*cb_func)(void *unused, int argc, char **argv,
+			       char **azColName),
+		void *userdata, char **error)
+{
+  /* index is WTMPDB_REPORT_* */
+  static const char *const groups[] = {"user", "host", "service", "tty",
+				       "day", "hour"};
+  _cleanup_(read_all_free) struct read_all p = {
+    .success = false,
+    .error = NULL,
+    .contents_json = NULL,
+  };
+  static const sd_json_dispatch_field dispatch_table[] = {
+    { "Success",    SD_JSON_VARIANT_BOOLEAN, sd_json_dispatch_stdbool, offsetof(struct read_all, success), 0 },
+    { "ErrorMsg",   SD_JSON_VARIANT_STRING,  sd_json_dispatch_string,  offsetof(struct read_all, error), 0 },
+    { "Data",       SD_JSON_VARIANT_ARRAY,   sd_json_dispatch_variant, offsetof(struct read_all, contents_json), 0 },
+    {}
+  };
+  _cleanup_(sd_varlink_unrefp) sd_varlink *link = NULL;
+  _cleanup_(sd_json_variant_unrefp) sd_json_variant *params = NULL;
+  sd_json_variant *result;
+  int r;
+
+  if (group_by < 0 || group_by >= (int)(sizeof (groups)/sizeof (groups[0])))
+    {
+      if (error)
+	if (asprintf (error, "varlink_report: invalid group %d", group_by) < 0)
+	  *error = strdup ("Out of memory");
+      return -EINVAL;
+    }
+
+  r = connect_to_wtmpdbd(&link, _VARLINK_WTMPDB_SOCKET, error);
+  if (r < 0)
+    return r;
+
+  r = sd_json_buildo(&params,
+		     SD_JSON_BUILD_PAIR("GroupBy", SD_JSON_BUILD_STRING(groups[group_by])),
+		     SD_JSON_BUILD_PAIR_CONDITION(since > 0, "Since", SD_JSON_BUILD_UNSIGNED(since)),
+		     SD_JSON_BUILD_PAIR_CONDITION(until > 0, "Until", SD_JSON_BUILD_UNSIGNED(until)),
+		     SD_JSON_BUILD_PAIR_CONDITION(limit > 0, "Limit", SD_JSON_BUILD_UNSIGNED(limit)));
+  if (r < 0)
+    {
+      if (error)
+	if (asprintf (error, "Failed to build JSON data: %s",
+		      strerror(-r)) < 0)
+	  *error = strdup ("Out of memory");
+      return r;
+    }
+
+  const char *error_id;
+  r = call_wtmpdbd(link, "org.openSUSE.wtmpdb.Report", params, &result, &error_id);
+  if (r < 0)
+    {
+      if (error)
+	if (asprintf (error, "Failed to call Report method: %s",
+		      strerror(-r)) < 0)
+	  *error = strdup ("Out of memory");
+      return r;
+    }
+
+  r = sd_json_dispatch(result, dispatch_table, SD_JSON_ALLOW_EXTENSIONS, &p);
+  if (r < 0)
+    {
+      if (error)
+	if (asprintf (error, "Failed to parse JSON answer: %s",
+		      strerror(-r)) < 0)
+	  *error = strdup("Out of memory");
+      return r;
+    }
+
+  if (error_id && strlen(error_id) > 0)
+    {
+      if (error)
+	{
+	  if (p.error)
+	    *error = strdup(p.error);
+	  else
+	    *error = strdup(error_id);
+	}
+      return -EIO;
+    }
+
+  if (!sd_json_variant_is_array(p.contents_json))
+    {
+      fprintf(stderr, "JSON 'Data' is no array!\n");
+      return -EINVAL;
+    }
+
+  for (size_t i = 0; i < sd_json_variant_elements(p.contents_json); i++)
+    {
+      static char *azColName[5] = {"Key", "Sessions", "Seconds", "Users", "Hosts"};
+      _cleanup_(report_entry_free) struct report_entry e = {
+	.key = NULL,
+      };
+      static const sd_json_dispatch_field dispatch_entry_table[] = {
+	{ "Key",      SD_JSON_VARIANT_STRING,   sd_json_dispatch_string, offsetof(struct report_entry, key), SD_JSON_MANDATORY },
+	{ "Sessions", SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct report_entry, sessions), 0 },
+	{ "Seconds",  SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct report_entry, seconds), 0 },
+	{ "Users",    SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct report_entry, users), 0 },
+	{ "Hosts",    SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct report_entry, hosts), 0 },
+	{}
+      };
+      char sessions[21], seconds[21], users[21], hosts[21];
+
+      sd_json_variant *entry = sd_json_variant_by_index(p.contents_json, i);
+      if (!sd_json_variant_is_object(entry))
+	{
+	  fprintf(stderr, "entry is no object!\n");
+	  return -EINVAL;
+	}
+
+      r = sd_json_dispatch(entry, dispatch_entry_table, SD_JSON_ALLOW_EXTENSIONS, &e);
+      if (r < 0)
+	{
+	  if (error)
+	    if (asprintf (error, "Failed to parse JSON report entry: %s",
+			  strerror(-r)) < 0)
+	      *error = strdup("Out of memory");
+	  return r;
+	}
+
+      snprintf (sessions, sizeof (sessions), "%" PRIu64, e.sessions);
+      snprintf (seconds, sizeof (seconds), "%" PRIu64, e.seconds);
+      snprintf (users, sizeof (users), "%" PRIu64, e.users);
+      snprintf (hosts, sizeof (hosts), "%" PRIu64, e.hosts);
+
+      char *ret[5] = {e.key, sessions, seconds, users, hosts};
+      if (cb_func(userdata, 5, ret, azColName) != 0)
+	break;
+    }
+
+  return 0;
+}
+
+struct concurrency_entry {
+  uint64_t start;
+  uint64_t peak;
+  uint64_t sessions;
+};
+
+int
+varlink_concurrency (uint64_t since, uint64_t until, uint64_t bucket,
+		     int (*cb_func)(void *unused, int argc, char **argv,
+				    char **azColName),
+		     void *userdata, char **error)
+{
+  _cleanup_(read_all_free) struct read_all p = {
+    .success = false,
+    .error = NULL,
+    .contents_json = NULL,
+  };
+  static const sd_json_dispatch_field dispatch_table[] = {
+    { "Success",    SD_JSON_VARIANT_BOOLEAN, sd_json_dispatch_stdbool, offsetof(struct read_all, success), 0 },
+    { "ErrorMsg",   SD_JSON_VARIANT_STRING,  sd_json_dispatch_string,  offsetof(struct read_all, error), 0 },
+    { "Data",       SD_JSON_VARIANT_ARRAY,   sd_json_dispatch_variant, offsetof(struct read_all, contents_json), 0 },
+    {}
+  };
+  _cleanup_(sd_varlink_unrefp) sd_varlink *link = NULL;
+  _cleanup_(sd_json_variant_unrefp) sd_json_variant *params = NULL;
+  sd_json_variant *result;
+  int r;
+
+  r = connect_to_wtmpdbd(&link, _VARLINK_WTMPDB_SOCKET, error);
+  if (r < 0)
+    return r;
+
+  r = sd_json_buildo(&params,
+		     SD_JSON_BUILD_PAIR("Bucket", SD_JSON_BUILD_UNSIGNED(bucket)),
+		     SD_JSON_BUILD_PAIR_CONDITION(since > 0, "Since", SD_JSON_BUILD_UNSIGNED(since)),
+		     SD_JSON_BUILD_PAIR_CONDITION(until > 0, "Until", SD_JSON_BUILD_UNSIGNED(until)));
+  if (r < 0)
+    {
+      if (error)
+	if (asprintf (error, "Failed to build JSON data: %s",
+		      strerror(-r)) < 0)
+	  *error = strdup ("Out of memory");
+      return r;
+    }
+
+  const char *error_id;
+  r = call_wtmpdbd(link, "org.openSUSE.wtmpdb.Concurrency", params, &result, &error_id);
+  if (r < 0)
+    {
+      if (error)
+	if (asprintf (error, "Failed to call Concurrency method: %s",
+		      strerror(-r)) < 0)
+	  *error = strdup ("Out of memory");
+      return r;
+    }
+
+  r = sd_json_dispatch(result, dispatch_table, SD_JSON_ALLOW_EXTENSIONS, &p);
+  if (r < 0)
+    {
+      if (error)
+	if (asprintf (error, "Failed to parse JSON answer: %s",
+		      strerror(-r)) < 0)
+	  *error = strdup("Out of memory");
+      return r;
+    }
+
+  if (error_id && strlen(error_id) > 0)
+    {
+      if (error)
+	{
+	  if (p.error)
+	    *error = strdup(p.error);
+	  else
+	    *error = strdup(error_id);
+	}
+      return -EIO;
+    }
+
+  if (!sd_json_variant_is_array(p.contents_json))
+    {
+      fprintf(stderr, "JSON 'Data' is no array!\n");
+      return -EINVAL;
+    }
+
+  for (size_t i = 0; i < sd_json_variant_elements(p.contents_json); i++)
+    {
+      static char *azColName[3] = {"Start", "Peak", "Sessions"};
+      struct concurrency_entry e = {
+	.start = 0,
+      };
+      static const sd_json_dispatch_field dispatch_entry_table[] = {
+	{ "Start",    SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct concurrency_entry, start), SD_JSON_MANDATORY },
+	{ "Peak",     SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct concurrency_entry, peak), 0 },
+	{ "Sessions", SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct concurrency_entry, sessions), 0 },
+	{}
+      };
+      char start[21], peak[21], sessions[21];
+
+      sd_json_variant *entry = sd_json_variant_by_index(p.contents_json, i);
+      if (!sd_json_variant_is_object(entry))
+	{
+	  fprintf(stderr, "entry is no object!\n");
+	  return -EINVAL;
+	}
+
+      r = sd_json_dispatch(entry, dispatch_entry_table, SD_JSON_ALLOW_EXTENSIONS, &e);
+      if (r < 0)
+	{
+	  if (error)
+	    if (asprintf (error, "Failed to parse JSON concurrency entry: %s",
+			  strerror(-r)) < 0)
+	      *error = strdup("Out of memory");
+	  return r;
+	}
+
+      snprintf (start, sizeof (start), "%" PRIu64, e.start);
+      snprintf (peak, sizeof (peak), "%" PRIu64, e.peak);
+      snprintf (sessions, sizeof (sessions), "%" PRIu64, e.sessions);
+
+      char *ret[3] = {start, peak, sessions};
+      if (cb_func(userdata, 3, ret, azColName) != 0)
+	break;
+    }
+
+  return 0;
+}
+
 #endif
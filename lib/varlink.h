@@ -29,15 +29,41 @@
 
 #include <stdint.h>
 
+extern void varlink_set_timeout (uint64_t usec_timeout);
+
 extern int64_t varlink_login (int type, const char *user,
 			      uint64_t usec_login, const char *tty,
 			      const char *rhost, const char *service,
 			      char **error);
 extern int varlink_logout (int64_t id, uint64_t usec_logout, char **error);
 extern int64_t varlink_get_id (const char *tty, char **error);
-extern int varlink_read_all (int (*cb_func)(void *unused, int argc, char **argv,
+extern int varlink_read_all (int64_t after_id, int current,
+			     int (*cb_func)(void *unused, int argc, char **argv,
 					    char **azColName),
 			     void *userdata, char **error);
+extern int varlink_read_page (uint64_t before_login, int64_t before_id,
+			      unsigned int limit,
+			      int (*cb_func)(void *unused, int argc, char **argv,
+					     char **azColName),
+			      void *userdata, char **error);
+extern int varlink_read_overlap (uint64_t since, uint64_t until,
+				 int (*cb_func)(void *unused, int argc, char **argv,
+						char **azColName),
+				 void *userdata, char **error);
+extern int varlink_read_present (uint64_t at,
+				 int (*cb_func)(void *unused, int argc, char **argv,
+						char **azColName),
+				 void *userdata, char **error);
+extern int varlink_concurrency (uint64_t since, uint64_t until,
+				uint64_t bucket,
+				int (*cb_func)(void *unused, int argc, char **argv,
+					       char **azColName),
+				void *userdata, char **error);
+extern int varlink_report (int group_by, uint64_t since, uint64_t until,
+			   unsigned int limit,
+			   int (*cb_func)(void *unused, int argc, char **argv,
+					  char **azColName),
+			   void *userdata, char **error);
 extern int varlink_get_boottime (uint64_t *boottime, char **error);
 extern int varlink_rotate (const int days, char **wtmpdb_name,
 			   uint64_t *entries, char **error);
@@ -93,7 +93,7 @@ import_utmp_records (const char *db_path,
 		{
 		  id = wtmpdb_login (db_path, BOOT_TIME, "reboot", usecs, "~",
 				     u->ut_host, NULL, error);
-		  ret = id == -1 ? -1 : 0;
+		  ret = id < 0 ? -1 : 0;
 		  last_reboot_id = id;
 		}
 	      else if (strcmp (u->ut_user, "shutdown") == 0 &&
@@ -107,7 +107,7 @@ import_utmp_records (const char *db_path,
 	case UTMP_USER_PROCESS:
 	  id = wtmpdb_login (db_path, USER_PROCESS, u->ut_user, usecs,
 			     u->ut_line, u->ut_host, NULL, error);
-	  ret = id == -1 ? -1 : 0;
+	  ret = id < 0 ? -1 : 0;
 	  break;
 	case UTMP_DEAD_PROCESS:
 	  for (v = u - 1; v >= utmp_data && v->ut_type != UTMP_BOOT_TIME; v--)
@@ -26,6 +26,7 @@
 */
 
 #include <time.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -39,9 +40,15 @@
 #define WTMPDB_DEBUG        01  /* send info to syslog(3) */
 #define WTMPDB_QUIET        02  /* keep quiet about things */
 #define WTMPDB_SKIP         04  /* Skip if service is in skip list */
+#define WTMPDB_TIMEOUT_FAIL 010 /* on_timeout=fail */
 
 static const char *wtmpdb_path = _PATH_WTMPDB;
 
+/* By default a timeout is no reason to deny the session, ignore the
+   module in this case and let the login continue. */
+#define IS_TIMEOUT(r) ((r) == -EBUSY || (r) == -ETIME)
+#define TIMEOUT_RESULT(ctrl) (((ctrl) & WTMPDB_TIMEOUT_FAIL) ? PAM_SYSTEM_ERR : PAM_IGNORE)
+
 /* From pam_inline.h
  *
  * Returns NULL if STR does not start with PREFIX,
@@ -134,6 +141,7 @@ _pam_parse_args (pam_handle_t *pamh,
 		 int flags, int argc,
 		 const char **argv)
 {
+  uint64_t usec_timeout = 0;
   int ctrl = 0;
   const char *str;
 
@@ -150,6 +158,25 @@ _pam_parse_args (pam_handle_t *pamh,
 	ctrl |= WTMPDB_QUIET;
       else if ((str = skip_prefix(*argv, "database=")) != NULL)
 	wtmpdb_path = str;
+      else if ((str = skip_prefix(*argv, "timeout=")) != NULL)
+	{
+	  char *endptr;
+	  unsigned long msec;
+
+	  errno = 0;
+	  msec = strtoul (str, &endptr, 10);
+	  if (errno != 0 || endptr == str || *endptr != '\0')
+	    pam_syslog (pamh, LOG_ERR, "Invalid timeout: %s", str);
+	  else
+	    usec_timeout = (uint64_t)msec * 1000;
+	}
+      else if ((str = skip_prefix(*argv, "on_timeout=")) != NULL)
+	{
+	  if (strcmp (str, "fail") == 0)
+	    ctrl |= WTMPDB_TIMEOUT_FAIL;
+	  else if (strcmp (str, "ignore") != 0)
+	    pam_syslog (pamh, LOG_ERR, "Invalid on_timeout: %s", str);
+	}
       else if ((str = skip_prefix (*argv, "skip_if=")) != NULL)
         {
           const void *void_str = NULL;
@@ -172,6 +199,10 @@ _pam_parse_args (pam_handle_t *pamh,
 	pam_syslog (pamh, LOG_ERR, "Unknown option: %s", *argv);
     }
 
+  /* The module may stay loaded for the next service, so without
+     timeout= the default applies again. */
+  wtmpdb_set_timeout (usec_timeout);
+
   return ctrl;
 }
 
@@ -209,6 +240,23 @@ free_idptr(pam_handle_t *pamh __attribute__((__unused__)), void *idptr,
   free (idptr);
 }
 
+/* Stores the ID of the login entry for close_session, -1 if the
+   login was skipped. */
+static int
+set_id (pam_handle_t *pamh, int64_t id)
+{
+  int64_t *idptr = calloc (1, sizeof(int64_t));
+
+  if (idptr == NULL)
+    {
+      pam_syslog (pamh, LOG_CRIT, "Out of memory");
+      return PAM_BUF_ERR;
+    }
+  *idptr = id;
+
+  return pam_set_data (pamh, "ID", idptr, free_idptr);
+}
+
 int
 pam_sm_open_session (pam_handle_t *pamh, int flags,
 		     int argc, const char **argv)
@@ -288,25 +336,31 @@ pam_sm_open_session (pam_handle_t *pamh, int flags,
     {
       if (error)
         {
-          pam_syslog (pamh, LOG_ERR, "%s", error);
+          pam_syslog (pamh, IS_TIMEOUT(id) ? LOG_WARNING : LOG_ERR,
+		      "%s", error);
           free (error);
         }
       else
         pam_syslog (pamh, LOG_ERR,
 		    "Unknown error writing to database %s", wtmpdb_path);
 
+      if (IS_TIMEOUT(id))
+	{
+	  pam_syslog (pamh, LOG_WARNING, "Timeout writing login entry, %s",
+		      (ctrl & WTMPDB_TIMEOUT_FAIL) ? "failing" : "ignoring session");
+	  /* tell close_session that there is no entry to close */
+	  if (set_id (pamh, -1) != PAM_SUCCESS)
+	    return PAM_SYSTEM_ERR;
+	  return TIMEOUT_RESULT(ctrl);
+	}
+
       return PAM_SYSTEM_ERR;
     }
 
   if (ctrl & WTMPDB_DEBUG)
     pam_syslog (pamh, LOG_DEBUG, "id=%lld", (long long int)id);
 
-  int64_t *idptr = calloc (1, sizeof(int64_t));
-  *idptr = id;
-
-  pam_set_data(pamh, "ID", idptr, free_idptr);
-
-  return PAM_SUCCESS;
+  return set_id (pamh, id);
 }
 
 int
@@ -333,14 +387,19 @@ pam_sm_close_session (pam_handle_t *pamh, int flags,
   idptr = voidptr;
   int64_t id = *idptr;
 
+  /* open_session ran into the timeout and wrote no login entry */
+  if (id < 0)
+    return PAM_IGNORE;
+
   if (ctrl & WTMPDB_DEBUG)
     pam_syslog (pamh, LOG_DEBUG, "id=%lli", (long long int)id);
 
-  if (wtmpdb_logout (wtmpdb_path, id, wtmpdb_timespec2usec (ts), &error) < 0)
+  if ((retval = wtmpdb_logout (wtmpdb_path, id, wtmpdb_timespec2usec (ts), &error)) < 0)
     {
       if (error)
         {
-          pam_syslog (pamh, LOG_ERR, "%s", error);
+          pam_syslog (pamh, IS_TIMEOUT(retval) ? LOG_WARNING : LOG_ERR,
+		      "%s", error);
           free (error);
         }
       else
@@ -348,6 +407,13 @@ pam_sm_close_session (pam_handle_t *pamh, int flags,
 		    "Unknown error writing logout time to database %s",
 		    wtmpdb_path);
 
+      if (IS_TIMEOUT(retval))
+	{
+	  pam_syslog (pamh, LOG_WARNING, "Timeout writing logout entry, %s",
+		      (ctrl & WTMPDB_TIMEOUT_FAIL) ? "failing" : "ignoring session");
+	  return TIMEOUT_RESULT(ctrl);
+	}
+
       return PAM_SYSTEM_ERR;
     }
 
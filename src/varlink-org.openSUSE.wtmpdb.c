@@ -49,19 +49,131 @@ static SD_VARLINK_DEFINE_METHOD(
 static SD_VARLINK_DEFINE_METHOD(
                 ReadAll,
                 SD_VARLINK_FIELD_COMMENT("Get all entries from the database"),
+		SD_VARLINK_FIELD_COMMENT("Only entries with a larger ID, ordered by ID"),
+		SD_VARLINK_DEFINE_INPUT(AfterID, SD_VARLINK_INT, SD_VARLINK_NULLABLE),
+		SD_VARLINK_FIELD_COMMENT("Only open sessions since the last boot, newest first"),
+		SD_VARLINK_DEFINE_INPUT(Current, SD_VARLINK_BOOL, SD_VARLINK_NULLABLE),
+		SD_VARLINK_FIELD_COMMENT("One page ordered by Login and ID, newest first, with at most Limit entries"),
+		SD_VARLINK_DEFINE_INPUT(Limit, SD_VARLINK_INT, SD_VARLINK_NULLABLE),
+		SD_VARLINK_FIELD_COMMENT("Continue the page after this Login and ID, usec"),
+		SD_VARLINK_DEFINE_INPUT(BeforeLogin, SD_VARLINK_INT, SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_INPUT(BeforeID, SD_VARLINK_INT, SD_VARLINK_NULLABLE),
+		SD_VARLINK_FIELD_COMMENT("Only entries active at this time, usec, newest first"),
+		SD_VARLINK_DEFINE_INPUT(Present, SD_VARLINK_INT, SD_VARLINK_NULLABLE),
+		SD_VARLINK_FIELD_COMMENT("Only entries active between Since and Until, usec, newest first"),
+		SD_VARLINK_DEFINE_INPUT(Since, SD_VARLINK_INT, SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_INPUT(Until, SD_VARLINK_INT, SD_VARLINK_NULLABLE),
 		SD_VARLINK_DEFINE_OUTPUT(Success,  SD_VARLINK_BOOL, 0),
 		SD_VARLINK_DEFINE_OUTPUT_BY_TYPE(Data, WtmpdbEntry, SD_VARLINK_ARRAY | SD_VARLINK_NULLABLE),
                 SD_VARLINK_DEFINE_OUTPUT(ErrorMsg, SD_VARLINK_STRING, SD_VARLINK_NULLABLE));
 
+static SD_VARLINK_DEFINE_STRUCT_TYPE(ReportEntry,
+				     SD_VARLINK_FIELD_COMMENT("User, host, service, tty, day or hour"),
+				     SD_VARLINK_DEFINE_FIELD(Key,      SD_VARLINK_STRING, 0),
+				     SD_VARLINK_DEFINE_FIELD(Sessions, SD_VARLINK_INT,    0),
+				     SD_VARLINK_FIELD_COMMENT("Sum of the length of the closed sessions"),
+				     SD_VARLINK_DEFINE_FIELD(Seconds,  SD_VARLINK_INT,    0),
+				     SD_VARLINK_DEFINE_FIELD(Users,    SD_VARLINK_INT,    0),
+				     SD_VARLINK_DEFINE_FIELD(Hosts,    SD_VARLINK_INT,    0));
+
+static SD_VARLINK_DEFINE_METHOD(
+		Report,
+		SD_VARLINK_FIELD_COMMENT("One of user, host, service, tty, day or hour"),
+		SD_VARLINK_DEFINE_INPUT(GroupBy,  SD_VARLINK_STRING, 0),
+		SD_VARLINK_FIELD_COMMENT("Only sessions with a login in this range, usec"),
+		SD_VARLINK_DEFINE_INPUT(Since,    SD_VARLINK_INT,    SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_INPUT(Until,    SD_VARLINK_INT,    SD_VARLINK_NULLABLE),
+		SD_VARLINK_FIELD_COMMENT("Return only the top entries"),
+		SD_VARLINK_DEFINE_INPUT(Limit,    SD_VARLINK_INT,    SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(Success, SD_VARLINK_BOOL,   0),
+		SD_VARLINK_DEFINE_OUTPUT_BY_TYPE(Data, ReportEntry, SD_VARLINK_ARRAY | SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(ErrorMsg, SD_VARLINK_STRING, SD_VARLINK_NULLABLE));
+
+static SD_VARLINK_DEFINE_STRUCT_TYPE(ConcurrencyEntry,
+				     SD_VARLINK_FIELD_COMMENT("Start of the bucket, usec"),
+				     SD_VARLINK_DEFINE_FIELD(Start,    SD_VARLINK_INT, 0),
+				     SD_VARLINK_FIELD_COMMENT("Maximum number of concurrent sessions"),
+				     SD_VARLINK_DEFINE_FIELD(Peak,     SD_VARLINK_INT, 0),
+				     SD_VARLINK_FIELD_COMMENT("Number of sessions active in the bucket"),
+				     SD_VARLINK_DEFINE_FIELD(Sessions, SD_VARLINK_INT, 0));
+
+static SD_VARLINK_DEFINE_METHOD(
+		Concurrency,
+		SD_VARLINK_FIELD_COMMENT("Size of the buckets, usec"),
+		SD_VARLINK_DEFINE_INPUT(Bucket,   SD_VARLINK_INT,    0),
+		SD_VARLINK_FIELD_COMMENT("Time range, usec, default from the first login until now"),
+		SD_VARLINK_DEFINE_INPUT(Since,    SD_VARLINK_INT,    SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_INPUT(Until,    SD_VARLINK_INT,    SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(Success, SD_VARLINK_BOOL,   0),
+		SD_VARLINK_DEFINE_OUTPUT_BY_TYPE(Data, ConcurrencyEntry, SD_VARLINK_ARRAY | SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(ErrorMsg, SD_VARLINK_STRING, SD_VARLINK_NULLABLE));
+
 static SD_VARLINK_DEFINE_METHOD(
 		Rotate,
 		SD_VARLINK_FIELD_COMMENT("Request to rotate database"),
 		SD_VARLINK_DEFINE_INPUT(Days,        SD_VARLINK_INT,  0),
+		SD_VARLINK_FIELD_COMMENT("Return immediately, query progress with RotateStatus"),
+		SD_VARLINK_DEFINE_INPUT(Background,  SD_VARLINK_BOOL, SD_VARLINK_NULLABLE),
 		SD_VARLINK_DEFINE_OUTPUT(Success,    SD_VARLINK_BOOL, 0),
 		SD_VARLINK_DEFINE_OUTPUT(Entries,    SD_VARLINK_INT, SD_VARLINK_NULLABLE),
 		SD_VARLINK_DEFINE_OUTPUT(BackupName, SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
 		SD_VARLINK_DEFINE_OUTPUT(ErrorMsg,   SD_VARLINK_STRING, SD_VARLINK_NULLABLE));
 
+static SD_VARLINK_DEFINE_METHOD(
+		RotateStatus,
+		SD_VARLINK_FIELD_COMMENT("Progress of the current or last rotation"),
+		SD_VARLINK_DEFINE_OUTPUT(Phase,        SD_VARLINK_STRING, 0),
+		SD_VARLINK_DEFINE_OUTPUT(Running,      SD_VARLINK_BOOL,   0),
+		SD_VARLINK_DEFINE_OUTPUT(Days,         SD_VARLINK_INT,    SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(EntriesMoved, SD_VARLINK_INT,    0),
+		SD_VARLINK_DEFINE_OUTPUT(EntriesTotal, SD_VARLINK_INT,    0),
+		SD_VARLINK_DEFINE_OUTPUT(ElapsedUSec,  SD_VARLINK_INT,    0),
+		SD_VARLINK_DEFINE_OUTPUT(ETAUSec,      SD_VARLINK_INT,    SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(BackupName,   SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(ErrorMsg,     SD_VARLINK_STRING, SD_VARLINK_NULLABLE));
+
+static SD_VARLINK_DEFINE_STRUCT_TYPE(MethodStatistics,
+				     SD_VARLINK_DEFINE_FIELD(Name,    SD_VARLINK_STRING, 0),
+				     SD_VARLINK_DEFINE_FIELD(Calls,   SD_VARLINK_INT,    0),
+				     SD_VARLINK_DEFINE_FIELD(Errors,  SD_VARLINK_INT,    0),
+				     SD_VARLINK_FIELD_COMMENT("Number of returned database entries"),
+				     SD_VARLINK_DEFINE_FIELD(Rows,    SD_VARLINK_INT,    0),
+				     SD_VARLINK_FIELD_COMMENT("Size of the returned strings, before JSON encoding"),
+				     SD_VARLINK_DEFINE_FIELD(PayloadBytes, SD_VARLINK_INT, 0),
+				     SD_VARLINK_FIELD_COMMENT("Latency percentiles, upper bound of the histogram bucket"),
+				     SD_VARLINK_DEFINE_FIELD(P50USec, SD_VARLINK_INT,    0),
+				     SD_VARLINK_DEFINE_FIELD(P90USec, SD_VARLINK_INT,    0),
+				     SD_VARLINK_DEFINE_FIELD(P99USec, SD_VARLINK_INT,    0),
+				     SD_VARLINK_DEFINE_FIELD(MaxUSec, SD_VARLINK_INT,    0));
+
+static SD_VARLINK_DEFINE_METHOD(
+		GetStatistics,
+		SD_VARLINK_FIELD_COMMENT("Get performance counters of the daemon"),
+		SD_VARLINK_DEFINE_OUTPUT(UptimeUSec,    SD_VARLINK_INT, 0),
+		SD_VARLINK_DEFINE_OUTPUT(Connections,   SD_VARLINK_INT, 0),
+		SD_VARLINK_DEFINE_OUTPUT(WorkerThreads, SD_VARLINK_INT, 0),
+		SD_VARLINK_FIELD_COMMENT("How often a locked database had to be waited for"),
+		SD_VARLINK_DEFINE_OUTPUT(BusyRetries,   SD_VARLINK_INT, 0),
+		SD_VARLINK_DEFINE_OUTPUT_BY_TYPE(Methods, MethodStatistics, SD_VARLINK_ARRAY));
+
+static SD_VARLINK_DEFINE_METHOD_FULL(
+		Subscribe,
+		SD_VARLINK_REQUIRES_MORE,
+		SD_VARLINK_FIELD_COMMENT("Stream Login, Logout, Boot and Shutdown events, optionally filtered"),
+		SD_VARLINK_DEFINE_INPUT(User,        SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_INPUT(Service,     SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_INPUT(Type,        SD_VARLINK_INT,    SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(Event,      SD_VARLINK_STRING, 0),
+		SD_VARLINK_DEFINE_OUTPUT(ID,         SD_VARLINK_INT,    0),
+		SD_VARLINK_FIELD_COMMENT("Missing for a Logout of a session opened before wtmpdbd was started"),
+		SD_VARLINK_DEFINE_OUTPUT(Type,       SD_VARLINK_INT,    SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(User,       SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(Login,      SD_VARLINK_INT,    SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(Logout,     SD_VARLINK_INT,    SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(TTY,        SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(RemoteHost, SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+		SD_VARLINK_DEFINE_OUTPUT(Service,    SD_VARLINK_STRING, SD_VARLINK_NULLABLE));
+
 static SD_VARLINK_DEFINE_METHOD(
 		Quit,
 		SD_VARLINK_FIELD_COMMENT("Stop the daemon"),
@@ -85,6 +197,7 @@ static SD_VARLINK_DEFINE_METHOD(
 
 static SD_VARLINK_DEFINE_ERROR(NoEntryFound);
 static SD_VARLINK_DEFINE_ERROR(InternalError);
+static SD_VARLINK_DEFINE_ERROR(DatabaseBusy);
 
 SD_VARLINK_DEFINE_INTERFACE(
                 org_openSUSE_wtmpdb,
@@ -102,8 +215,24 @@ SD_VARLINK_DEFINE_INTERFACE(
                 &vl_method_GetBootTime,
 		SD_VARLINK_SYMBOL_COMMENT("Get all entries from database"),
                 &vl_method_ReadAll,
+		SD_VARLINK_SYMBOL_COMMENT("Aggregated sessions"),
+		&vl_type_ReportEntry,
+		SD_VARLINK_SYMBOL_COMMENT("Aggregate sessions by user, host, service, tty or time"),
+		&vl_method_Report,
+		SD_VARLINK_SYMBOL_COMMENT("Concurrent sessions per time bucket"),
+		&vl_type_ConcurrencyEntry,
+		SD_VARLINK_SYMBOL_COMMENT("Peak number of concurrent sessions per time bucket"),
+		&vl_method_Concurrency,
 		SD_VARLINK_SYMBOL_COMMENT("Rotate the database"),
 		&vl_method_Rotate,
+		SD_VARLINK_SYMBOL_COMMENT("Query progress of database rotation"),
+		&vl_method_RotateStatus,
+		SD_VARLINK_SYMBOL_COMMENT("Per method statistics"),
+		&vl_type_MethodStatistics,
+		SD_VARLINK_SYMBOL_COMMENT("Get statistics of the daemon"),
+		&vl_method_GetStatistics,
+		SD_VARLINK_SYMBOL_COMMENT("Subscribe to login and logout events"),
+		&vl_method_Subscribe,
  		SD_VARLINK_SYMBOL_COMMENT("Stop the daemon"),
                 &vl_method_Quit,
 		SD_VARLINK_SYMBOL_COMMENT("Checks if the service is running."),
@@ -115,4 +244,6 @@ SD_VARLINK_DEFINE_INTERFACE(
 		SD_VARLINK_SYMBOL_COMMENT("No entry found"),
                 &vl_error_NoEntryFound,
 		SD_VARLINK_SYMBOL_COMMENT("Internal Error"),
-		&vl_error_InternalError);
+		&vl_error_InternalError,
+		SD_VARLINK_SYMBOL_COMMENT("Database locked longer than the timeout"),
+		&vl_error_DatabaseBusy);
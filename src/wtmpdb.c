@@ -36,8 +36,10 @@
 #include <string.h>
 #include <limits.h>
 #include <getopt.h>
+#include <unistd.h>
 #include <netdb.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <sys/utsname.h>
 
@@ -50,6 +52,11 @@
 #define _cleanup_(f) __attribute__((cleanup(f)))
 #endif
 
+#if WITH_WTMPDBD
+#include <systemd/sd-varlink.h>
+#include <systemd/sd-json.h>
+#endif
+
 #include "import.h"
 #include "wtmpdb.h"
 
@@ -62,6 +69,21 @@ static char *wtmpdb_path = NULL;
 #define TIMEFMT_ISO    5
 
 #define TIMEFMT_VALUE 255
+#define FOLLOW_VALUE 256
+#define OUTPUT_VALUE 257
+#define PAGE_VALUE   258
+#define BEFORE_VALUE 259
+#define OVERLAP_VALUE 260
+#define MMAP_VALUE   261
+#define CACHE_VALUE  262
+
+#define OUTPUT_TEXT   1
+#define OUTPUT_JSON   2
+#define OUTPUT_NDJSON 3
+#define OUTPUT_CSV    4
+
+/* interval to check for new entries if wtmpdbd is not running */
+#define FOLLOW_POLL_USEC (1 * USEC_PER_SEC)
 
 #define LOGROTATE_DAYS 60
 
@@ -80,6 +102,7 @@ static int iflag = 0;
 static int jflag = 0;
 static int wflag = 0;
 static int xflag = 0;
+static int output_fmt = OUTPUT_TEXT;
 static const int name_len = 8; /* LAST_LOGIN_LEN */
 static int login_fmt = TIMEFMT_SHORT;
 static int login_len = 16; /* 16 = short, 24 = full */
@@ -92,6 +115,10 @@ static time_t present = 0; /* Who was present at the specified time */
 static time_t since = 0; /* Who was logged in after this time? */
 static time_t until = 0; /* Who was logged in until this time? */
 static char **match = NULL; /* user/tty to display only */
+static int follow = 0; /* Wait for new entries */
+static int page = 0; /* Read only one page of maxentries entries */
+static uint64_t page_login = 0; /* Start the page after this entry */
+static int64_t page_id = 0;
 
 
 /* isipaddr - find out if string provided is an IP address or not
@@ -131,6 +158,214 @@ isipaddr (const char *string, int *addr_type,
   return is_ip;
 }
 
+/* Name resolution for -d and -i. Every host is only resolved once
+   per run, the hosts of the entries to print are resolved in
+   parallel before the output starts if they are known in advance. */
+#define HOST_CACHE_BUCKETS 1024
+#define RESOLVE_THREADS 8
+
+struct host_entry {
+  char *host;
+  char *resolved; /* NULL if the host could not be resolved */
+  struct host_entry *next;
+};
+
+static struct host_entry *host_cache[HOST_CACHE_BUCKETS];
+static struct host_entry **host_list = NULL; /* all entries, for the workers */
+static size_t host_count = 0;
+static size_t host_next = 0; /* next host to resolve by a worker */
+static pthread_mutex_t host_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static char *
+resolve_host (const char *host)
+{
+  char host_buf[NI_MAXHOST];
+
+  if (dflag)
+    {
+      struct sockaddr_storage addr;
+      int addr_type = 0;
+
+      if (isipaddr (host, &addr_type, &addr))
+	{
+	  if (getnameinfo ((struct sockaddr*)&addr, sizeof (addr), host_buf, sizeof (host_buf),
+			   NULL, 0, NI_NAMEREQD) == 0)
+	    return strdup (host_buf);
+	}
+    }
+
+  if (iflag)
+    {
+      struct addrinfo  hints;
+      struct addrinfo  *result;
+      char *ret = NULL;
+
+      memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_UNSPEC;    /* Allow IPv4 or IPv6 */
+      hints.ai_socktype = SOCK_DGRAM; /* Datagram socket */
+      hints.ai_flags = 0;
+      hints.ai_protocol = 0;          /* Any protocol */
+      if (getaddrinfo(host, NULL, &hints, &result) == 0)
+	{
+	  if (result->ai_family == AF_INET)
+	    {
+	      if (inet_ntop(result->ai_family,
+			    &((struct sockaddr_in *)result->ai_addr)->sin_addr,
+			    host_buf, sizeof (host_buf)) != NULL)
+		ret = strdup (host_buf);
+	    }
+	  else if (result->ai_family == AF_INET6)
+	    {
+	      if (inet_ntop(result->ai_family,
+			    &((struct sockaddr_in6 *)result->ai_addr)->sin6_addr,
+			    host_buf, sizeof (host_buf)) != NULL)
+		ret = strdup (host_buf);
+	    }
+
+	  freeaddrinfo(result);
+	}
+      return ret;
+    }
+
+  return NULL;
+}
+
+static struct host_entry *
+host_cache_find (const char *host, int create)
+{
+  unsigned int hash = 5381;
+  struct host_entry *e;
+
+  for (const char *cp = host; *cp; cp++)
+    hash = hash * 33 + (unsigned char)*cp;
+  hash %= HOST_CACHE_BUCKETS;
+
+  for (e = host_cache[hash]; e; e = e->next)
+    if (strcmp (e->host, host) == 0)
+      return e;
+
+  if (!create)
+    return NULL;
+
+  struct host_entry **tmp = realloc (host_list, (host_count + 1) * sizeof (struct host_entry *));
+  e = calloc (1, sizeof (struct host_entry));
+  if (tmp == NULL || e == NULL || (e->host = strdup (host)) == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (EXIT_FAILURE);
+    }
+  host_list = tmp;
+  host_list[host_count++] = e;
+  e->next = host_cache[hash];
+  host_cache[hash] = e;
+
+  return e;
+}
+
+/* Returns the resolved name or address, host itself if that fails */
+static const char *
+lookup_host (const char *host)
+{
+  struct host_entry *e = host_cache_find (host, 0);
+
+  /* not seen before, e.g. new entry with --follow */
+  if (e == NULL)
+    {
+      e = host_cache_find (host, 1);
+      e->resolved = resolve_host (host);
+      host_next = host_count;
+    }
+
+  return e->resolved ? e->resolved : host;
+}
+
+static int
+collect_host (void *unused __attribute__((__unused__)),
+	      int argc, char **argv,
+	      char **azColName __attribute__((__unused__)))
+{
+  if (argc == 8 && argv[6] && strlen (argv[6]) > 0)
+    host_cache_find (argv[6], 1);
+
+  return 0;
+}
+
+static void *
+resolve_worker (void *arg __attribute__((__unused__)))
+{
+  for (;;)
+    {
+      struct host_entry *e;
+
+      pthread_mutex_lock (&host_lock);
+      if (host_next >= host_count)
+	{
+	  pthread_mutex_unlock (&host_lock);
+	  return NULL;
+	}
+      e = host_list[host_next++];
+      pthread_mutex_unlock (&host_lock);
+
+      e->resolved = resolve_host (e->host);
+    }
+}
+
+/* Collect the hosts of the entries, which the same read for the
+   output will print, and resolve them with up to RESOLVE_THREADS
+   parallel lookups, so that a slow DNS answer does not stall every
+   single line. With filters applied only while printing, the
+   entries are not known, then lookup_host resolves the hosts of the
+   printed ones. */
+static void
+resolve_hosts (int overlap, int indexed_present)
+{
+  pthread_t threads[RESOLVE_THREADS];
+  size_t n_threads = 0;
+  char *error = NULL;
+  int r;
+
+  if (page)
+    r = wtmpdb_read_page (wtmpdb_path, page_login, page_id, maxentries,
+			  collect_host, NULL, &error);
+  else if (match)
+    return;
+  else if (overlap)
+    r = wtmpdb_read_overlap (wtmpdb_path, (uint64_t) since * USEC_PER_SEC,
+			     until ? (uint64_t) until * USEC_PER_SEC + USEC_PER_SEC - 1 : 0,
+			     collect_host, NULL, &error);
+  else if (indexed_present)
+    r = wtmpdb_read_present (wtmpdb_path, (uint64_t) present * USEC_PER_SEC,
+			     collect_host, NULL, &error);
+  else if (since || until || present)
+    return;
+  else if (maxentries)
+    /* the newest entries, an index seek with wtmp_login */
+    r = wtmpdb_read_page (wtmpdb_path, 0, 0, maxentries, collect_host,
+			  NULL, &error);
+  else
+    r = wtmpdb_read_all (wtmpdb_path, collect_host, &error);
+  if (r != 0)
+    {
+      /* the real read will report the error */
+      free (error);
+      return;
+    }
+
+  while (n_threads < RESOLVE_THREADS && n_threads < host_count)
+    {
+      if (pthread_create (&threads[n_threads], NULL, resolve_worker, NULL) != 0)
+	break;
+      n_threads++;
+    }
+
+  /* without threads resolve everything here */
+  if (n_threads == 0)
+    resolve_worker (NULL);
+
+  for (size_t i = 0; i < n_threads; i++)
+    pthread_join (threads[i], NULL);
+}
+
 static inline time_t
 from_usec(uint64_t usecs)
 {
@@ -195,6 +430,22 @@ done:
   return 0;
 }
 
+static int
+output_format (const char *fmt)
+{
+  if (strcmp (fmt, "text") == 0)
+    return OUTPUT_TEXT;
+  if (strcmp (fmt, "json") == 0)
+    return OUTPUT_JSON;
+  if (strcmp (fmt, "ndjson") == 0)
+    return OUTPUT_NDJSON;
+  if (strcmp (fmt, "csv") == 0)
+    return OUTPUT_CSV;
+
+  fprintf (stderr, "Invalid output format '%s'\n", fmt);
+  exit (EXIT_FAILURE);
+}
+
 static int
 time_format (const char *fmt)
 {
@@ -234,35 +485,144 @@ time_format (const char *fmt)
   return -1;
 }
 
+/* localtime() checks TZ and takes a lock for every call, which is
+   the most expensive part of printing a large number of entries.
+   So the local date, UTC offset and the date prefixes are cached for
+   a few days with a constant UTC offset, the time of day is then
+   calculated from the offset to the start of the day. */
+#define TIME_CACHE_SIZE 4
+
+struct time_cache {
+  time_t day_start; /* local midnight, 0 if unused */
+  char ctime_date[12];  /* "Sun Oct 18 " */
+  char ctime_year[8];   /* " 2026" */
+  char short_date[12];  /* "Sun Oct 18 " */
+  char iso_date[12];    /* "2026-10-18T" */
+  char iso_zone[8];     /* "+0200" */
+};
+
+static struct time_cache time_cache[TIME_CACHE_SIZE];
+static size_t time_cache_next = 0;
+
+/* Returns NULL if the day of t contains a change of the UTC offset */
+static const struct time_cache *
+time_cache_lookup (time_t t)
+{
+  static int tz_initialized = 0;
+  struct time_cache *c;
+  struct tm tm, tm_start, tm_end;
+  char buf[32];
+  time_t start;
+
+  for (size_t i = 0; i < TIME_CACHE_SIZE; i++)
+    if (time_cache[i].day_start != 0 && t >= time_cache[i].day_start &&
+	t < time_cache[i].day_start + 86400)
+      return &time_cache[i];
+
+  if (!tz_initialized)
+    {
+      tzset ();
+      tz_initialized = 1;
+    }
+
+  if (localtime_r (&t, &tm) == NULL)
+    return NULL;
+
+  start = t - (tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec);
+  if (start == 0 ||
+      localtime_r (&start, &tm_start) == NULL ||
+      tm_start.tm_gmtoff != tm.tm_gmtoff || tm_start.tm_hour != 0 ||
+      tm_start.tm_min != 0 || tm_start.tm_sec != 0)
+    return NULL;
+
+  time_t end = start + 86399;
+  if (localtime_r (&end, &tm_end) == NULL ||
+      tm_end.tm_gmtoff != tm.tm_gmtoff || tm_end.tm_mday != tm.tm_mday)
+    return NULL;
+
+  c = &time_cache[time_cache_next];
+  time_cache_next = (time_cache_next + 1) % TIME_CACHE_SIZE;
+
+  c->day_start = start;
+  /* ctime: "Sun Oct 18 14:15:36 2026\n" */
+  if (ctime_r (&start, buf) == NULL || strlen (buf) < 25)
+    {
+      c->day_start = 0;
+      return NULL;
+    }
+  snprintf (c->ctime_date, sizeof (c->ctime_date), "%.11s", buf);
+  snprintf (c->ctime_year, sizeof (c->ctime_year), " %.*s",
+	    (int)strcspn (buf + 20, "\n"), buf + 20);
+  if (strftime (c->short_date, sizeof (c->short_date), "%a %b %e ", &tm) == 0 ||
+      strftime (c->iso_date, sizeof (c->iso_date), "%FT", &tm) == 0 ||
+      strftime (c->iso_zone, sizeof (c->iso_zone), "%z", &tm) == 0)
+    {
+      c->day_start = 0;
+      return NULL;
+    }
+
+  return c;
+}
+
 static void
 format_time (int fmt, char *dst, size_t dstlen, uint64_t time)
 {
+  time_t t = (time_t)time;
+  const struct time_cache *c = NULL;
+
+  if (fmt != TIMEFMT_NOTIME)
+    c = time_cache_lookup (t);
+
+  if (c)
+    {
+      unsigned int secs = (t - c->day_start) % 86400;
+      unsigned int hour = secs / 3600;
+      unsigned int min = (secs / 60) % 60;
+      unsigned int sec = secs % 60;
+
+      switch (fmt)
+	{
+	case TIMEFMT_CTIME:
+	  snprintf (dst, dstlen, "%s%02u:%02u:%02u%s", c->ctime_date,
+		    hour, min, sec, c->ctime_year);
+	  return;
+	case TIMEFMT_SHORT:
+	  snprintf (dst, dstlen, "%s%02u:%02u", c->short_date, hour, min);
+	  return;
+	case TIMEFMT_HHMM:
+	  snprintf (dst, dstlen, "%02u:%02u", hour, min);
+	  return;
+	case TIMEFMT_ISO:
+	  snprintf (dst, dstlen, "%s%02u:%02u:%02u%s", c->iso_date,
+		    hour, min, sec, c->iso_zone);
+	  return;
+	default:
+	  abort ();
+	}
+    }
+
   switch (fmt)
     {
     case TIMEFMT_CTIME:
       {
-	time_t t = (time_t)time;
 	snprintf (dst, dstlen, "%s", ctime (&t));
 	dst[strlen (dst)-1] = '\0'; /* Remove trailing '\n' */
 	break;
       }
     case TIMEFMT_SHORT:
       {
-	time_t t = (time_t)time;
 	struct tm *tm = localtime (&t);
 	strftime (dst, dstlen, "%a %b %e %H:%M", tm);
 	break;
       }
     case TIMEFMT_HHMM:
       {
-	time_t t = (time_t)time;
 	struct tm *tm = localtime (&t);
 	strftime (dst, dstlen, "%H:%M", tm);
 	break;
       }
     case TIMEFMT_ISO:
       {
-	time_t t = (time_t)time;
 	struct tm *tm = localtime (&t);
 	strftime (dst, dstlen, "%FT%T%z", tm); /* Same ISO8601 format original last command uses */
 	break;
@@ -330,6 +690,11 @@ remove_parentheses(const char *str)
 }
 
 static int first_entry = 1;
+
+/* All output of last goes through this buffer and is written in
+   large blocks, print_line must not allocate memory per entry. */
+static char stdout_buf[256 * 1024];
+
 static void
 print_line (const char *user, const char *tty, const char *host,
 	    const char *print_service,
@@ -338,83 +703,182 @@ print_line (const char *user, const char *tty, const char *host,
 {
   if (jflag)
     {
-      if (first_entry)
-	first_entry = 0;
-      else
-	printf (",\n");
-      printf ("     { \"user\": \"%s\",\n", user);
-      printf ("       \"tty\": \"%s\",\n", tty);
+      printf ("%s     { \"user\": \"%s\",\n"
+	      "       \"tty\": \"%s\",\n",
+	      first_entry ? "" : ",\n", user, tty);
+      first_entry = 0;
       if (!nohostname)
 	printf ("       \"hostname\": \"%s\",\n", host);
       if (print_service && strlen (print_service) > 0)
 	printf ("       \"service\": \"%s\",\n", print_service);
-      printf ("       \"login\": \"%s\",\n", logintime);
       if (length[0] == ' ' || length[0] == '(')
-	{
-	  printf ("       \"logout\": \"%s\",\n", logouttime);
-	  printf ("       \"length\": \"%s\"\n",  remove_parentheses(length));
-	}
+	printf ("       \"login\": \"%s\",\n"
+		"       \"logout\": \"%s\",\n"
+		"       \"length\": \"%s\"\n"
+		"     }",
+		logintime, logouttime, remove_parentheses(length));
       else
-	printf ("       \"logout\": \"%s %s\"\n", logouttime, length);
-      printf ("     }");
+	printf ("       \"login\": \"%s\",\n"
+		"       \"logout\": \"%s %s\"\n"
+		"     }",
+		logintime, logouttime, length);
     }
+  else if (nohostname)
+    printf ("%-8.*s %-12.12s%s %-*.*s - %-*.*s %s\n",
+	    wflag?(int)strlen (user):name_len,
+	    map_soft_reboot (user), tty, print_service,
+	    login_len, login_len, logintime,
+	    logout_len, logout_len, logouttime,
+	    length);
+  else if (hostlast)
+    printf ("%-8.*s %-12.12s%s %-*.*s - %-*.*s %-12.12s %s\n",
+	    wflag?(int)strlen(user):name_len, map_soft_reboot (user),
+	    tty, print_service,
+	    login_len, login_len, logintime,
+	    logout_len, logout_len, logouttime,
+	    length, host);
   else
+    printf ("%-8.*s %-12.12s %-16.*s%s %-*.*s - %-*.*s %s\n",
+	    wflag?(int)strlen(user):name_len, map_soft_reboot (user), tty,
+	    wflag?(int)strlen(host):host_len, host, print_service,
+	    login_len, login_len, logintime,
+	    logout_len, logout_len, logouttime,
+	    length);
+}
+
+/* --output=ndjson|csv: one record per line with the raw values of
+   the database, meant to be parsed by other programs. The fields and
+   their order are part of the interface, only append new ones. */
+static const char *record_fields[] = {"id", "type", "user", "tty", "host",
+  "service", "login_usec", "logout_usec", "duration_usec"};
+
+static void
+print_json_string (const char *str)
+{
+  if (str == NULL)
     {
-      char *line;
+      fputs ("null", stdout);
+      return;
+    }
 
-      if (nohostname)
+  putchar ('"');
+  for (const unsigned char *p = (const unsigned char *)str; *p; p++)
+    {
+      if (*p == '"' || *p == '\\')
 	{
-	  if (asprintf (&line, "%-8.*s %-12.12s%s %-*.*s - %-*.*s %s\n",
-			wflag?(int)strlen (user):name_len,
-			map_soft_reboot (user), tty, print_service,
-			login_len, login_len, logintime,
-			logout_len, logout_len, logouttime,
-			length) < 0)
-	    {
-	      fprintf (stderr, "Out f memory");
-	      exit (EXIT_FAILURE);
-	    }
+	  putchar ('\\');
+	  putchar (*p);
 	}
+      else if (*p < 0x20)
+	printf ("\\u%04x", *p);
       else
-	{
-	  if (hostlast)
-	    {
-	      if (asprintf (&line, "%-8.*s %-12.12s%s %-*.*s - %-*.*s %-12.12s %s\n",
-			    wflag?(int)strlen(user):name_len, map_soft_reboot (user),
-			    tty, print_service,
-			    login_len, login_len, logintime,
-			    logout_len, logout_len, logouttime,
-			    length, host) < 0)
-		{
-		  fprintf (stderr, "Out f memory");
-		  exit (EXIT_FAILURE);
-		}
-	    }
-	  else
-	    {
-	      if (asprintf (&line, "%-8.*s %-12.12s %-16.*s%s %-*.*s - %-*.*s %s\n",
-			    wflag?(int)strlen(user):name_len, map_soft_reboot (user), tty,
-			    wflag?(int)strlen(host):host_len, host, print_service,
-			    login_len, login_len, logintime,
-			    logout_len, logout_len, logouttime,
-			    length) < 0)
-		{
-		  fprintf (stderr, "Out f memory");
-		  exit (EXIT_FAILURE);
-		}
-	    }
-	}
+	putchar (*p);
+    }
+  putchar ('"');
+}
+
+static void
+print_csv_field (const char *str)
+{
+  if (str == NULL)
+    return;
+
+  if (strpbrk (str, ",\"\r\n") == NULL)
+    {
+      fputs (str, stdout);
+      return;
+    }
+
+  putchar ('"');
+  for (const char *p = str; *p; p++)
+    {
+      if (*p == '"')
+	putchar ('"');
+      putchar (*p);
+    }
+  putchar ('"');
+}
+
+static void
+print_record_header (void)
+{
+  if (output_fmt != OUTPUT_CSV)
+    return;
 
-      printf ("%s", line);
-      free (line);
+  for (size_t i = 0; i < sizeof (record_fields)/sizeof (record_fields[0]); i++)
+    printf ("%s%s", i ? "," : "", record_fields[i]);
+  putchar ('\n');
+}
+
+static void
+print_record (const char *id, int type, const char *user, const char *tty,
+	      const char *host, const char *service,
+	      uint64_t login_t, uint64_t logout_t)
+{
+  if (output_fmt == OUTPUT_NDJSON || output_fmt == OUTPUT_JSON)
+    {
+      printf ("{\"%s\":%s,\"%s\":%d,\"%s\":", record_fields[0], id,
+	      record_fields[1], type, record_fields[2]);
+      print_json_string (user);
+      printf (",\"%s\":", record_fields[3]);
+      print_json_string (tty);
+      printf (",\"%s\":", record_fields[4]);
+      print_json_string (host);
+      printf (",\"%s\":", record_fields[5]);
+      print_json_string (service);
+      printf (",\"%s\":%" PRIu64, record_fields[6], login_t);
+      if (logout_t)
+	printf (",\"%s\":%" PRIu64 ",\"%s\":%" PRIu64 "}",
+		record_fields[7], logout_t,
+		record_fields[8],
+		logout_t > login_t ? logout_t - login_t : 0);
+      else
+	printf (",\"%s\":null,\"%s\":null}",
+		record_fields[7], record_fields[8]);
+      /* OUTPUT_JSON: the caller embeds the object in a list */
+      if (output_fmt == OUTPUT_NDJSON)
+	putchar ('\n');
+    }
+  else
+    {
+      printf ("%s,%d,", id, type);
+      print_csv_field (user);
+      putchar (',');
+      print_csv_field (tty);
+      putchar (',');
+      print_csv_field (host);
+      putchar (',');
+      print_csv_field (service);
+      printf (",%" PRIu64, login_t);
+      if (logout_t)
+	printf (",%" PRIu64 ",%" PRIu64 "\n", logout_t,
+		logout_t > login_t ? logout_t - login_t : 0);
+      else
+	fputs (",,\n", stdout);
     }
 }
 
+/* Was the session of this entry active at the time given with -p? */
+static int
+is_present (uint64_t login_t, uint64_t logout_t)
+{
+  if (present < from_usec(login_t))
+    return 0;
+
+  if (logout_t > 0 && from_usec(logout_t) < present)
+    return 0;
+
+  if (logout_t == 0 && after_reboot > 0 &&
+      from_usec(after_reboot) < present)
+    return 0;
+
+  return 1;
+}
+
 static int
 print_entry (void *unused __attribute__((__unused__)),
 	     int argc, char **argv, char **azColName)
 {
-  char host_buf[NI_MAXHOST];
   struct times_buf {
     char login[LAST_TIMESTAMP_LEN];
     char logout[LAST_TIMESTAMP_LEN];
@@ -464,6 +928,13 @@ print_entry (void *unused __attribute__((__unused__)),
   if (login_t < wtmp_start)
     wtmp_start = login_t;
 
+  /* the cursor of the next page */
+  if (page)
+    {
+      page_login = login_t;
+      page_id = strtoll (argv[0], NULL, 10);
+    }
+
   int swap = type == xflag && BOOT_TIME && logout_t != 0;
 
   if ((since && since > from_usec(swap ? logout_t : login_t)) ||
@@ -488,6 +959,27 @@ print_entry (void *unused __attribute__((__unused__)),
 	return 0;
     }
 
+  if (output_fmt == OUTPUT_NDJSON || output_fmt == OUTPUT_CSV)
+    {
+      if (type == BOOT_TIME)
+	after_reboot = login_t;
+
+      if (present && !is_present (login_t, logout_t))
+	return 0;
+
+      if ((dflag || iflag) && strlen (host) > 0)
+	host = lookup_host (host);
+
+      if ((!until || until >= from_usec(login_t)) &&
+	  (!since || since <= from_usec(login_t)))
+	print_record (argv[0], type, user, argv[5], host, argv[7],
+		      login_t, logout_t);
+
+      currentry++;
+
+      return 0;
+    }
+
   format_time (login_fmt, times.login, sizeof (times.login),
 	       login_t/USEC_PER_SEC);
 
@@ -541,61 +1033,12 @@ print_entry (void *unused __attribute__((__unused__)),
 	}
     }
 
-  char *print_service = NULL;
-  if (noservice)
-    print_service = strdup ("");
-  else
-    {
-      if (asprintf (&print_service, " %-12.12s", service) < 0)
-	{
-	  fprintf (stderr, "Out f memory");
-	  exit (EXIT_FAILURE);
-	}
-    }
-
-  if (dflag && strlen (host) > 0)
-    {
-      struct sockaddr_storage addr;
-      int addr_type = 0;
-
-      if (isipaddr (host, &addr_type, &addr))
-	{
-	  if (getnameinfo ((struct sockaddr*)&addr, sizeof (addr), host_buf, sizeof (host_buf),
-			   NULL, 0, NI_NAMEREQD) == 0)
-	    host = host_buf;
-	}
-    }
-
-  if (iflag && strlen (host) > 0)
-    {
-      struct addrinfo  hints;
-      struct addrinfo  *result;
-
-      memset(&hints, 0, sizeof(hints));
-      hints.ai_family = AF_UNSPEC;    /* Allow IPv4 or IPv6 */
-      hints.ai_socktype = SOCK_DGRAM; /* Datagram socket */
-      hints.ai_flags = 0;
-      hints.ai_protocol = 0;          /* Any protocol */
-      if (getaddrinfo(host, NULL, &hints, &result) == 0)
-	{
-	  if (result->ai_family == AF_INET)
-	    {
-	      if (inet_ntop(result->ai_family,
-			    &((struct sockaddr_in *)result->ai_addr)->sin_addr,
-			    host_buf, sizeof (host_buf)) != NULL)
-		host = host_buf;
-	    }
-	  else if (result->ai_family == AF_INET6)
-	    {
-	      if (inet_ntop(result->ai_family,
-			    &((struct sockaddr_in6 *)result->ai_addr)->sin6_addr,
-			    host_buf, sizeof (host_buf)) != NULL)
-		host = host_buf;
-	    }
+  char print_service[16] = "";
+  if (!noservice)
+    snprintf (print_service, sizeof (print_service), " %-12.12s", service);
 
-	  freeaddrinfo(result);
-	}
-    }
+  if ((dflag || iflag) && strlen (host) > 0)
+    host = lookup_host (host);
 
   if (xflag && (type == BOOT_TIME) && newer_boot != 0 && logout_t != 0)
     {
@@ -621,45 +1064,293 @@ print_entry (void *unused __attribute__((__unused__)),
       after_reboot = login_t;
     }
 
-  if (present)
-    {
-      if (present < from_usec(login_t))
-	return 0;
-
-      if (logout_t > 0 && from_usec(logout_t) < present)
-	return 0;
-
-      if (logout_t == 0 && after_reboot > 0 &&
-	  from_usec(after_reboot) < present)
-	return 0;
-    }
+  if (present && !is_present (login_t, logout_t))
+    return 0;
 
   if ((!until || until >= from_usec(login_t)) &&
       (!since || since <= from_usec(login_t)))
     print_line (user, tty, host, print_service, times.login, times.logout, times.length);
 
-  free (print_service);
-
   currentry++;
 
   return 0;
 }
 
+static char *col_names[8] = {"ID", "Type", "User", "Login", "Logout", "TTY", "RemoteHost", "Service"};
+
+/* last --follow: the largest ID already displayed and the sessions
+   shown as "still logged in", to be able to display their logout. */
+static int64_t follow_last_id = -1;
+static int64_t *follow_open_ids = NULL;
+static size_t follow_n_open = 0;
+static int follow_boot_seen = 0;
+
+static void
+follow_add_open (int64_t id)
+{
+  int64_t *tmp = realloc (follow_open_ids,
+			  (follow_n_open + 1) * sizeof (int64_t));
+  if (tmp == NULL)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (EXIT_FAILURE);
+    }
+  follow_open_ids = tmp;
+  follow_open_ids[follow_n_open++] = id;
+}
+
+static int
+follow_take_open (int64_t id)
+{
+  for (size_t i = 0; i < follow_n_open; i++)
+    if (follow_open_ids[i] == id)
+      {
+	follow_open_ids[i] = follow_open_ids[--follow_n_open];
+	return 1;
+      }
+  return 0;
+}
+
+/* Used instead of print_entry for the initial output, entries are
+   sorted by login time, newest first. */
+static int
+follow_read_entry (void *unused, int argc, char **argv, char **azColName)
+{
+  if (argc == 8)
+    {
+      int64_t id = strtoll (argv[0], NULL, 10);
+      int type = atoi (argv[1]);
+
+      if (id > follow_last_id)
+	follow_last_id = id;
+
+      /* sessions of older boots will never log out */
+      if (type == BOOT_TIME)
+	follow_boot_seen = 1;
+      else if (!follow_boot_seen && type == USER_PROCESS && argv[4] == NULL)
+	follow_add_open (id);
+    }
+
+  return print_entry (unused, argc, argv, azColName);
+}
+
+static void
+follow_print (char **argv)
+{
+  /* print_entry would show open sessions as "crash" */
+  after_reboot = 0;
+  print_entry (NULL, 8, argv, col_names);
+  fflush (stdout);
+}
+
+static int
+follow_poll_entry (void *unused __attribute__((__unused__)), int argc, char **argv,
+		   char **azColName)
+{
+  if (argc != 8)
+    return print_entry (NULL, argc, argv, azColName);
+
+  int64_t id = strtoll (argv[0], NULL, 10);
+
+  if (id > follow_last_id)
+    {
+      follow_last_id = id;
+      if (atoi (argv[1]) == USER_PROCESS && argv[4] == NULL)
+	follow_add_open (id);
+      follow_print (argv);
+    }
+  else if (argv[4] != NULL && follow_take_open (id))
+    follow_print (argv);
+
+  return 0;
+}
+
+/* Fallback without wtmpdbd: only read entries newer than the
+   oldest one we are still interested in. */
+static int
+follow_poll (void)
+{
+  for (;;)
+    {
+      char *error = NULL;
+      int64_t after_id = follow_last_id;
+
+      usleep (FOLLOW_POLL_USEC);
+
+      for (size_t i = 0; i < follow_n_open; i++)
+	if (follow_open_ids[i] - 1 < after_id)
+	  after_id = follow_open_ids[i] - 1;
+
+      if (wtmpdb_read_since_id (wtmpdb_path, after_id, follow_poll_entry,
+				NULL, &error) != 0)
+	{
+	  fprintf (stderr, "%s\n", error ? error : "Couldn't read new wtmp entries");
+	  free (error);
+	  return -1;
+	}
+    }
+}
+
+#if WITH_WTMPDBD
+struct follow_event {
+  char *event;
+  int64_t id;
+  int type;
+  char *user;
+  uint64_t login;
+  uint64_t logout;
+  char *tty;
+  char *rhost;
+  char *service;
+};
+
+static void
+follow_event_free (struct follow_event *var)
+{
+  free (var->event);
+  free (var->user);
+  free (var->tty);
+  free (var->rhost);
+  free (var->service);
+}
+
+static int
+follow_reply (sd_varlink *link __attribute__((__unused__)), sd_json_variant *parameters,
+	      const char *error_id, sd_varlink_reply_flags_t flags __attribute__((__unused__)),
+	      void *userdata __attribute__((__unused__)))
+{
+  _cleanup_(follow_event_free) struct follow_event e = {
+    .id = -1,
+    .type = -1,
+  };
+  static const sd_json_dispatch_field dispatch_table[] = {
+    { "Event",      SD_JSON_VARIANT_STRING,  sd_json_dispatch_string, offsetof(struct follow_event, event),   SD_JSON_MANDATORY },
+    { "ID",         SD_JSON_VARIANT_INTEGER, sd_json_dispatch_int64,  offsetof(struct follow_event, id),      SD_JSON_MANDATORY },
+    { "Type",       SD_JSON_VARIANT_INTEGER, sd_json_dispatch_int,    offsetof(struct follow_event, type),    0 },
+    { "User",       SD_JSON_VARIANT_STRING,  sd_json_dispatch_string, offsetof(struct follow_event, user),    0 },
+    { "Login",      SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64, offsetof(struct follow_event, login),   0 },
+    { "Logout",     SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64, offsetof(struct follow_event, logout),  0 },
+    { "TTY",        SD_JSON_VARIANT_STRING,  sd_json_dispatch_string, offsetof(struct follow_event, tty),     0 },
+    { "RemoteHost", SD_JSON_VARIANT_STRING,  sd_json_dispatch_string, offsetof(struct follow_event, rhost),   0 },
+    { "Service",    SD_JSON_VARIANT_STRING,  sd_json_dispatch_string, offsetof(struct follow_event, service), 0 },
+    {}
+  };
+  char id_buf[32], type_buf[16], login_buf[32], logout_buf[32];
+  char *argv[8];
+  int r;
+
+  if (error_id)
+    {
+      fprintf (stderr, "Subscribe failed: %s\n", error_id);
+      return -EIO;
+    }
+
+  r = sd_json_dispatch (parameters, dispatch_table, SD_JSON_ALLOW_EXTENSIONS, &e);
+  if (r < 0)
+    {
+      fprintf (stderr, "Failed to parse JSON answer: %s\n", strerror (-r));
+      return r;
+    }
+
+  /* Logout of a session opened before wtmpdbd was started */
+  if (e.user == NULL)
+    return 0;
+
+  if (e.logout == 0)
+    {
+      /* already displayed by the initial read */
+      if (e.id <= follow_last_id)
+	return 0;
+      follow_last_id = e.id;
+    }
+
+  snprintf (id_buf, sizeof (id_buf), "%" PRId64, e.id);
+  snprintf (type_buf, sizeof (type_buf), "%i", e.type);
+  snprintf (login_buf, sizeof (login_buf), "%" PRIu64, e.login);
+  snprintf (logout_buf, sizeof (logout_buf), "%" PRIu64, e.logout);
+  argv[0] = id_buf;
+  argv[1] = type_buf;
+  argv[2] = e.user;
+  argv[3] = login_buf;
+  argv[4] = e.logout ? logout_buf : NULL;
+  argv[5] = e.tty;
+  argv[6] = e.rhost;
+  argv[7] = e.service;
+
+  follow_print (argv);
+
+  return 0;
+}
+
+/* Returns NULL if wtmpdbd is not available */
+static sd_varlink *
+follow_subscribe (void)
+{
+  _cleanup_(sd_varlink_unrefp) sd_varlink *link = NULL;
+  int r;
+
+  if (sd_varlink_connect_address (&link, _VARLINK_WTMPDB_SOCKET) < 0)
+    return NULL;
+
+  r = sd_varlink_set_relative_timeout (link, UINT64_MAX);
+  if (r >= 0)
+    r = sd_varlink_bind_reply (link, follow_reply);
+  if (r >= 0)
+    r = sd_varlink_observe (link, "org.openSUSE.wtmpdb.Subscribe", NULL);
+  if (r < 0)
+    {
+      fprintf (stderr, "Failed to subscribe to wtmpdbd: %s\n", strerror (-r));
+      return NULL;
+    }
+
+  sd_varlink *ret = link;
+  link = NULL;
+  return ret;
+}
+
+static int
+follow_daemon (sd_varlink *link)
+{
+  for (;;)
+    {
+      int r = sd_varlink_process (link);
+      if (r > 0)
+	continue;
+      if (r == 0)
+	r = sd_varlink_wait (link, UINT64_MAX);
+      if (r < 0)
+	{
+	  fprintf (stderr, "Connection to wtmpdbd lost: %s\n", strerror (-r));
+	  return r;
+	}
+    }
+}
+#endif
+
 static void
 usage (int retval)
 {
   FILE *output = (retval != EXIT_SUCCESS) ? stderr : stdout;
 
   fprintf (output, "Usage: wtmpdb [command] [options]\n");
-  fputs ("Commands: last, boot, boottime, rotate, shutdown, import\n\n", output);
+  fputs ("Commands: last, boot, boottime, rotate, shutdown, import, stats, who,\n", output);
+  fputs ("          report, concurrency, rollup, intern, migrate\n\n", output);
   fputs ("Options for last:\n", output);
   fputs ("  -a, --hostlast      Display hostnames as last entry\n", output);
   fputs ("  -d, --dns           Translate IP addresses into a hostname\n", output);
   fputs ("  -f, --file FILE     Use FILE as wtmpdb database\n", output);
   fputs ("  -F, --fulltimes     Display full times and dates\n", output);
+  fputs ("      --follow        Wait for and display new entries\n", output);
   fputs ("  -i, --ip            Translate hostnames to IP addresses\n", output);
   fputs ("  -j, --json          Generate JSON output\n", output);
   fputs ("  -n, --limit N, -N   Display only first N entries\n", output);
+  fputs ("      --output FORMAT  Print entries in the specified FORMAT:\n", output);
+  fputs ("                              text|json|ndjson|csv\n", output);
+  fputs ("      --overlap       Display all sessions active between --since\n", output);
+  fputs ("                      and --until, not only the ones started then\n", output);
+  fputs ("      --page          Display only one page of -n N entries and the\n", output);
+  fputs ("                      cursor of the next page\n", output);
+  fputs ("      --before CURSOR Display the page after CURSOR\n", output);
   fputs ("  -p, --present TIME  Display who was present at TIME\n", output);
   fputs ("  -R, --nohostname    Don't display hostname\n", output);
   fputs ("  -S, --service       Display PAM service used to login\n", output);
@@ -669,6 +1360,9 @@ usage (int retval)
   fputs ("  -x, --system        Display system shutdown entries\n", output);
   fputs ("      --time-format FORMAT  Display timestamps in the specified FORMAT:\n", output);
   fputs ("                              notime|short|full|iso\n", output);
+  fputs ("      --mmap-size SIZE   Map up to SIZE bytes of FILE into memory\n", output);
+  fputs ("      --cache-size SIZE  Cache up to SIZE bytes of FILE\n", output);
+  fputs ("                      SIZE is auto (default) or bytes with K, M or G\n", output);
 
   fputs ("  [username...]       Display only entries matching these arguments\n", output);
   fputs ("  [tty...]            Display only entries matching these arguments\n", output);
@@ -697,6 +1391,54 @@ usage (int retval)
   fputs ("  logs...             Legacy log files to import\n", output);
   fputs ("\n", output);
 
+  fputs ("Options for stats (print performance statistics):\n", output);
+  fputs ("  -d, --daemon        Statistics of wtmpdbd (default)\n", output);
+  fputs ("\n", output);
+
+  fputs ("Options for who (print sessions open since the last boot):\n", output);
+  fputs ("  -f, --file FILE     Use FILE as wtmpdb database\n", output);
+  fputs ("  -j, --json          Generate JSON output\n", output);
+  fputs ("      --output FORMAT  Print sessions in the specified FORMAT:\n", output);
+  fputs ("                              text|json|ndjson|csv\n", output);
+  fputs ("\n", output);
+
+  fputs ("Options for report (aggregate sessions):\n", output);
+  fputs ("  -f, --file FILE     Use FILE as wtmpdb database\n", output);
+  fputs ("  -g, --group-by GROUP  Group sessions by GROUP:\n", output);
+  fputs ("                              user|host|service|tty|day|hour\n", output);
+  fputs ("  -j, --json          Generate JSON output\n", output);
+  fputs ("  -n, --limit N       Display only the top N groups\n", output);
+  fputs ("  -s, --since TIME    Only sessions started after TIME\n", output);
+  fputs ("  -t, --until TIME    Only sessions started until TIME\n", output);
+  fputs ("      --output FORMAT  Print the report in the specified FORMAT:\n", output);
+  fputs ("                              text|json|ndjson|csv\n", output);
+  fputs ("\n", output);
+
+  fputs ("Options for concurrency (peak concurrent sessions over time):\n", output);
+  fputs ("  -f, --file FILE     Use FILE as wtmpdb database\n", output);
+  fputs ("  -b, --bucket SIZE   Peak per SIZE, a number with the suffix\n", output);
+  fputs ("                      s, m, h or d (default: 1h)\n", output);
+  fputs ("  -j, --json          Generate JSON output\n", output);
+  fputs ("  -s, --since TIME    Start at TIME (default: first login)\n", output);
+  fputs ("  -t, --until TIME    End at TIME (default: now)\n", output);
+  fputs ("      --output FORMAT  Print the buckets in the specified FORMAT:\n", output);
+  fputs ("                              text|json|ndjson|csv\n", output);
+  fputs ("\n", output);
+
+  fputs ("Options for rollup (maintain daily totals for report):\n", output);
+  fputs ("  -f, --file FILE     Use FILE as wtmpdb database\n", output);
+  fputs ("  -D, --disable       Remove the daily totals\n", output);
+  fputs ("\n", output);
+
+  fputs ("Options for intern (store every name only once):\n", output);
+  fputs ("  -f, --file FILE     Use FILE as wtmpdb database\n", output);
+  fputs ("  -D, --disable       Convert back to one string per entry\n", output);
+  fputs ("\n", output);
+
+  fputs ("Options for migrate (update the database schema):\n", output);
+  fputs ("  -f, --file FILE     Use FILE as wtmpdb database\n", output);
+  fputs ("\n", output);
+
   fputs ("Generic options:\n", output);
   fputs ("  -h, --help          Display this help message and exit\n", output);
   fputs ("  -v, --version       Print version number and exit\n", output);
@@ -766,6 +1508,48 @@ main_rotate (int argc, char **argv)
   return EXIT_SUCCESS;
 }
 
+/* SIZE of --mmap-size and --cache-size: "auto" or a number of bytes
+   with the optional suffix K, M or G. */
+static int
+parse_size (const char *str, int64_t *size)
+{
+  char *ep;
+  long long int n;
+  int shift = 0;
+
+  if (strcmp (str, "auto") == 0)
+    {
+      *size = -1;
+      return 0;
+    }
+
+  errno = 0;
+  n = strtoll (str, &ep, 10);
+  if (errno != 0 || ep == str || n < 0)
+    return -1;
+
+  switch (*ep)
+    {
+    case 'G':
+      shift = 30;
+      ep++;
+      break;
+    case 'M':
+      shift = 20;
+      ep++;
+      break;
+    case 'K':
+      shift = 10;
+      ep++;
+      break;
+    }
+  if (*ep != '\0' || n > (INT64_MAX >> shift))
+    return -1;
+
+  *size = (int64_t)n << shift;
+  return 0;
+}
+
 static int
 main_last (int argc, char **argv)
 {
@@ -785,9 +1569,18 @@ main_last (int argc, char **argv)
     {"until", required_argument, NULL, 't'},
     {"time-format", required_argument, NULL, TIMEFMT_VALUE},
     {"json", no_argument, NULL, 'j'},
+    {"follow", no_argument, NULL, FOLLOW_VALUE},
+    {"output", required_argument, NULL, OUTPUT_VALUE},
+    {"page", no_argument, NULL, PAGE_VALUE},
+    {"before", required_argument, NULL, BEFORE_VALUE},
+    {"overlap", no_argument, NULL, OVERLAP_VALUE},
+    {"mmap-size", required_argument, NULL, MMAP_VALUE},
+    {"cache-size", required_argument, NULL, CACHE_VALUE},
     {NULL, 0, NULL, '\0'}
   };
+  int64_t mmap_size = -1, cache_size = -1;
   int time_fmt = TIMEFMT_CTIME;
+  int overlap = 0;
   char *error = NULL;
   int c;
 
@@ -865,6 +1658,35 @@ main_last (int argc, char **argv)
 	case 'x':
 	  xflag = 1;
 	  break;
+	case FOLLOW_VALUE:
+	  follow = 1;
+	  break;
+	case OUTPUT_VALUE:
+	  output_fmt = output_format (optarg);
+	  break;
+	case PAGE_VALUE:
+	  page = 1;
+	  break;
+	case OVERLAP_VALUE:
+	  overlap = 1;
+	  break;
+	case BEFORE_VALUE:
+	  {
+	    char *ep;
+
+	    /* LOGIN:ID as printed for the next page */
+	    errno = 0;
+	    page_login = strtoull (optarg, &ep, 10);
+	    if (errno == 0 && *ep == ':')
+	      page_id = strtoll (ep + 1, &ep, 10);
+	    if (errno != 0 || *ep != '\0' || page_id <= 0)
+	      {
+		fprintf (stderr, "Invalid cursor '%s'\n", optarg);
+		exit (EXIT_FAILURE);
+	      }
+	    page = 1;
+	  }
+	  break;
 	case TIMEFMT_VALUE:
 	  time_fmt = time_format (optarg);
 	  if (time_fmt == -1)
@@ -873,6 +1695,20 @@ main_last (int argc, char **argv)
 	      exit (EXIT_FAILURE);
 	    }
 	  break;
+	case MMAP_VALUE:
+	  if (parse_size (optarg, &mmap_size) < 0)
+	    {
+	      fprintf (stderr, "Invalid mmap size '%s'\n", optarg);
+	      exit (EXIT_FAILURE);
+	    }
+	  break;
+	case CACHE_VALUE:
+	  if (parse_size (optarg, &cache_size) < 0)
+	    {
+	      fprintf (stderr, "Invalid cache size '%s'\n", optarg);
+	      exit (EXIT_FAILURE);
+	    }
+	  break;
         default:
           usage (EXIT_FAILURE);
           break;
@@ -882,6 +1718,31 @@ main_last (int argc, char **argv)
   if (argc > optind)
     match = argv + optind;
 
+  /* A page is exactly what the database returns, anything filtering
+     entries afterwards would make it shorter. */
+  if (page && (maxentries == 0 || match || since || until || present ||
+	       xflag || follow))
+    {
+      fprintf (stderr, "The option --page needs -n and cannot be used together with\n"
+	       "--since, --until, --present, --system, --follow and user or tty names.\n");
+      usage (EXIT_FAILURE);
+    }
+
+  if (overlap && ((!since && !until) || present || xflag || follow || page))
+    {
+      fprintf (stderr, "The option --overlap needs --since or --until and cannot be used\n"
+	       "together with --present, --system, --follow and --page.\n");
+      usage (EXIT_FAILURE);
+    }
+
+  if (jflag && output_fmt != OUTPUT_TEXT && output_fmt != OUTPUT_JSON)
+    {
+      fprintf (stderr, "The options -j and --output cannot be used together.\n");
+      usage (EXIT_FAILURE);
+    }
+  if (output_fmt == OUTPUT_JSON)
+    jflag = 1;
+
   if (nohostname && hostlast)
     {
       fprintf (stderr, "The options -a and -R cannot be used together.\n");
@@ -906,10 +1767,87 @@ main_last (int argc, char **argv)
       usage (EXIT_FAILURE);
     }
 
+  /* stdout is flushed in large blocks, not after every line */
+  setvbuf (stdout, stdout_buf, _IOFBF, sizeof (stdout_buf));
+
+  wtmpdb_set_read_cache (mmap_size, cache_size);
+
+  if (follow && jflag)
+    {
+      fprintf (stderr, "The options --follow and -j cannot be used together.\n");
+      usage (EXIT_FAILURE);
+    }
+
+#if WITH_WTMPDBD
+  /* Subscribe before reading, so that no event gets lost */
+  _cleanup_(sd_varlink_unrefp) sd_varlink *follow_link = NULL;
+  if (follow && (wtmpdb_path == NULL || strcmp (wtmpdb_path, "varlink") == 0))
+    follow_link = follow_subscribe ();
+#endif
+
+  int indexed_present = present && !xflag && !follow;
+  int r;
+
+  if (dflag || iflag)
+    resolve_hosts (overlap, indexed_present);
+
   if (jflag)
     printf ("{\n   \"entries\": [\n");
+  else
+    print_record_header ();
+
+  if (overlap)
+    {
+      /* until is inclusive, up to the end of its second */
+      uint64_t from = (uint64_t) since * USEC_PER_SEC;
+      uint64_t to = until ? (uint64_t) until * USEC_PER_SEC + USEC_PER_SEC - 1 : 0;
+      uint64_t boottime = wtmpdb_get_boottime (wtmpdb_path, &error);
+
+      /* a later boot marks open sessions as crashed */
+      if (to && boottime > to)
+	after_reboot = boottime;
+      free (error);
+      error = NULL;
+
+      /* print_entry must not filter by the login time anymore */
+      since = until = 0;
+      r = wtmpdb_read_overlap (wtmpdb_path, from, to, print_entry, NULL, &error);
+    }
+  else if (page)
+    {
+      /* Sessions of the page which never got a logout crashed if the
+	 system was booted again later, maybe in a previous page. */
+      if (page_id > 0)
+	{
+	  uint64_t boottime = wtmpdb_get_boottime (wtmpdb_path, &error);
+
+	  if (boottime >= page_login)
+	    after_reboot = boottime;
+	  free (error);
+	  error = NULL;
+	}
+      r = wtmpdb_read_page (wtmpdb_path, page_login, page_id, maxentries,
+			    print_entry, NULL, &error);
+    }
+  else if (indexed_present)
+    {
+      /* Only the sessions active at that time are read, so a later
+	 boot, which marks open sessions as crashed, is not seen. */
+      uint64_t at = (uint64_t) present * USEC_PER_SEC;
+      uint64_t boottime = wtmpdb_get_boottime (wtmpdb_path, &error);
+
+      if (boottime > at)
+	after_reboot = boottime;
+      free (error);
+      error = NULL;
 
-  if (wtmpdb_read_all (wtmpdb_path, print_entry, &error) != 0)
+      /* the oldest entry is not read, so there is no summary */
+      r = wtmpdb_read_present (wtmpdb_path, at, print_entry, NULL, &error);
+    }
+  else
+    r = wtmpdb_read_all (wtmpdb_path, follow ? follow_read_entry : print_entry,
+			 &error);
+  if (r != 0)
     {
       if (error)
         {
@@ -922,7 +1860,26 @@ main_last (int argc, char **argv)
       exit (EXIT_FAILURE);
     }
 
-  if (wtmp_start == UINT64_MAX)
+  if (output_fmt == OUTPUT_NDJSON || output_fmt == OUTPUT_CSV)
+    ; /* records only, no summary */
+  else if (page)
+    {
+      /* a short page is the last one */
+      if (jflag && currentry < maxentries)
+	printf ("\n   ],\n   \"next_cursor\": null\n");
+      else if (jflag)
+	printf ("\n   ],\n   \"next_cursor\": \"%" PRIu64 ":%" PRId64 "\"\n",
+		page_login, page_id);
+      else if (currentry >= maxentries)
+	printf ("\nNext page: --before %" PRIu64 ":%" PRId64 "\n",
+		page_login, page_id);
+    }
+  else if (indexed_present || overlap)
+    {
+      if (jflag)
+	printf ("\n   ]\n");
+    }
+  else if (wtmp_start == UINT64_MAX)
     {
       if (!jflag)
 	printf ("%s has no entries\n", wtmpdb_path?wtmpdb_path:"wtmpdb");
@@ -942,6 +1899,23 @@ main_last (int argc, char **argv)
 
   if (jflag)
     printf ("}\n");
+
+  if (follow)
+    {
+      /* From now on every new entry is displayed */
+      maxentries = 0;
+      fflush (stdout);
+
+#if WITH_WTMPDBD
+      if (follow_link)
+	r = follow_daemon (follow_link);
+      else
+#endif
+	r = follow_poll ();
+
+      return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
   return EXIT_SUCCESS;
 }
 
@@ -1171,22 +2145,77 @@ main_boottime (int argc, char **argv)
 }
 
 static int
-main_shutdown (int argc, char **argv)
+print_who (void *unused __attribute__((__unused__)),
+	   int argc, char **argv, char **azColName)
+{
+  /* ID, Type, User, LoginTime, LogoutTime, TTY, RemoteHost, Service */
+  if (argc != 8)
+    {
+      fprintf (stderr, "Mangled entry:");
+      for (int i = 0; i < argc; i++)
+        fprintf (stderr, " %s=%s", azColName[i], argv[i] ? argv[i] : "NULL");
+      fprintf (stderr, "\n");
+      exit (EXIT_FAILURE);
+    }
+
+  const char *user = argv[2];
+  const char *tty = argv[5]?argv[5]:"?";
+  const char *host = argv[6]?argv[6]:"";
+  uint64_t login_t = strtoull (argv[3], NULL, 10);
+
+  switch (output_fmt)
+    {
+    case OUTPUT_JSON:
+      printf ("%s     ", first_entry ? "" : ",\n");
+      first_entry = 0;
+      /* fallthrough */
+    case OUTPUT_NDJSON:
+    case OUTPUT_CSV:
+      print_record (argv[0], atoi (argv[1]), user, argv[5], argv[6],
+		    argv[7], login_t, 0);
+      break;
+    default:
+      {
+	char timebuf[32];
+
+	format_time (TIMEFMT_SHORT, timebuf, sizeof (timebuf),
+		     login_t/USEC_PER_SEC);
+	if (strlen (host) > 0)
+	  printf ("%-8s %-12s %s (%s)\n", user, tty, timebuf, host);
+	else
+	  printf ("%-8s %-12s %s\n", user, tty, timebuf);
+      }
+      break;
+    }
+
+  return 0;
+}
+
+static int
+main_who (int argc, char **argv)
 {
   struct option const longopts[] = {
     {"file", required_argument, NULL, 'f'},
+    {"json", no_argument, NULL, 'j'},
+    {"output", required_argument, NULL, OUTPUT_VALUE},
     {NULL, 0, NULL, '\0'}
   };
   char *error = NULL;
   int c;
 
-  while ((c = getopt_long (argc, argv, "f:", longopts, NULL)) != -1)
+  while ((c = getopt_long (argc, argv, "f:j", longopts, NULL)) != -1)
     {
       switch (c)
         {
         case 'f':
           wtmpdb_path = optarg;
           break;
+	case 'j':
+	  output_fmt = OUTPUT_JSON;
+	  break;
+	case OUTPUT_VALUE:
+	  output_fmt = output_format (optarg);
+	  break;
         default:
           usage (EXIT_FAILURE);
           break;
@@ -1199,12 +2228,12 @@ main_shutdown (int argc, char **argv)
       usage (EXIT_FAILURE);
     }
 
-#if HAVE_AUDIT
-  log_audit (AUDIT_SYSTEM_SHUTDOWN);
-#endif
+  if (output_fmt == OUTPUT_JSON)
+    printf ("{\n   \"sessions\": [\n");
+  else
+    print_record_header ();
 
-  int64_t id = wtmpdb_get_id (wtmpdb_path, "~", &error);
-  if (id < 0)
+  if (wtmpdb_read_current (wtmpdb_path, print_who, NULL, &error) != 0)
     {
       if (error)
         {
@@ -1212,20 +2241,588 @@ main_shutdown (int argc, char **argv)
           free (error);
         }
       else
-        fprintf (stderr, "Couldn't get ID for reboot entry\n");
+        fprintf (stderr, "Couldn't read open sessions\n");
 
       exit (EXIT_FAILURE);
     }
 
-  struct timespec ts;
-  clock_gettime (CLOCK_REALTIME, &ts);
-  uint64_t time = wtmpdb_timespec2usec (ts);
+  if (output_fmt == OUTPUT_JSON)
+    printf ("%s   ]\n}\n", first_entry ? "" : "\n");
 
-  if (wtmpdb_logout (wtmpdb_path, id, time, &error) < 0)
+  return EXIT_SUCCESS;
+}
+
+static const char *report_groups[] = {
+  [WTMPDB_REPORT_USER]    = "user",
+  [WTMPDB_REPORT_HOST]    = "host",
+  [WTMPDB_REPORT_SERVICE] = "service",
+  [WTMPDB_REPORT_TTY]     = "tty",
+  [WTMPDB_REPORT_DAY]     = "day",
+  [WTMPDB_REPORT_HOUR]    = "hour",
+};
+
+static const char *report_headers[] = {
+  [WTMPDB_REPORT_USER]    = "USER",
+  [WTMPDB_REPORT_HOST]    = "HOST",
+  [WTMPDB_REPORT_SERVICE] = "SERVICE",
+  [WTMPDB_REPORT_TTY]     = "TTY",
+  [WTMPDB_REPORT_DAY]     = "DAY",
+  [WTMPDB_REPORT_HOUR]    = "HOUR",
+};
+
+static int
+print_report (void *unused __attribute__((__unused__)),
+	      int argc, char **argv, char **azColName)
+{
+  /* Key, Sessions, Seconds, Users, Hosts */
+  if (argc != 5)
     {
-      if (error)
-        {
-          fprintf (stderr, "%s\n", error);
+      fprintf (stderr, "Mangled entry:");
+      for (int i = 0; i < argc; i++)
+        fprintf (stderr, " %s=%s", azColName[i], argv[i] ? argv[i] : "NULL");
+      fprintf (stderr, "\n");
+      exit (EXIT_FAILURE);
+    }
+
+  const char *key = argv[0]?argv[0]:"";
+  uint64_t sessions = strtoull (argv[1]?argv[1]:"0", NULL, 10);
+  uint64_t seconds = strtoull (argv[2]?argv[2]:"0", NULL, 10);
+  uint64_t users = strtoull (argv[3]?argv[3]:"0", NULL, 10);
+  uint64_t hosts = strtoull (argv[4]?argv[4]:"0", NULL, 10);
+
+  switch (output_fmt)
+    {
+    case OUTPUT_JSON:
+      printf ("%s     ", first_entry ? "" : ",\n");
+      first_entry = 0;
+      /* fallthrough */
+    case OUTPUT_NDJSON:
+      fputs ("{\"key\":", stdout);
+      print_json_string (key);
+      printf (",\"sessions\":%" PRIu64 ",\"seconds\":%" PRIu64
+	      ",\"users\":%" PRIu64 ",\"hosts\":%" PRIu64 "}%s",
+	      sessions, seconds, users, hosts,
+	      output_fmt == OUTPUT_NDJSON ? "\n" : "");
+      break;
+    case OUTPUT_CSV:
+      print_csv_field (key);
+      printf (",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+	      sessions, seconds, users, hosts);
+      break;
+    default:
+      {
+	char length[LAST_TIMESTAMP_LEN];
+
+	/* same format as the session length of last */
+	calc_time_length (length, sizeof (length), 0, seconds * USEC_PER_SEC);
+	printf ("%-16s %8" PRIu64 " %10s %6" PRIu64 " %6" PRIu64 "\n",
+		strlen (key) > 0 ? key : "-", sessions,
+		remove_parentheses (length), users, hosts);
+      }
+      break;
+    }
+
+  return 0;
+}
+
+static int
+main_report (int argc, char **argv)
+{
+  struct option const longopts[] = {
+    {"file", required_argument, NULL, 'f'},
+    {"group-by", required_argument, NULL, 'g'},
+    {"json", no_argument, NULL, 'j'},
+    {"limit", required_argument, NULL, 'n'},
+    {"since", required_argument, NULL, 's'},
+    {"until", required_argument, NULL, 't'},
+    {"output", required_argument, NULL, OUTPUT_VALUE},
+    {NULL, 0, NULL, '\0'}
+  };
+  char *error = NULL;
+  int group_by = WTMPDB_REPORT_USER;
+  unsigned long limit = 0;
+  time_t report_since = 0, report_until = 0;
+  int c;
+
+  while ((c = getopt_long (argc, argv, "f:g:jn:s:t:", longopts, NULL)) != -1)
+    {
+      switch (c)
+        {
+        case 'f':
+          wtmpdb_path = optarg;
+          break;
+	case 'g':
+	  group_by = -1;
+	  for (size_t i = 0; i < sizeof (report_groups)/sizeof (report_groups[0]); i++)
+	    if (strcmp (optarg, report_groups[i]) == 0)
+	      group_by = i;
+	  if (group_by < 0)
+	    {
+	      fprintf (stderr, "Invalid group '%s'\n", optarg);
+	      exit (EXIT_FAILURE);
+	    }
+	  break;
+	case 'j':
+	  output_fmt = OUTPUT_JSON;
+	  break;
+	case 'n':
+	  limit = strtoul (optarg, NULL, 10);
+	  break;
+	case 's':
+	  if (parse_time (optarg, &report_since) < 0)
+	    {
+	      fprintf (stderr, "Invalid time value '%s'\n", optarg);
+	      exit (EXIT_FAILURE);
+	    }
+	  break;
+	case 't':
+	  if (parse_time (optarg, &report_until) < 0)
+	    {
+	      fprintf (stderr, "Invalid time value '%s'\n", optarg);
+	      exit (EXIT_FAILURE);
+	    }
+	  break;
+	case OUTPUT_VALUE:
+	  output_fmt = output_format (optarg);
+	  break;
+        default:
+          usage (EXIT_FAILURE);
+          break;
+        }
+    }
+
+  if (argc > optind)
+    {
+      fprintf (stderr, "Unexpected argument: %s\n", argv[optind]);
+      usage (EXIT_FAILURE);
+    }
+
+  switch (output_fmt)
+    {
+    case OUTPUT_JSON:
+      printf ("{\n   \"group\": \"%s\",\n   \"report\": [\n",
+	      report_groups[group_by]);
+      break;
+    case OUTPUT_CSV:
+      fputs ("key,sessions,seconds,users,hosts\n", stdout);
+      break;
+    case OUTPUT_TEXT:
+      printf ("%-16s %8s %10s %6s %6s\n", report_headers[group_by],
+	      "SESSIONS", "CONNECTED", "USERS", "HOSTS");
+      break;
+    }
+
+  /* like last: the login time in seconds is compared */
+  if (wtmpdb_report (wtmpdb_path, group_by,
+		     report_since * USEC_PER_SEC,
+		     report_until ? report_until * USEC_PER_SEC + USEC_PER_SEC - 1 : 0,
+		     limit, print_report, NULL, &error) != 0)
+    {
+      if (error)
+        {
+          fprintf (stderr, "%s\n", error);
+          free (error);
+        }
+      else
+        fprintf (stderr, "Couldn't create report\n");
+
+      exit (EXIT_FAILURE);
+    }
+
+  if (output_fmt == OUTPUT_JSON)
+    printf ("%s   ]\n}\n", first_entry ? "" : "\n");
+
+  return EXIT_SUCCESS;
+}
+
+/* SIZE of concurrency --bucket: a number with the optional suffix
+   s, m, h or d, seconds without suffix. */
+static int
+parse_bucket (const char *str, uint64_t *usec)
+{
+  char *ep;
+  unsigned long long n;
+
+  errno = 0;
+  n = strtoull (str, &ep, 10);
+  if (errno != 0 || ep == str || n == 0)
+    return -1;
+
+  switch (*ep)
+    {
+    case 'd':
+      n *= 24;
+      /* fallthrough */
+    case 'h':
+      n *= 60;
+      /* fallthrough */
+    case 'm':
+      n *= 60;
+      /* fallthrough */
+    case 's':
+      ep++;
+      break;
+    case '\0':
+      break;
+    default:
+      return -1;
+    }
+  if (*ep != '\0' || n > UINT64_MAX / USEC_PER_SEC)
+    return -1;
+
+  *usec = n * USEC_PER_SEC;
+  return 0;
+}
+
+static int
+print_concurrency (void *unused __attribute__((__unused__)),
+		   int argc, char **argv, char **azColName)
+{
+  /* Start, Peak, Sessions */
+  if (argc != 3)
+    {
+      fprintf (stderr, "Mangled entry:");
+      for (int i = 0; i < argc; i++)
+        fprintf (stderr, " %s=%s", azColName[i], argv[i] ? argv[i] : "NULL");
+      fprintf (stderr, "\n");
+      exit (EXIT_FAILURE);
+    }
+
+  uint64_t start = strtoull (argv[0], NULL, 10);
+  uint64_t peak = strtoull (argv[1], NULL, 10);
+  uint64_t sessions = strtoull (argv[2], NULL, 10);
+
+  switch (output_fmt)
+    {
+    case OUTPUT_JSON:
+      printf ("%s     ", first_entry ? "" : ",\n");
+      first_entry = 0;
+      /* fallthrough */
+    case OUTPUT_NDJSON:
+      printf ("{\"start_usec\":%" PRIu64 ",\"peak\":%" PRIu64
+	      ",\"sessions\":%" PRIu64 "}%s", start, peak, sessions,
+	      output_fmt == OUTPUT_NDJSON ? "\n" : "");
+      break;
+    case OUTPUT_CSV:
+      printf ("%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", start, peak, sessions);
+      break;
+    default:
+      {
+	char timebuf[LAST_TIMESTAMP_LEN];
+
+	format_time (TIMEFMT_ISO, timebuf, sizeof (timebuf),
+		     start / USEC_PER_SEC);
+	printf ("%-25s %6" PRIu64 " %8" PRIu64 "\n", timebuf, peak, sessions);
+      }
+      break;
+    }
+
+  return 0;
+}
+
+static int
+main_concurrency (int argc, char **argv)
+{
+  struct option const longopts[] = {
+    {"file", required_argument, NULL, 'f'},
+    {"bucket", required_argument, NULL, 'b'},
+    {"json", no_argument, NULL, 'j'},
+    {"since", required_argument, NULL, 's'},
+    {"until", required_argument, NULL, 't'},
+    {"output", required_argument, NULL, OUTPUT_VALUE},
+    {NULL, 0, NULL, '\0'}
+  };
+  char *error = NULL;
+  uint64_t bucket = 3600 * USEC_PER_SEC;
+  time_t conc_since = 0, conc_until = 0;
+  int c;
+
+  while ((c = getopt_long (argc, argv, "b:f:js:t:", longopts, NULL)) != -1)
+    {
+      switch (c)
+        {
+        case 'f':
+          wtmpdb_path = optarg;
+          break;
+	case 'b':
+	  if (parse_bucket (optarg, &bucket) < 0)
+	    {
+	      fprintf (stderr, "Invalid bucket size '%s'\n", optarg);
+	      exit (EXIT_FAILURE);
+	    }
+	  break;
+	case 'j':
+	  output_fmt = OUTPUT_JSON;
+	  break;
+	case 's':
+	  if (parse_time (optarg, &conc_since) < 0)
+	    {
+	      fprintf (stderr, "Invalid time value '%s'\n", optarg);
+	      exit (EXIT_FAILURE);
+	    }
+	  break;
+	case 't':
+	  if (parse_time (optarg, &conc_until) < 0)
+	    {
+	      fprintf (stderr, "Invalid time value '%s'\n", optarg);
+	      exit (EXIT_FAILURE);
+	    }
+	  break;
+	case OUTPUT_VALUE:
+	  output_fmt = output_format (optarg);
+	  break;
+        default:
+          usage (EXIT_FAILURE);
+          break;
+        }
+    }
+
+  if (argc > optind)
+    {
+      fprintf (stderr, "Unexpected argument: %s\n", argv[optind]);
+      usage (EXIT_FAILURE);
+    }
+
+  switch (output_fmt)
+    {
+    case OUTPUT_JSON:
+      printf ("{\n   \"bucket_usec\": %" PRIu64 ",\n   \"concurrency\": [\n",
+	      bucket);
+      break;
+    case OUTPUT_CSV:
+      fputs ("start_usec,peak,sessions\n", stdout);
+      break;
+    case OUTPUT_TEXT:
+      printf ("%-25s %6s %8s\n", "START", "PEAK", "SESSIONS");
+      break;
+    }
+
+  if (wtmpdb_concurrency (wtmpdb_path, conc_since * USEC_PER_SEC,
+			  conc_until ? conc_until * USEC_PER_SEC + USEC_PER_SEC - 1 : 0,
+			  bucket, print_concurrency, NULL, &error) != 0)
+    {
+      if (error)
+        {
+          fprintf (stderr, "%s\n", error);
+          free (error);
+        }
+      else
+        fprintf (stderr, "Couldn't compute concurrent sessions\n");
+
+      exit (EXIT_FAILURE);
+    }
+
+  if (output_fmt == OUTPUT_JSON)
+    printf ("%s   ]\n}\n", first_entry ? "" : "\n");
+
+  return EXIT_SUCCESS;
+}
+
+static int
+main_rollup (int argc, char **argv)
+{
+  struct option const longopts[] = {
+    {"file", required_argument, NULL, 'f'},
+    {"disable", no_argument, NULL, 'D'},
+    {NULL, 0, NULL, '\0'}
+  };
+  char *error = NULL;
+  int enable = 1;
+  int c;
+
+  while ((c = getopt_long (argc, argv, "f:D", longopts, NULL)) != -1)
+    {
+      switch (c)
+        {
+        case 'f':
+          wtmpdb_path = optarg;
+          break;
+	case 'D':
+	  enable = 0;
+	  break;
+        default:
+          usage (EXIT_FAILURE);
+          break;
+        }
+    }
+
+  if (argc > optind)
+    {
+      fprintf (stderr, "Unexpected argument: %s\n", argv[optind]);
+      usage (EXIT_FAILURE);
+    }
+
+  if (wtmpdb_rollup (wtmpdb_path, enable, &error) < 0)
+    {
+      if (error)
+        {
+          fprintf (stderr, "%s\n", error);
+          free (error);
+        }
+      else
+        fprintf (stderr, "Couldn't %s rollup\n", enable ? "create" : "remove");
+
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+static int
+main_intern (int argc, char **argv)
+{
+  struct option const longopts[] = {
+    {"file", required_argument, NULL, 'f'},
+    {"disable", no_argument, NULL, 'D'},
+    {NULL, 0, NULL, '\0'}
+  };
+  char *error = NULL;
+  int enable = 1;
+  int c;
+
+  while ((c = getopt_long (argc, argv, "f:D", longopts, NULL)) != -1)
+    {
+      switch (c)
+        {
+        case 'f':
+          wtmpdb_path = optarg;
+          break;
+	case 'D':
+	  enable = 0;
+	  break;
+        default:
+          usage (EXIT_FAILURE);
+          break;
+        }
+    }
+
+  if (argc > optind)
+    {
+      fprintf (stderr, "Unexpected argument: %s\n", argv[optind]);
+      usage (EXIT_FAILURE);
+    }
+
+  if (wtmpdb_intern (wtmpdb_path, enable, &error) < 0)
+    {
+      if (error)
+        {
+          fprintf (stderr, "%s\n", error);
+          free (error);
+        }
+      else
+        fprintf (stderr, "Couldn't %s interned strings\n", enable ? "create" : "remove");
+
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+static int
+main_migrate (int argc, char **argv)
+{
+  struct option const longopts[] = {
+    {"file", required_argument, NULL, 'f'},
+    {NULL, 0, NULL, '\0'}
+  };
+  char *error = NULL;
+  int version;
+  int c;
+
+  while ((c = getopt_long (argc, argv, "f:", longopts, NULL)) != -1)
+    {
+      switch (c)
+        {
+        case 'f':
+          wtmpdb_path = optarg;
+          break;
+        default:
+          usage (EXIT_FAILURE);
+          break;
+        }
+    }
+
+  if (argc > optind)
+    {
+      fprintf (stderr, "Unexpected argument: %s\n", argv[optind]);
+      usage (EXIT_FAILURE);
+    }
+
+  version = wtmpdb_migrate (wtmpdb_path, &error);
+  if (version < 0)
+    {
+      if (error)
+        {
+          fprintf (stderr, "%s\n", error);
+          free (error);
+        }
+      else
+        fprintf (stderr, "Couldn't migrate database: %s\n", strerror (-version));
+
+      return EXIT_FAILURE;
+    }
+
+  printf ("Schema version: %d\n", version);
+
+  return EXIT_SUCCESS;
+}
+
+static int
+main_shutdown (int argc, char **argv)
+{
+  struct option const longopts[] = {
+    {"file", required_argument, NULL, 'f'},
+    {NULL, 0, NULL, '\0'}
+  };
+  char *error = NULL;
+  int c;
+
+  while ((c = getopt_long (argc, argv, "f:", longopts, NULL)) != -1)
+    {
+      switch (c)
+        {
+        case 'f':
+          wtmpdb_path = optarg;
+          break;
+        default:
+          usage (EXIT_FAILURE);
+          break;
+        }
+    }
+
+  if (argc > optind)
+    {
+      fprintf (stderr, "Unexpected argument: %s\n", argv[optind]);
+      usage (EXIT_FAILURE);
+    }
+
+#if HAVE_AUDIT
+  log_audit (AUDIT_SYSTEM_SHUTDOWN);
+#endif
+
+  int64_t id = wtmpdb_get_id (wtmpdb_path, "~", &error);
+  if (id < 0)
+    {
+      if (error)
+        {
+          fprintf (stderr, "%s\n", error);
+          free (error);
+        }
+      else
+        fprintf (stderr, "Couldn't get ID for reboot entry\n");
+
+      exit (EXIT_FAILURE);
+    }
+
+  struct timespec ts;
+  clock_gettime (CLOCK_REALTIME, &ts);
+  uint64_t time = wtmpdb_timespec2usec (ts);
+
+  if (wtmpdb_logout (wtmpdb_path, id, time, &error) < 0)
+    {
+      if (error)
+        {
+          fprintf (stderr, "%s\n", error);
           free (error);
         }
       else
@@ -1272,6 +2869,164 @@ main_import (int argc, char **argv)
   return EXIT_SUCCESS;
 }
 
+#if WITH_WTMPDBD
+struct method_stats {
+  char *name;
+  uint64_t calls;
+  uint64_t errors;
+  uint64_t rows;
+  uint64_t payload_bytes;
+  uint64_t p50;
+  uint64_t p90;
+  uint64_t p99;
+  uint64_t max;
+};
+
+static void
+method_stats_free (struct method_stats *var)
+{
+  free (var->name);
+  var->name = NULL;
+}
+
+struct daemon_stats {
+  uint64_t uptime;
+  uint64_t connections;
+  uint64_t threads;
+  uint64_t busy_retries;
+  sd_json_variant *methods;
+};
+
+static int
+print_daemon_stats (void)
+{
+  struct daemon_stats p = {0};
+  static const sd_json_dispatch_field dispatch_table[] = {
+    { "UptimeUSec",    SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64,  offsetof(struct daemon_stats, uptime), 0 },
+    { "Connections",   SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64,  offsetof(struct daemon_stats, connections), 0 },
+    { "WorkerThreads", SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64,  offsetof(struct daemon_stats, threads), 0 },
+    { "BusyRetries",   SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64,  offsetof(struct daemon_stats, busy_retries), 0 },
+    { "Methods",       SD_JSON_VARIANT_ARRAY,    sd_json_dispatch_variant_noref, offsetof(struct daemon_stats, methods), 0 },
+    {}
+  };
+  _cleanup_(sd_varlink_unrefp) sd_varlink *link = NULL;
+  sd_json_variant *result;
+  const char *error_id = NULL;
+  int r;
+
+  r = sd_varlink_connect_address (&link, _VARLINK_WTMPDB_SOCKET);
+  if (r < 0)
+    {
+      fprintf (stderr, "Failed to connect to %s: %s\n",
+	       _VARLINK_WTMPDB_SOCKET, strerror (-r));
+      return r;
+    }
+
+  r = sd_varlink_call (link, "org.openSUSE.wtmpdb.GetStatistics", NULL,
+		       &result, &error_id);
+  if (r < 0)
+    {
+      fprintf (stderr, "Failed to call GetStatistics method: %s\n",
+	       strerror (-r));
+      return r;
+    }
+  if (error_id && strlen (error_id) > 0)
+    {
+      fprintf (stderr, "GetStatistics failed: %s\n", error_id);
+      return -EIO;
+    }
+
+  r = sd_json_dispatch (result, dispatch_table, SD_JSON_ALLOW_EXTENSIONS, &p);
+  if (r < 0)
+    {
+      fprintf (stderr, "Failed to parse JSON answer: %s\n", strerror (-r));
+      return r;
+    }
+
+  printf ("Uptime:         %" PRIu64 " sec\n", p.uptime / USEC_PER_SEC);
+  printf ("Connections:    %" PRIu64 "\n", p.connections);
+  printf ("Worker threads: %" PRIu64 "\n", p.threads);
+  printf ("Busy retries:   %" PRIu64 "\n\n", p.busy_retries);
+
+  printf ("%-15s %8s %7s %9s %11s %9s %9s %9s %9s\n", "Method", "Calls",
+	  "Errors", "Rows", "Payload", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+
+  for (size_t i = 0; i < sd_json_variant_elements (p.methods); i++)
+    {
+      _cleanup_(method_stats_free) struct method_stats m = {0};
+      static const sd_json_dispatch_field dispatch_method_table[] = {
+	{ "Name",    SD_JSON_VARIANT_STRING,   sd_json_dispatch_string, offsetof(struct method_stats, name), SD_JSON_MANDATORY },
+	{ "Calls",   SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct method_stats, calls), 0 },
+	{ "Errors",  SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct method_stats, errors), 0 },
+	{ "Rows",    SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct method_stats, rows), 0 },
+	{ "PayloadBytes", SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64, offsetof(struct method_stats, payload_bytes), 0 },
+	{ "P50USec", SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct method_stats, p50), 0 },
+	{ "P90USec", SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct method_stats, p90), 0 },
+	{ "P99USec", SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct method_stats, p99), 0 },
+	{ "MaxUSec", SD_JSON_VARIANT_INTEGER,  sd_json_dispatch_uint64, offsetof(struct method_stats, max), 0 },
+	{}
+      };
+
+      r = sd_json_dispatch (sd_json_variant_by_index (p.methods, i),
+			    dispatch_method_table, SD_JSON_ALLOW_EXTENSIONS, &m);
+      if (r < 0)
+	{
+	  fprintf (stderr, "Failed to parse JSON answer: %s\n", strerror (-r));
+	  return r;
+	}
+
+      if (m.calls == 0)
+	continue;
+
+      printf ("%-15s %8" PRIu64 " %7" PRIu64 " %9" PRIu64 " %11" PRIu64
+	      " %9" PRIu64 " %9" PRIu64 " %9" PRIu64 " %9" PRIu64 "\n",
+	      m.name, m.calls, m.errors, m.rows, m.payload_bytes,
+	      m.p50, m.p90, m.p99, m.max);
+    }
+
+  return 0;
+}
+#endif
+
+static int
+main_stats (int argc, char **argv)
+{
+  struct option const longopts[] = {
+    {"daemon", no_argument, NULL, 'd'},
+    {NULL, 0, NULL, '\0'}
+  };
+  int c;
+
+  while ((c = getopt_long (argc, argv, "d", longopts, NULL)) != -1)
+    {
+      switch (c)
+        {
+        case 'd':
+	  /* only source for now */
+          break;
+        default:
+          usage (EXIT_FAILURE);
+          break;
+        }
+    }
+
+  if (argc > optind)
+    {
+      fprintf (stderr, "Unexpected argument: %s\n", argv[optind]);
+      usage (EXIT_FAILURE);
+    }
+
+#if WITH_WTMPDBD
+  if (print_daemon_stats () < 0)
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+#else
+  fprintf (stderr, "wtmpdb was built without wtmpdbd support\n");
+  return EXIT_FAILURE;
+#endif
+}
+
 int
 main (int argc, char **argv)
 {
@@ -1298,6 +3053,20 @@ main (int argc, char **argv)
     return main_rotate (--argc, ++argv);
   else if (strcmp (argv[1], "import") == 0)
     return main_import (--argc, ++argv);
+  else if (strcmp (argv[1], "stats") == 0)
+    return main_stats (--argc, ++argv);
+  else if (strcmp (argv[1], "who") == 0)
+    return main_who (--argc, ++argv);
+  else if (strcmp (argv[1], "report") == 0)
+    return main_report (--argc, ++argv);
+  else if (strcmp (argv[1], "concurrency") == 0)
+    return main_concurrency (--argc, ++argv);
+  else if (strcmp (argv[1], "rollup") == 0)
+    return main_rollup (--argc, ++argv);
+  else if (strcmp (argv[1], "intern") == 0)
+    return main_intern (--argc, ++argv);
+  else if (strcmp (argv[1], "migrate") == 0)
+    return main_migrate (--argc, ++argv);
 
   while ((c = getopt_long (argc, argv, "hv", longopts, NULL)) != -1)
     {
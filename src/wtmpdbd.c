@@ -18,10 +18,16 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <limits.h>
 #include <getopt.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <libintl.h>
 #include <syslog.h>
 #include <systemd/sd-daemon.h>
@@ -31,6 +37,7 @@
 #include "basics.h"
 #include "wtmpdb.h"
 #include "mkdir_p.h"
+#include "probes.h"
 
 #include "varlink-org.openSUSE.wtmpdb.h"
 
@@ -77,6 +84,132 @@ log_msg (int priority, const char *fmt, ...)
   va_end (ap);
 }
 
+static uint64_t
+now_usec (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return wtmpdb_timespec2usec (ts);
+}
+
+/* Statistics for GetStatistics, only accessed from the event loop. */
+enum method {
+  METHOD_CONCURRENCY,
+  METHOD_GET_BOOTTIME,
+  METHOD_GET_ENVIRONMENT,
+  METHOD_GET_ID,
+  METHOD_GET_STATISTICS,
+  METHOD_LOGIN,
+  METHOD_LOGOUT,
+  METHOD_PING,
+  METHOD_QUIT,
+  METHOD_READ_ALL,
+  METHOD_REPORT,
+  METHOD_ROTATE,
+  METHOD_ROTATE_STATUS,
+  METHOD_SET_LOG_LEVEL,
+  METHOD_SUBSCRIBE,
+  _METHOD_MAX
+};
+
+static const char *const method_names[_METHOD_MAX] = {
+  [METHOD_CONCURRENCY]     = "Concurrency",
+  [METHOD_GET_BOOTTIME]    = "GetBootTime",
+  [METHOD_GET_ENVIRONMENT] = "GetEnvironment",
+  [METHOD_GET_ID]          = "GetID",
+  [METHOD_GET_STATISTICS]  = "GetStatistics",
+  [METHOD_LOGIN]           = "Login",
+  [METHOD_LOGOUT]          = "Logout",
+  [METHOD_PING]            = "Ping",
+  [METHOD_QUIT]            = "Quit",
+  [METHOD_READ_ALL]        = "ReadAll",
+  [METHOD_REPORT]          = "Report",
+  [METHOD_ROTATE]          = "Rotate",
+  [METHOD_ROTATE_STATUS]   = "RotateStatus",
+  [METHOD_SET_LOG_LEVEL]   = "SetLogLevel",
+  [METHOD_SUBSCRIBE]       = "Subscribe",
+};
+
+/* Bucket i counts calls which took less than 2^i usec, the
+   last one all calls slower than 2^(LATENCY_BUCKETS-2) usec. */
+#define LATENCY_BUCKETS 27
+
+struct method_stats {
+  uint64_t calls;
+  uint64_t errors;
+  uint64_t rows;
+  uint64_t payload_bytes;
+  uint64_t max_usec;
+  uint64_t buckets[LATENCY_BUCKETS];
+};
+
+static struct method_stats method_stats[_METHOD_MAX];
+static uint64_t start_usec = 0;
+static sd_varlink_server *stats_server = NULL;
+
+/* Both only used by the event loop thread: the current call was
+   handed to a worker, which records it in job_reply(), or it was
+   answered with an error. */
+static bool call_deferred = false;
+static bool call_failed = false;
+
+/* Sending an error reply succeeds, so remember that the call failed. */
+static int
+reply_error (int r)
+{
+  if (r >= 0)
+    call_failed = true;
+  return r;
+}
+
+static void
+stats_record (enum method m, uint64_t start, int r,
+	      uint64_t rows, uint64_t payload_bytes)
+{
+  struct method_stats *st = &method_stats[m];
+  uint64_t usec = now_usec () - start;
+  size_t i = 0;
+
+  if (r >= 0 && call_failed)
+    r = -EBADR;
+  call_failed = false;
+
+  while (i < LATENCY_BUCKETS - 1 && usec >= (UINT64_C(1) << i))
+    i++;
+  st->buckets[i]++;
+
+  st->calls++;
+  if (r < 0)
+    st->errors++;
+  st->rows += rows;
+  st->payload_bytes += payload_bytes;
+  if (usec > st->max_usec)
+    st->max_usec = usec;
+
+  PROBE(method_done, method_names[m], r < 0 ? r : 0, rows, payload_bytes, usec);
+}
+
+/* Returns the upper bound of the bucket containing the percentile. */
+static uint64_t
+stats_percentile (const struct method_stats *st, unsigned int percent)
+{
+  uint64_t rank, sum = 0;
+
+  if (st->calls == 0)
+    return 0;
+
+  rank = (st->calls * percent + 99) / 100;
+  for (size_t i = 0; i < LATENCY_BUCKETS - 1; i++)
+    {
+      sum += st->buckets[i];
+      if (sum >= rank)
+	return (UINT64_C(1) << i) < st->max_usec ? (UINT64_C(1) << i) : st->max_usec;
+    }
+
+  return st->max_usec;
+}
+
 static int
 vl_method_ping(sd_varlink *link, sd_json_variant *parameters,
 	       sd_varlink_method_flags_t _unused_(flags),
@@ -123,7 +256,7 @@ vl_method_set_log_level(sd_varlink *link, sd_json_variant *parameters,
   if (peer_uid != 0)
     {
       log_msg(LOG_WARNING, "SetLogLevel: peer UID %i denied", peer_uid);
-      return sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, parameters);
+      return reply_error (sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, parameters));
     }
 
   set_max_log_level(level);
@@ -156,7 +289,7 @@ vl_method_get_environment(sd_varlink *link, sd_json_variant *parameters,
   if (peer_uid != 0)
     {
       log_msg(LOG_WARNING, "GetEnvironment: peer UID %i denied", peer_uid);
-      return sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, parameters);
+      return reply_error (sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, parameters));
     }
 
 #if 0 /* XXX */
@@ -173,7 +306,7 @@ vl_method_get_environment(sd_varlink *link, sd_json_variant *parameters,
 
 #if 0
  invalid:
-  return sd_varlink_error(link, "io.systemd.service.InconsistentEnvironment", parameters);
+  return reply_error (sd_varlink_error(link, "io.systemd.service.InconsistentEnvironment", parameters));
 #endif
 }
 
@@ -195,6 +328,241 @@ login_record_free (struct login_record *var)
   var->service = mfree(var->service);
 }
 
+/* Clients of the Subscribe method, only accessed from the event
+   loop. A Logout request carries only the ID, so for complete Logout
+   events the entry is read back from the database, but only if
+   somebody is subscribed. */
+struct subscriber {
+  sd_varlink *link;
+  char *user;
+  char *service;
+  int type;
+  struct subscriber *next;
+};
+
+struct session {
+  int64_t id;
+  int type;
+  char *user;
+  uint64_t usec_login;
+  char *tty;
+  char *rhost;
+  char *service;
+};
+
+static struct subscriber *subscribers = NULL;
+
+static struct subscriber *
+subscriber_free (struct subscriber *sub)
+{
+  if (sub == NULL)
+    return NULL;
+
+  sd_varlink_unref (sub->link);
+  free (sub->user);
+  free (sub->service);
+  free (sub);
+
+  return NULL;
+}
+
+static void
+subscriber_freep (struct subscriber **sub)
+{
+  *sub = subscriber_free (*sub);
+}
+
+static void
+session_free (struct session *ses)
+{
+  ses->user = mfree (ses->user);
+  ses->tty = mfree (ses->tty);
+  ses->rhost = mfree (ses->rhost);
+  ses->service = mfree (ses->service);
+}
+
+static int
+session_cb_func (void *u, int argc, char **argv, char _unused_(**azColName))
+{
+  struct session *ses = u;
+
+  if (argc != 8 || argv[1] == NULL || argv[2] == NULL || argv[3] == NULL)
+    return 0;
+
+  ses->id = strtoll (argv[0], NULL, 10);
+  ses->type = atoi (argv[1]);
+  ses->usec_login = strtoull (argv[3], NULL, 10);
+  ses->user = strdup (argv[2]);
+  ses->tty = argv[5] ? strdup (argv[5]) : NULL;
+  ses->rhost = argv[6] ? strdup (argv[6]) : NULL;
+  ses->service = argv[7] ? strdup (argv[7]) : NULL;
+  if (ses->user == NULL || (argv[5] && ses->tty == NULL) ||
+      (argv[6] && ses->rhost == NULL) || (argv[7] && ses->service == NULL))
+    {
+      log_msg (LOG_ERR, "Out of memory");
+      session_free (ses);
+      ses->id = -1;
+    }
+
+  return 0;
+}
+
+/* Returns the entry of a Logout request for the subscribers, or NULL
+   if nobody is subscribed or the entry cannot be read. */
+static struct session *
+session_lookup (int64_t id, struct session *ses)
+{
+  _cleanup_(freep) char *error = NULL;
+
+  if (subscribers == NULL)
+    return NULL;
+
+  if (wtmpdb_read_id (_PATH_WTMPDB, id, session_cb_func, ses, &error) != 0)
+    {
+      log_msg (LOG_WARNING, "Cannot read entry %li for subscribers: %s",
+	       id, error ? error : "unknown");
+      session_free (ses);
+      return NULL;
+    }
+
+  return ses->id == id ? ses : NULL;
+}
+
+static void
+subscriber_disconnect (sd_varlink_server _unused_(*server),
+		       sd_varlink *link, void _unused_(*userdata))
+{
+  for (struct subscriber **sub = &subscribers; *sub; sub = &(*sub)->next)
+    if ((*sub)->link == link)
+      {
+	struct subscriber *found = *sub;
+
+	*sub = found->next;
+	subscriber_free (found);
+	log_msg (LOG_DEBUG, "Subscriber disconnected");
+	return;
+      }
+}
+
+static void
+subscribers_free (void)
+{
+  while (subscribers)
+    {
+      struct subscriber *next = subscribers->next;
+
+      subscriber_free (subscribers);
+      subscribers = next;
+    }
+}
+
+static bool
+subscriber_match (const struct subscriber *sub, const struct session *ses)
+{
+  /* without session data we cannot check the filter */
+  if (ses == NULL)
+    return sub->user == NULL && sub->service == NULL && sub->type < 0;
+
+  if (sub->user && (ses->user == NULL || strcmp (sub->user, ses->user) != 0))
+    return false;
+  if (sub->service && (ses->service == NULL || strcmp (sub->service, ses->service) != 0))
+    return false;
+  if (sub->type >= 0 && sub->type != ses->type)
+    return false;
+
+  return true;
+}
+
+/* ses is NULL for a logout of an entry we could not read */
+static void
+notify_subscribers (const char *event, int64_t id,
+		    const struct session *ses, uint64_t usec_logout)
+{
+  struct subscriber **sub = &subscribers;
+
+  while (*sub)
+    {
+      int r;
+
+      if (!subscriber_match (*sub, ses))
+	{
+	  sub = &(*sub)->next;
+	  continue;
+	}
+
+      r = sd_varlink_notifybo((*sub)->link,
+			      SD_JSON_BUILD_PAIR_STRING("Event", event),
+			      SD_JSON_BUILD_PAIR_INTEGER("ID", id),
+			      SD_JSON_BUILD_PAIR_CONDITION(ses != NULL, "Type",
+							   SD_JSON_BUILD_INTEGER(ses ? ses->type : 0)),
+			      SD_JSON_BUILD_PAIR_CONDITION(ses != NULL, "User",
+							   SD_JSON_BUILD_STRING(ses ? ses->user : NULL)),
+			      SD_JSON_BUILD_PAIR_CONDITION(ses != NULL, "Login",
+							   SD_JSON_BUILD_INTEGER(ses ? ses->usec_login : 0)),
+			      SD_JSON_BUILD_PAIR_CONDITION(usec_logout > 0, "Logout",
+							   SD_JSON_BUILD_INTEGER(usec_logout)),
+			      SD_JSON_BUILD_PAIR_CONDITION(ses && ses->tty, "TTY",
+							   SD_JSON_BUILD_STRING(ses ? ses->tty : NULL)),
+			      SD_JSON_BUILD_PAIR_CONDITION(ses && ses->rhost, "RemoteHost",
+							   SD_JSON_BUILD_STRING(ses ? ses->rhost : NULL)),
+			      SD_JSON_BUILD_PAIR_CONDITION(ses && ses->service, "Service",
+							   SD_JSON_BUILD_STRING(ses ? ses->service : NULL)));
+      if (r < 0)
+	{
+	  /* most likely the client does not read fast enough, drop it */
+	  struct subscriber *failed = *sub;
+
+	  log_msg (LOG_WARNING, "Failed to notify subscriber, disconnecting: %s",
+		   strerror (-r));
+	  *sub = failed->next;
+	  failed->link = sd_varlink_close_unref (failed->link);
+	  subscriber_free (failed);
+	  continue;
+	}
+
+      sub = &(*sub)->next;
+    }
+}
+
+static int
+vl_method_subscribe(sd_varlink *link, sd_json_variant *parameters,
+		    sd_varlink_method_flags_t flags,
+		    void _unused_(*userdata))
+{
+  _cleanup_(subscriber_freep) struct subscriber *sub = NULL;
+  static const sd_json_dispatch_field dispatch_table[] = {
+    { "User",    SD_JSON_VARIANT_STRING,  sd_json_dispatch_string, offsetof(struct subscriber, user),    0 },
+    { "Service", SD_JSON_VARIANT_STRING,  sd_json_dispatch_string, offsetof(struct subscriber, service), 0 },
+    { "Type",    SD_JSON_VARIANT_INTEGER, sd_json_dispatch_int,    offsetof(struct subscriber, type),    0 },
+    {}
+  };
+  int r;
+
+  log_msg (LOG_INFO, "Varlink method \"Subscribe\" called...");
+
+  sub = calloc (1, sizeof (struct subscriber));
+  if (sub == NULL)
+    return -ENOMEM;
+  sub->type = -1;
+
+  r = sd_varlink_dispatch(link, parameters, dispatch_table, sub);
+  if (r != 0)
+    {
+      log_msg(LOG_ERR, "Subscribe request: varlink dispatch failed: %s", strerror (-r));
+      return r;
+    }
+
+  if (!(flags & SD_VARLINK_METHOD_MORE))
+    return reply_error (sd_varlink_error(link, SD_VARLINK_ERROR_EXPECTED_MORE, NULL));
+
+  /* We never reply, the link stays open until the client disconnects */
+  sub->link = sd_varlink_ref (link);
+  sub->next = subscribers;
+  subscribers = TAKE_PTR(sub);
+
+  return 0;
+}
+
 static int
 vl_method_login(sd_varlink *link, sd_json_variant *parameters,
 		sd_varlink_method_flags_t _unused_(flags),
@@ -226,94 +594,767 @@ vl_method_login(sd_varlink *link, sd_json_variant *parameters,
   r = sd_varlink_dispatch(link, parameters, dispatch_table, &p);
   if (r != 0)
     {
-      log_msg(LOG_ERR, "Login method: varlink dispatch failed: %s", strerror (-r));
+      log_msg(LOG_ERR, "Login method: varlink dispatch failed: %s", strerror (-r));
+      return r;
+    }
+
+  log_msg(LOG_DEBUG, "Requested login record: %i, %s, %li, %s, %s, %s",
+	  p.type, p.user, p.usec_login, p.tty, p.rhost, p.service);
+
+  uid_t peer_uid;
+  r = sd_varlink_get_peer_uid(link, &peer_uid);
+  if (r < 0)
+    {
+      log_msg(LOG_ERR, "Failed to get peer UID: %s", strerror(-r));
+      return r;
+    }
+  if (peer_uid != 0)
+    {
+      log_msg(LOG_WARNING, "Login: peer UID %i denied", peer_uid);
+      return reply_error (sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, parameters));
+    }
+
+  id = wtmpdb_login (_PATH_WTMPDB, p.type, p.user, p.usec_login, p.tty, p.rhost, p.service, &error);
+  if (id < 0 || error != NULL)
+    {
+      log_msg(LOG_ERR, "Get ID request from db failed: %s", error);
+      return reply_error (sd_varlink_errorbo(link, id == -EBUSY ?
+					     "org.openSUSE.wtmpdb.DatabaseBusy" :
+					     "org.openSUSE.wtmpdb.InternalError",
+					     SD_JSON_BUILD_PAIR_STRING("ErrorMsg", error)));
+    }
+
+  r = sd_varlink_replybo(link, SD_JSON_BUILD_PAIR_INTEGER("ID", id));
+
+  const struct session ses = {
+    .id = id,
+    .type = p.type,
+    .user = p.user,
+    .usec_login = p.usec_login,
+    .tty = p.tty,
+    .rhost = p.rhost,
+    .service = p.service,
+  };
+  notify_subscribers (p.type == BOOT_TIME ? "Boot" : "Login", id, &ses, 0);
+
+  return r;
+}
+
+static int
+vl_method_logout(sd_varlink *link, sd_json_variant *parameters,
+		 sd_varlink_method_flags_t _unused_(flags),
+		 void _unused_(*userdata))
+{
+  struct p {
+    int64_t id;
+    uint64_t usec_logout;
+  } p = {
+    .id = -1,
+    .usec_logout = 0,
+  };
+  static const sd_json_dispatch_field dispatch_table[] = {
+    { "ID",         SD_JSON_VARIANT_INTEGER, sd_json_dispatch_int64, offsetof(struct p, id),           SD_JSON_MANDATORY },
+    { "LogoutTime", SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64, offsetof(struct p, usec_logout), SD_JSON_MANDATORY },
+    {}
+  };
+  _cleanup_(freep) char *error = NULL;
+  int64_t id = -1;
+  int r;
+
+  log_msg (LOG_INFO, "Varlink method \"Logout\" called...");
+
+  r = sd_varlink_dispatch(link, parameters, dispatch_table, &p);
+  if (r != 0)
+    {
+      log_msg(LOG_ERR, "Logout request: varlink dispatch failed: %s", strerror (-r));
+      return r;
+    }
+
+  log_msg(LOG_DEBUG, "Logout for entry '%li' at time '%lu' requested", p.id, p.usec_logout);
+
+  uid_t peer_uid;
+  r = sd_varlink_get_peer_uid(link, &peer_uid);
+  if (r < 0)
+    {
+      log_msg(LOG_ERR, "Failed to get peer UID: %s", strerror(-r));
+      return r;
+    }
+  if (peer_uid != 0)
+    {
+      log_msg(LOG_WARNING, "Logout: peer UID %i denied", peer_uid);
+      return reply_error (sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, parameters));
+    }
+
+  id = wtmpdb_logout (_PATH_WTMPDB, p.id, p.usec_logout, &error);
+  if (id < 0 || error != NULL)
+    {
+      /* let wtmpdb_logout return better error codes, e.g. not found vs real error */
+      log_msg(LOG_ERR, "Logout request from db failed: %s", error);
+      return reply_error (sd_varlink_errorbo(link, id == -EBUSY ?
+					     "org.openSUSE.wtmpdb.DatabaseBusy" :
+					     "org.openSUSE.wtmpdb.InternalError",
+					     SD_JSON_BUILD_PAIR_BOOLEAN("Success", false),
+					     SD_JSON_BUILD_PAIR_STRING("ErrorMsg", error)));
+
+    }
+
+  r = sd_varlink_replybo(link, SD_JSON_BUILD_PAIR_BOOLEAN("Success", true));
+
+  _cleanup_(session_free) struct session ses = { .id = -1 };
+  const struct session *found = session_lookup (p.id, &ses);
+  notify_subscribers ((found && found->type == BOOT_TIME) ? "Shutdown" : "Logout",
+		      p.id, found, p.usec_logout);
+
+  return r;
+}
+
+/* Read-only requests (ReadAll, Report, GetID, GetBootTime) are executed by a
+   pool of worker threads, each with its own read-only database
+   connection. Writes stay serialized on the event loop thread.
+   Finished jobs are handed back to the event loop via an eventfd,
+   which sends the reply. */
+
+#define DEFAULT_WORKER_THREADS 4
+
+enum job_type {
+  JOB_READ_ALL,
+  JOB_REPORT,
+  JOB_CONCURRENCY,
+  JOB_GET_ID,
+  JOB_GET_BOOTTIME,
+  JOB_ROTATE,
+};
+
+struct job {
+  enum job_type type;
+  sd_varlink *link;
+  uint64_t start_usec;
+  char *tty;
+  int days;
+  int64_t after_id;
+  int current;
+  int page;
+  uint64_t before_login;
+  int64_t before_id;
+  uint64_t present;
+  int overlap;
+  int group_by;
+  uint64_t since;
+  uint64_t until;
+  uint64_t bucket;
+  unsigned int limit;
+  /* results */
+  int r;
+  int64_t id;
+  uint64_t boottime;
+  sd_json_variant *array;
+  uint64_t payload_bytes;
+  int incomplete;
+  char *backup;
+  uint64_t entries;
+  char *error;
+  struct job *next;
+};
+
+static struct job *
+job_free (struct job *j)
+{
+  if (j == NULL)
+    return NULL;
+
+  sd_varlink_unref (j->link);
+  sd_json_variant_unref (j->array);
+  free (j->tty);
+  free (j->backup);
+  free (j->error);
+  free (j);
+
+  return NULL;
+}
+
+static void
+job_freep (struct job **j)
+{
+  *j = job_free (*j);
+}
+
+static struct job *
+job_new (enum job_type type, sd_varlink *link)
+{
+  struct job *j = calloc (1, sizeof (struct job));
+
+  if (j == NULL)
+    return NULL;
+
+  j->type = type;
+  j->link = sd_varlink_ref (link);
+  j->start_usec = now_usec ();
+
+  return j;
+}
+
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  struct job *queue_head;
+  struct job *queue_tail;
+  struct job *done_head;
+  struct job *done_tail;
+  int event_fd;
+  sd_event_source *event_source;
+  bool stop;
+  size_t n_threads;
+  pthread_t *threads;
+} pool = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .cond = PTHREAD_COND_INITIALIZER,
+  .event_fd = -1,
+  .n_threads = DEFAULT_WORKER_THREADS,
+};
+
+static int
+wtmpdb_cb_func (void *u, int argc, char **argv, char _unused_(**azColName))
+{
+  struct job *j = u;
+  char *endptr;
+  uint64_t logout_t = 0;
+  int r;
+
+  log_msg(LOG_DEBUG, "wtmpdb_cb_func called for ID %s", argv[0]);
+
+  if (argc != 8)
+    {
+      log_msg(LOG_ERR, "Invalid number of arguments: got %i, expected 8", argc);
+      j->incomplete = 1;
+      return 0;
+    }
+
+  const int id = atoi (argv[0]);
+  const int type = atoi (argv[1]);
+  const char *user = argv[2];
+  const char *tty = argv[5]?argv[5]:"?";
+  const char *host = argv[6]?argv[6]:"";
+  const char *service = argv[7]?argv[7]:"";
+  uint64_t login_t = strtoull(argv[3], &endptr, 10);
+  if ((errno == ERANGE && login_t == ULLONG_MAX)
+      || (endptr == argv[3]) || (*endptr != '\0'))
+    {
+      log_msg(LOG_ERR, "Invalid numeric time entry for 'login': '%s'\n", argv[3]);
+      j->incomplete = 1;
+      return 0;
+    }
+  if (argv[4])
+    {
+      logout_t = strtoull(argv[4], &endptr, 10);
+      if ((errno == ERANGE && logout_t == ULLONG_MAX)
+          || (endptr == argv[4]) || (*endptr != '\0'))
+	{
+	  log_msg(LOG_ERR, "Invalid numeric time entry for 'logout': '%s'\n", argv[4]);
+	  j->incomplete = 1;
+	  return 0;
+	}
+    }
+
+  log_msg(LOG_DEBUG, "ID: %i, Type: %i, User: %s, Login: %lu, Logout: %lu, TTY: %s, RemoteHost: %s, Service: %s",
+	  id, type, user, login_t, logout_t, tty, host, service);
+
+  r = sd_json_variant_append_arraybo(&j->array,
+				     SD_JSON_BUILD_PAIR_INTEGER("ID", id),
+				     SD_JSON_BUILD_PAIR_INTEGER("Type", type),
+				     SD_JSON_BUILD_PAIR_STRING("User", user),
+				     SD_JSON_BUILD_PAIR_INTEGER("Login", login_t),
+				     SD_JSON_BUILD_PAIR_INTEGER("Logout", logout_t),
+				     SD_JSON_BUILD_PAIR_STRING("TTY", tty),
+				     SD_JSON_BUILD_PAIR_STRING("RemoteHost", host),
+				     SD_JSON_BUILD_PAIR_STRING("Service", service));
+  if (r < 0)
+    {
+      log_msg(LOG_ERR, "Appending array failed: %s", strerror(-r));
+      j->incomplete = 1;
+    }
+
+  /* Only the payload, not the JSON encoding */
+  for (int i = 0; i < argc; i++)
+    if (argv[i])
+      j->payload_bytes += strlen (argv[i]);
+
+  return 0;
+}
+
+/* Rotation runs in its own thread, the state is shared with the
+   RotateStatus method. thread and joinable are only used by the
+   main thread. */
+static struct {
+  pthread_mutex_t lock;
+  pthread_t thread;
+  bool joinable;
+  bool running;
+  const char *phase;
+  int days;
+  uint64_t moved;
+  uint64_t total;
+  uint64_t start_usec;
+  uint64_t end_usec;
+  char *backup;
+  char *error;
+} rotation = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .phase = "idle",
+};
+
+static int
+rotate_progress (void _unused_(*userdata), uint64_t moved, uint64_t total)
+{
+  pthread_mutex_lock (&rotation.lock);
+  rotation.phase = "moving";
+  rotation.moved = moved;
+  rotation.total = total;
+  pthread_mutex_unlock (&rotation.lock);
+
+  log_msg (LOG_DEBUG, "Rotate: %lu of %lu entries moved", moved, total);
+
+  return 0;
+}
+
+static int
+report_cb_func (void *u, int argc, char **argv, char _unused_(**azColName))
+{
+  struct job *j = u;
+  int r;
+
+  /* Key, Sessions, Seconds, Users, Hosts */
+  if (argc != 5)
+    {
+      log_msg(LOG_ERR, "Invalid number of arguments: got %i, expected 5", argc);
+      j->incomplete = 1;
+      return 0;
+    }
+
+  r = sd_json_variant_append_arraybo(&j->array,
+				     SD_JSON_BUILD_PAIR_STRING("Key", argv[0]?argv[0]:""),
+				     SD_JSON_BUILD_PAIR_UNSIGNED("Sessions", strtoull (argv[1]?argv[1]:"0", NULL, 10)),
+				     SD_JSON_BUILD_PAIR_UNSIGNED("Seconds", strtoull (argv[2]?argv[2]:"0", NULL, 10)),
+				     SD_JSON_BUILD_PAIR_UNSIGNED("Users", strtoull (argv[3]?argv[3]:"0", NULL, 10)),
+				     SD_JSON_BUILD_PAIR_UNSIGNED("Hosts", strtoull (argv[4]?argv[4]:"0", NULL, 10)));
+  if (r < 0)
+    {
+      log_msg(LOG_ERR, "Appending array failed: %s", strerror(-r));
+      j->incomplete = 1;
+    }
+
+  for (int i = 0; i < argc; i++)
+    if (argv[i])
+      j->payload_bytes += strlen (argv[i]);
+
+  return 0;
+}
+
+static int
+concurrency_cb_func (void *u, int argc, char **argv, char _unused_(**azColName))
+{
+  struct job *j = u;
+  int r;
+
+  /* Start, Peak, Sessions */
+  if (argc != 3)
+    {
+      log_msg(LOG_ERR, "Invalid number of arguments: got %i, expected 3", argc);
+      j->incomplete = 1;
+      return 0;
+    }
+
+  r = sd_json_variant_append_arraybo(&j->array,
+				     SD_JSON_BUILD_PAIR_UNSIGNED("Start", strtoull (argv[0], NULL, 10)),
+				     SD_JSON_BUILD_PAIR_UNSIGNED("Peak", strtoull (argv[1], NULL, 10)),
+				     SD_JSON_BUILD_PAIR_UNSIGNED("Sessions", strtoull (argv[2], NULL, 10)));
+  if (r < 0)
+    {
+      log_msg(LOG_ERR, "Appending array failed: %s", strerror(-r));
+      j->incomplete = 1;
+      return 1;
+    }
+
+  for (int i = 0; i < argc; i++)
+    j->payload_bytes += strlen (argv[i]);
+
+  return 0;
+}
+
+/* Runs in a worker thread, must not touch the varlink connection. */
+static void
+job_run (struct job *j)
+{
+  switch (j->type)
+    {
+    case JOB_READ_ALL:
+      if (j->current)
+	j->r = wtmpdb_read_current (_PATH_WTMPDB, &wtmpdb_cb_func, j, &j->error);
+      else if (j->overlap)
+	j->r = wtmpdb_read_overlap (_PATH_WTMPDB, j->since, j->until,
+				    &wtmpdb_cb_func, j, &j->error);
+      else if (j->present)
+	j->r = wtmpdb_read_present (_PATH_WTMPDB, j->present,
+				    &wtmpdb_cb_func, j, &j->error);
+      else if (j->page)
+	j->r = wtmpdb_read_page (_PATH_WTMPDB, j->before_login, j->before_id,
+				 j->limit, &wtmpdb_cb_func, j, &j->error);
+      else if (j->after_id >= 0)
+	j->r = wtmpdb_read_since_id (_PATH_WTMPDB, j->after_id,
+				     &wtmpdb_cb_func, j, &j->error);
+      else
+	j->r = wtmpdb_read_all_v2 (_PATH_WTMPDB, &wtmpdb_cb_func, j, &j->error);
+      break;
+    case JOB_REPORT:
+      j->r = wtmpdb_report (_PATH_WTMPDB, j->group_by, j->since, j->until,
+			    j->limit, &report_cb_func, j, &j->error);
+      break;
+    case JOB_CONCURRENCY:
+      j->r = wtmpdb_concurrency (_PATH_WTMPDB, j->since, j->until, j->bucket,
+				 &concurrency_cb_func, j, &j->error);
+      break;
+    case JOB_GET_ID:
+      j->id = wtmpdb_get_id (_PATH_WTMPDB, j->tty, &j->error);
+      break;
+    case JOB_GET_BOOTTIME:
+      j->boottime = wtmpdb_get_boottime (_PATH_WTMPDB, &j->error);
+      break;
+    case JOB_ROTATE:
+      j->r = wtmpdb_rotate_v2 (_PATH_WTMPDB, j->days, rotate_progress, NULL,
+			       &j->error, &j->backup, &j->entries);
+      pthread_mutex_lock (&rotation.lock);
+      rotation.running = false;
+      rotation.phase = (j->r < 0 || j->error != NULL) ? "failed" : "finished";
+      rotation.moved = j->entries;
+      rotation.end_usec = now_usec ();
+      free (rotation.backup);
+      rotation.backup = j->backup ? strdup (j->backup) : NULL;
+      free (rotation.error);
+      rotation.error = j->error ? strdup (j->error) : NULL;
+      pthread_mutex_unlock (&rotation.lock);
+      break;
+    }
+}
+
+static int
+job_send_reply (struct job *j)
+{
+  switch (j->type)
+    {
+    case JOB_READ_ALL:
+      if (j->r < 0 || j->error != NULL || j->incomplete)
+	{
+	  log_msg(LOG_ERR, "Didn't got all entries from db: %s", j->error);
+	  return reply_error (sd_varlink_errorbo(j->link, "org.openSUSE.wtmpdb.InternalError",
+						 SD_JSON_BUILD_PAIR_BOOLEAN("Success", false),
+						 SD_JSON_BUILD_PAIR_STRING("ErrorMsg", j->error?j->error:"unknown")));
+	}
+      return sd_varlink_replybo(j->link, SD_JSON_BUILD_PAIR_BOOLEAN("Success", true),
+				SD_JSON_BUILD_PAIR_VARIANT("Data", j->array));
+
+    case JOB_REPORT:
+    case JOB_CONCURRENCY:
+      if (j->r < 0 || j->error != NULL || j->incomplete)
+	{
+	  log_msg(LOG_ERR, "%s failed: %s",
+		  j->type == JOB_REPORT ? "Report" : "Concurrency", j->error);
+	  return reply_error (sd_varlink_errorbo(j->link, "org.openSUSE.wtmpdb.InternalError",
+						 SD_JSON_BUILD_PAIR_BOOLEAN("Success", false),
+						 SD_JSON_BUILD_PAIR_STRING("ErrorMsg", j->error?j->error:"unknown")));
+	}
+      /* no sessions in the range is no error */
+      if (j->array == NULL)
+	{
+	  int r = sd_json_variant_new_array (&j->array, NULL, 0);
+	  if (r < 0)
+	    return r;
+	}
+      return sd_varlink_replybo(j->link, SD_JSON_BUILD_PAIR_BOOLEAN("Success", true),
+				SD_JSON_BUILD_PAIR_VARIANT("Data", j->array));
+
+    case JOB_GET_ID:
+      if (j->id < 0 || j->error != NULL)
+	{
+	  log_msg(LOG_ERR, "Get ID request from db failed: %s", j->error);
+	  return reply_error (sd_varlink_errorbo(j->link, "org.openSUSE.wtmpdb.NoEntryFound",
+						 SD_JSON_BUILD_PAIR_STRING("ErrorMsg", j->error)));
+	}
+      return sd_varlink_replybo(j->link, SD_JSON_BUILD_PAIR_INTEGER("ID", j->id));
+
+    case JOB_GET_BOOTTIME:
+      if (j->boottime == 0 || j->error != NULL)
+	{
+	  log_msg(LOG_ERR, "Get boottime from db failed: %s", j->error);
+	  return reply_error (sd_varlink_errorbo(j->link, "org.openSUSE.wtmpdb.NoEntryFound",
+						 SD_JSON_BUILD_PAIR_BOOLEAN("Success", false),
+						 SD_JSON_BUILD_PAIR_STRING("ErrorMsg", j->error)));
+	}
+      return sd_varlink_replybo(j->link, SD_JSON_BUILD_PAIR_BOOLEAN("Success", true),
+				SD_JSON_BUILD_PAIR_INTEGER("BootTime", j->boottime));
+
+    case JOB_ROTATE:
+      if (j->r < 0 || j->error != NULL)
+	{
+	  log_msg(LOG_ERR, "Rotate db failed: %s", j->error);
+	  if (j->link == NULL) /* running in background */
+	    return 0;
+	  return reply_error (sd_varlink_errorbo(j->link, "org.openSUSE.wtmpdb.NoEntryFound",
+						 SD_JSON_BUILD_PAIR_BOOLEAN("Success", false),
+						 SD_JSON_BUILD_PAIR_STRING("ErrorMsg", j->error)));
+	}
+      log_msg(LOG_INFO, "Rotate: %lu entries moved to %s", j->entries,
+	      j->backup?j->backup:"-");
+      if (j->link == NULL)
+	return 0;
+      return sd_varlink_replybo(j->link, SD_JSON_BUILD_PAIR_BOOLEAN("Success", true),
+				SD_JSON_BUILD_PAIR_CONDITION(j->backup != NULL, "BackupName",
+							     SD_JSON_BUILD_STRING(j->backup)),
+				SD_JSON_BUILD_PAIR_INTEGER("Entries", j->entries));
+    }
+
+  return -EINVAL;
+}
+
+/* Runs in the event loop thread. */
+static int
+job_reply (struct job *j)
+{
+  static const enum method job_method[] = {
+    [JOB_READ_ALL]     = METHOD_READ_ALL,
+    [JOB_REPORT]       = METHOD_REPORT,
+    [JOB_CONCURRENCY]  = METHOD_CONCURRENCY,
+    [JOB_GET_ID]       = METHOD_GET_ID,
+    [JOB_GET_BOOTTIME] = METHOD_GET_BOOTTIME,
+    [JOB_ROTATE]       = METHOD_ROTATE,
+  };
+  int r;
+
+  call_failed = false;
+  r = job_send_reply (j);
+
+  /* A rotation in background was already answered */
+  if (j->link != NULL)
+    stats_record (job_method[j->type], j->start_usec, r,
+		  (r >= 0 && j->array) ? sd_json_variant_elements (j->array) : 0,
+		  r >= 0 ? j->payload_bytes : 0);
+
+  return r;
+}
+
+/* Hands a finished job back to the event loop. */
+static void
+job_done (struct job *j)
+{
+  uint64_t one = 1;
+
+  pthread_mutex_lock (&pool.lock);
+  if (pool.done_tail)
+    pool.done_tail->next = j;
+  else
+    pool.done_head = j;
+  pool.done_tail = j;
+  pthread_mutex_unlock (&pool.lock);
+
+  if (write (pool.event_fd, &one, sizeof (one)) < 0 && errno != EAGAIN)
+    log_msg (LOG_ERR, "Failed to wake up event loop: %s", strerror (errno));
+}
+
+static void *
+worker_thread (void _unused_(*arg))
+{
+  /* one read-only connection per thread for all its jobs */
+  wtmpdb_reuse_connection (1);
+
+  for (;;)
+    {
+      struct job *j;
+
+      pthread_mutex_lock (&pool.lock);
+      while (!pool.stop && pool.queue_head == NULL)
+	pthread_cond_wait (&pool.cond, &pool.lock);
+      if (pool.stop)
+	{
+	  pthread_mutex_unlock (&pool.lock);
+	  break;
+	}
+      j = pool.queue_head;
+      pool.queue_head = j->next;
+      if (pool.queue_head == NULL)
+	pool.queue_tail = NULL;
+      pthread_mutex_unlock (&pool.lock);
+
+      j->next = NULL;
+      job_run (j);
+      job_done (j);
+    }
+
+  wtmpdb_reuse_connection (0);
+
+  return NULL;
+}
+
+static void *
+rotate_thread (void *arg)
+{
+  struct job *j = arg;
+
+  job_run (j);
+  job_done (j);
+
+  return NULL;
+}
+
+static int
+pool_event_handler (sd_event_source _unused_(*s), int fd,
+		    uint32_t _unused_(revents), void _unused_(*userdata))
+{
+  struct job *done;
+  uint64_t n;
+  int r;
+
+  if (read (fd, &n, sizeof (n)) < 0 && errno != EAGAIN)
+    log_msg (LOG_ERR, "Failed to read from eventfd: %s", strerror (errno));
+
+  pthread_mutex_lock (&pool.lock);
+  done = pool.done_head;
+  pool.done_head = pool.done_tail = NULL;
+  pthread_mutex_unlock (&pool.lock);
+
+  while (done)
+    {
+      struct job *next = done->next;
+
+      r = job_reply (done);
+      if (r < 0)
+	log_msg (LOG_ERR, "Failed to send reply: %s", strerror (-r));
+      job_free (done);
+      done = next;
+    }
+
+  return 0;
+}
+
+/* Takes over the job. Without worker threads the job is
+   executed and answered immediately. */
+static int
+pool_submit (struct job *j)
+{
+  call_deferred = true;
+
+  if (pool.n_threads == 0)
+    {
+      int r;
+
+      job_run (j);
+      r = job_reply (j);
+      if (r < 0)
+	log_msg (LOG_ERR, "Failed to send reply: %s", strerror (-r));
+      job_free (j);
+      return 0;
+    }
+
+  pthread_mutex_lock (&pool.lock);
+  if (pool.queue_tail)
+    pool.queue_tail->next = j;
+  else
+    pool.queue_head = j;
+  pool.queue_tail = j;
+  pthread_cond_signal (&pool.cond);
+  pthread_mutex_unlock (&pool.lock);
+
+  return 0;
+}
+
+static int
+pool_start (sd_event *event)
+{
+  int r;
+
+  pool.event_fd = eventfd (0, EFD_CLOEXEC|EFD_NONBLOCK);
+  if (pool.event_fd < 0)
+    {
+      r = -errno;
+      log_msg (LOG_ERR, "Failed to create eventfd: %s", strerror (-r));
       return r;
     }
 
-  log_msg(LOG_DEBUG, "Requested login record: %i, %s, %li, %s, %s, %s",
-	  p.type, p.user, p.usec_login, p.tty, p.rhost, p.service);
-
-  uid_t peer_uid;
-  r = sd_varlink_get_peer_uid(link, &peer_uid);
+  r = sd_event_add_io (event, &pool.event_source, pool.event_fd, EPOLLIN,
+		       pool_event_handler, NULL);
   if (r < 0)
     {
-      log_msg(LOG_ERR, "Failed to get peer UID: %s", strerror(-r));
+      log_msg (LOG_ERR, "Failed to add eventfd to event loop: %s",
+	       strerror (-r));
       return r;
     }
-  if (peer_uid != 0)
-    {
-      log_msg(LOG_WARNING, "Login: peer UID %i denied", peer_uid);
-      return sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, parameters);
-    }
 
-  id = wtmpdb_login (_PATH_WTMPDB, p.type, p.user, p.usec_login, p.tty, p.rhost, p.service, &error);
-  if (id < 0 || error != NULL)
+  if (pool.n_threads == 0)
+    return 0;
+
+  pool.threads = calloc (pool.n_threads, sizeof (pthread_t));
+  if (pool.threads == NULL)
+    return -ENOMEM;
+
+  for (size_t i = 0; i < pool.n_threads; i++)
     {
-      log_msg(LOG_ERR, "Get ID request from db failed: %s", error);
-      return sd_varlink_errorbo(link, "org.openSUSE.wtmpdb.InternalError",
-				SD_JSON_BUILD_PAIR_STRING("ErrorMsg", error));
+      r = pthread_create (&pool.threads[i], NULL, worker_thread, NULL);
+      if (r != 0)
+	{
+	  log_msg (LOG_ERR, "Failed to create worker thread: %s",
+		   strerror (r));
+	  pool.n_threads = i;
+	  return -r;
+	}
     }
 
-  return sd_varlink_replybo(link, SD_JSON_BUILD_PAIR_INTEGER("ID", id));
+  log_msg (LOG_DEBUG, "Started %zu worker threads", pool.n_threads);
+
+  return 0;
 }
 
-static int
-vl_method_logout(sd_varlink *link, sd_json_variant *parameters,
-		 sd_varlink_method_flags_t _unused_(flags),
-		 void _unused_(*userdata))
+static void
+pool_stop (void)
 {
-  struct p {
-    int64_t id;
-    uint64_t usec_logout;
-  } p = {
-    .id = -1,
-    .usec_logout = 0,
-  };
-  static const sd_json_dispatch_field dispatch_table[] = {
-    { "ID",         SD_JSON_VARIANT_INTEGER, sd_json_dispatch_int64, offsetof(struct p, id),           SD_JSON_MANDATORY },
-    { "LogoutTime", SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64, offsetof(struct p, usec_logout), SD_JSON_MANDATORY },
-    {}
-  };
-  _cleanup_(freep) char *error = NULL;
-  int64_t id = -1;
-  int r;
-
-  log_msg (LOG_INFO, "Varlink method \"Logout\" called...");
-
-  r = sd_varlink_dispatch(link, parameters, dispatch_table, &p);
-  if (r != 0)
+  /* The rotate thread uses the done list and the eventfd until
+     it returns. */
+  if (rotation.joinable)
     {
-      log_msg(LOG_ERR, "Logout request: varlink dispatch failed: %s", strerror (-r));
-      return r;
+      pthread_mutex_lock (&rotation.lock);
+      if (rotation.running)
+	log_msg (LOG_WARNING, "Rotation still running, waiting for it...");
+      pthread_mutex_unlock (&rotation.lock);
+      pthread_join (rotation.thread, NULL);
+      rotation.joinable = false;
     }
 
-  log_msg(LOG_DEBUG, "Logout for entry '%li' at time '%lu' requested", p.id, p.usec_logout);
+  pthread_mutex_lock (&pool.lock);
+  pool.stop = true;
+  pthread_cond_broadcast (&pool.cond);
+  pthread_mutex_unlock (&pool.lock);
 
-  uid_t peer_uid;
-  r = sd_varlink_get_peer_uid(link, &peer_uid);
-  if (r < 0)
+  for (size_t i = 0; pool.threads && i < pool.n_threads; i++)
+    pthread_join (pool.threads[i], NULL);
+  pool.threads = mfree (pool.threads);
+
+  /* drop unanswered jobs, the clients are gone anyway */
+  while (pool.queue_head)
     {
-      log_msg(LOG_ERR, "Failed to get peer UID: %s", strerror(-r));
-      return r;
+      struct job *next = pool.queue_head->next;
+      job_free (pool.queue_head);
+      pool.queue_head = next;
     }
-  if (peer_uid != 0)
+  while (pool.done_head)
     {
-      log_msg(LOG_WARNING, "Logout: peer UID %i denied", peer_uid);
-      return sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, parameters);
+      struct job *next = pool.done_head->next;
+      job_free (pool.done_head);
+      pool.done_head = next;
     }
+  pool.queue_tail = pool.done_tail = NULL;
 
-  id = wtmpdb_logout (_PATH_WTMPDB, p.id, p.usec_logout, &error);
-  if (id < 0 || error != NULL)
+  pool.event_source = sd_event_source_disable_unref (pool.event_source);
+  if (pool.event_fd >= 0)
     {
-      /* let wtmpdb_logout return better error codes, e.g. not found vs real error */
-      log_msg(LOG_ERR, "Logout request from db failed: %s", error);
-      return sd_varlink_errorbo(link, "org.openSUSE.wtmpdb.InternalError",
-				SD_JSON_BUILD_PAIR_BOOLEAN("Success", false),
-                                SD_JSON_BUILD_PAIR_STRING("ErrorMsg", error));
-
+      close (pool.event_fd);
+      pool.event_fd = -1;
     }
-
-  return sd_varlink_replybo(link, SD_JSON_BUILD_PAIR_BOOLEAN("Success", true));
 }
 
 struct get_id {
@@ -326,6 +1367,19 @@ get_id_free (struct get_id *var)
   var->tty = mfree(var->tty);
 }
 
+struct report_params {
+  char *group_by;
+  uint64_t since;
+  uint64_t until;
+  unsigned int limit;
+};
+
+static void
+report_params_free (struct report_params *var)
+{
+  var->group_by = mfree(var->group_by);
+}
+
 static int
 vl_method_get_id(sd_varlink *link, sd_json_variant *parameters,
 		 sd_varlink_method_flags_t _unused_(flags),
@@ -338,8 +1392,7 @@ vl_method_get_id(sd_varlink *link, sd_json_variant *parameters,
     { "TTY", SD_JSON_VARIANT_STRING, sd_json_dispatch_string, offsetof(struct get_id, tty), SD_JSON_MANDATORY },
     {}
   };
-  _cleanup_(freep) char *error = NULL;
-  int64_t id = -1;
+  _cleanup_(job_freep) struct job *j = NULL;
   int r;
 
   log_msg (LOG_INFO, "Varlink method \"GetID\" called...");
@@ -353,16 +1406,12 @@ vl_method_get_id(sd_varlink *link, sd_json_variant *parameters,
 
   log_msg(LOG_DEBUG, "ID for entry on tty '%s' requested", p.tty);
 
-  id = wtmpdb_get_id (_PATH_WTMPDB, p.tty, &error);
-  if (id < 0 || error != NULL)
-    {
-      log_msg(LOG_ERR, "Get ID request from db failed: %s", error);
-      return sd_varlink_errorbo(link, "org.openSUSE.wtmpdb.NoEntryFound",
-                                SD_JSON_BUILD_PAIR_STRING("ErrorMsg", error));
-
-    }
+  j = job_new (JOB_GET_ID, link);
+  if (j == NULL)
+    return -ENOMEM;
+  j->tty = TAKE_PTR(p.tty);
 
-  return sd_varlink_replybo(link, SD_JSON_BUILD_PAIR_INTEGER("ID", id));
+  return pool_submit (TAKE_PTR(j));
 }
 
 static int
@@ -373,8 +1422,7 @@ vl_method_get_boottime(sd_varlink *link, sd_json_variant *parameters,
   static const sd_json_dispatch_field dispatch_table[] = {
     {}
   };
-  _cleanup_(freep) char *error = NULL;
-  uint64_t boottime = 0;
+  struct job *j;
   int r;
 
   log_msg (LOG_INFO, "Varlink method \"GetBootTime\" called...");
@@ -386,122 +1434,171 @@ vl_method_get_boottime(sd_varlink *link, sd_json_variant *parameters,
       return r;
     }
 
-  boottime = wtmpdb_get_boottime (_PATH_WTMPDB, &error);
-  if (boottime == 0 || error != NULL)
-    {
-      log_msg(LOG_ERR, "Get boottime from db failed: %s", error);
-      return sd_varlink_errorbo(link, "org.openSUSE.wtmpdb.NoEntryFound",
-				SD_JSON_BUILD_PAIR_BOOLEAN("Success", false),
-                                SD_JSON_BUILD_PAIR_STRING("ErrorMsg", error));
-
-    }
+  j = job_new (JOB_GET_BOOTTIME, link);
+  if (j == NULL)
+    return -ENOMEM;
 
-  return sd_varlink_replybo(link, SD_JSON_BUILD_PAIR_BOOLEAN("Success", true),
-			    SD_JSON_BUILD_PAIR_INTEGER("BootTime", boottime));
+  return pool_submit (j);
 }
 
-static int incomplete = 0;
-
 static int
-wtmpdb_cb_func (void *u, int argc, char **argv, char _unused_(**azColName))
+vl_method_read_all(sd_varlink *link, sd_json_variant *parameters,
+		   sd_varlink_method_flags_t _unused_(flags),
+		   void _unused_(*userdata))
 {
-  sd_json_variant **array = u;
-  char *endptr;
-  uint64_t logout_t = 0;
+  struct p {
+    int64_t after_id;
+    bool current;
+    int64_t limit;
+    uint64_t before_login;
+    int64_t before_id;
+    uint64_t present;
+    uint64_t since;
+    uint64_t until;
+  } p = {
+    .after_id = -1,
+    .current = false,
+    .limit = -1,
+    .before_login = 0,
+    .before_id = 0,
+    .present = 0,
+    .since = UINT64_MAX,
+    .until = 0,
+  };
+  static const sd_json_dispatch_field dispatch_table[] = {
+    { "AfterID",     SD_JSON_VARIANT_INTEGER, sd_json_dispatch_int64,   offsetof(struct p, after_id),     0 },
+    { "Current",     SD_JSON_VARIANT_BOOLEAN, sd_json_dispatch_stdbool, offsetof(struct p, current),      0 },
+    { "Limit",       SD_JSON_VARIANT_INTEGER, sd_json_dispatch_int64,   offsetof(struct p, limit),        0 },
+    { "BeforeLogin", SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64,  offsetof(struct p, before_login), 0 },
+    { "BeforeID",    SD_JSON_VARIANT_INTEGER, sd_json_dispatch_int64,   offsetof(struct p, before_id),    0 },
+    { "Present",     SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64,  offsetof(struct p, present),      0 },
+    { "Since",       SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64,  offsetof(struct p, since),        0 },
+    { "Until",       SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64,  offsetof(struct p, until),        0 },
+    {}
+  };
+  struct job *j;
   int r;
 
-  log_msg(LOG_DEBUG, "wtmpdb_cb_func called for ID %s", argv[0]);
+  log_msg (LOG_INFO, "Varlink method \"ReadAll\" called...");
 
-  if (argc != 8)
+  r = sd_varlink_dispatch(link, parameters, dispatch_table, &p);
+  if (r != 0)
     {
-      log_msg(LOG_ERR, "Invalid number of arguments: got %i, expected 8", argc);
-      incomplete = 1;
-      return 0;
+      log_msg(LOG_ERR, "Get all entries request: varlink dispatch failed: %s", strerror (-r));
+      return r;
     }
 
-  const int id = atoi (argv[0]);
-  const int type = atoi (argv[1]);
-  const char *user = argv[2];
-  const char *tty = argv[5]?argv[5]:"?";
-  const char *host = argv[6]?argv[6]:"";
-  const char *service = argv[7]?argv[7]:"";
-  uint64_t login_t = strtoull(argv[3], &endptr, 10);
-  if ((errno == ERANGE && login_t == ULLONG_MAX)
-      || (endptr == argv[3]) || (*endptr != '\0'))
-    {
-      log_msg(LOG_ERR, "Invalid numeric time entry for 'login': '%s'\n", argv[3]);
-      incomplete = 1;
-      return 0;
-    }
-  if (argv[4])
-    {
-      logout_t = strtoull(argv[4], &endptr, 10);
-      if ((errno == ERANGE && logout_t == ULLONG_MAX)
-          || (endptr == argv[4]) || (*endptr != '\0'))
-	{
-	  log_msg(LOG_ERR, "Invalid numeric time entry for 'logout': '%s'\n", argv[4]);
-	  incomplete = 1;
-	  return 0;
-	}
-    }
+  j = job_new (JOB_READ_ALL, link);
+  if (j == NULL)
+    return -ENOMEM;
+  j->after_id = p.after_id;
+  j->current = p.current;
+  j->page = p.limit >= 0 || p.before_id > 0;
+  j->limit = p.limit > 0 && p.limit <= UINT_MAX ? (unsigned int) p.limit : 0;
+  j->before_login = p.before_login;
+  j->before_id = p.before_id;
+  j->present = p.present;
+  j->overlap = p.since != UINT64_MAX;
+  j->since = j->overlap ? p.since : 0;
+  j->until = p.until;
+
+  return pool_submit (j);
+}
 
-  log_msg(LOG_DEBUG, "ID: %i, Type: %i, User: %s, Login: %lu, Logout: %lu, TTY: %s, RemoteHost: %s, Service: %s",
-	  id, type, user, login_t, logout_t, tty, host, service);
+static int
+vl_method_report(sd_varlink *link, sd_json_variant *parameters,
+		 sd_varlink_method_flags_t _unused_(flags),
+		 void _unused_(*userdata))
+{
+  /* index is WTMPDB_REPORT_* */
+  static const char *const groups[] = {"user", "host", "service", "tty",
+				       "day", "hour"};
+  _cleanup_(report_params_free) struct report_params p = {
+    .group_by = NULL,
+    .since = 0,
+    .until = 0,
+    .limit = 0,
+  };
+  static const sd_json_dispatch_field dispatch_table[] = {
+    { "GroupBy", SD_JSON_VARIANT_STRING,  sd_json_dispatch_string, offsetof(struct report_params, group_by), SD_JSON_MANDATORY },
+    { "Since",   SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64, offsetof(struct report_params, since),    0 },
+    { "Until",   SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64, offsetof(struct report_params, until),    0 },
+    { "Limit",   SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint,   offsetof(struct report_params, limit),    0 },
+    {}
+  };
+  struct job *j;
+  int group = -1;
+  int r;
 
-  r = sd_json_variant_append_arraybo(array,
-				     SD_JSON_BUILD_PAIR_INTEGER("ID", id),
-				     SD_JSON_BUILD_PAIR_INTEGER("Type", type),
-				     SD_JSON_BUILD_PAIR_STRING("User", user),
-				     SD_JSON_BUILD_PAIR_INTEGER("Login", login_t),
-				     SD_JSON_BUILD_PAIR_INTEGER("Logout", logout_t),
-				     SD_JSON_BUILD_PAIR_STRING("TTY", tty),
-				     SD_JSON_BUILD_PAIR_STRING("RemoteHost", host),
-				     SD_JSON_BUILD_PAIR_STRING("Service", service));
-  if (r < 0)
+  log_msg (LOG_INFO, "Varlink method \"Report\" called...");
+
+  r = sd_varlink_dispatch(link, parameters, dispatch_table, &p);
+  if (r != 0)
     {
-      log_msg(LOG_ERR, "Appending array failed: %s", strerror(-r));
-      incomplete = 1;
+      log_msg(LOG_ERR, "Report request: varlink dispatch failed: %s", strerror (-r));
+      return r;
     }
 
-  return 0;
+  for (size_t i = 0; i < sizeof (groups)/sizeof (groups[0]); i++)
+    if (strcmp (p.group_by, groups[i]) == 0)
+      group = i;
+  if (group < 0)
+    return reply_error (sd_varlink_error_invalid_parameter_name(link, "GroupBy"));
+
+  j = job_new (JOB_REPORT, link);
+  if (j == NULL)
+    return -ENOMEM;
+  j->group_by = group;
+  j->since = p.since;
+  j->until = p.until;
+  j->limit = p.limit;
+
+  return pool_submit (j);
 }
 
-
-
 static int
-vl_method_read_all(sd_varlink *link, sd_json_variant *parameters,
-		   sd_varlink_method_flags_t _unused_(flags),
-		   void _unused_(*userdata))
+vl_method_concurrency(sd_varlink *link, sd_json_variant *parameters,
+		      sd_varlink_method_flags_t _unused_(flags),
+		      void _unused_(*userdata))
 {
-  _cleanup_(sd_json_variant_unrefp) sd_json_variant *array = NULL;
+  struct p {
+    uint64_t bucket;
+    uint64_t since;
+    uint64_t until;
+  } p = {
+    .bucket = 0,
+    .since = 0,
+    .until = 0,
+  };
   static const sd_json_dispatch_field dispatch_table[] = {
+    { "Bucket", SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64, offsetof(struct p, bucket), SD_JSON_MANDATORY },
+    { "Since",  SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64, offsetof(struct p, since),  0 },
+    { "Until",  SD_JSON_VARIANT_INTEGER, sd_json_dispatch_uint64, offsetof(struct p, until),  0 },
     {}
   };
-  _cleanup_(freep) char *error = NULL;
+  struct job *j;
   int r;
 
-  log_msg (LOG_INFO, "Varlink method \"ReadAll\" called...");
+  log_msg (LOG_INFO, "Varlink method \"Concurrency\" called...");
 
-  r = sd_varlink_dispatch(link, parameters, dispatch_table, /* userdata= */ NULL);
+  r = sd_varlink_dispatch(link, parameters, dispatch_table, &p);
   if (r != 0)
     {
-      log_msg(LOG_ERR, "Get all entries request: varlink dispatch failed: %s", strerror (-r));
+      log_msg(LOG_ERR, "Concurrency request: varlink dispatch failed: %s", strerror (-r));
       return r;
     }
 
-  incomplete = 0;
-  r = wtmpdb_read_all_v2 (_PATH_WTMPDB, &wtmpdb_cb_func, (void *)&array, &error);
-  if (r < 0 || error != NULL || incomplete)
-    {
-      log_msg(LOG_ERR, "Didn't got all entries from db: %s", error);
-      return sd_varlink_errorbo(link, "org.openSUSE.wtmpdb.InternalError",
-				SD_JSON_BUILD_PAIR_BOOLEAN("Success", false),
-                                SD_JSON_BUILD_PAIR_STRING("ErrorMsg", error?error:"unknown"));
+  if (p.bucket == 0)
+    return reply_error (sd_varlink_error_invalid_parameter_name(link, "Bucket"));
 
-    }
+  j = job_new (JOB_CONCURRENCY, link);
+  if (j == NULL)
+    return -ENOMEM;
+  j->bucket = p.bucket;
+  j->since = p.since;
+  j->until = p.until;
 
-  return sd_varlink_replybo(link, SD_JSON_BUILD_PAIR_BOOLEAN("Success", true),
-			    SD_JSON_BUILD_PAIR_VARIANT("Data", array));
+  return pool_submit (j);
 }
 
 static int
@@ -511,14 +1608,17 @@ vl_method_rotate(sd_varlink *link, sd_json_variant *parameters,
 {
   struct p {
     int days;
+    bool background;
   } p = {
-    .days = -1
+    .days = -1,
+    .background = false,
   };
   static const sd_json_dispatch_field dispatch_table[] = {
-    { "Days", SD_JSON_VARIANT_INTEGER, sd_json_dispatch_int, offsetof(struct p, days), SD_JSON_MANDATORY },
+    { "Days",       SD_JSON_VARIANT_INTEGER, sd_json_dispatch_int,     offsetof(struct p, days),       SD_JSON_MANDATORY },
+    { "Background", SD_JSON_VARIANT_BOOLEAN, sd_json_dispatch_stdbool, offsetof(struct p, background), 0 },
     {}
   };
-  _cleanup_(freep) char *error = NULL;
+  _cleanup_(job_freep) struct job *j = NULL;
   int r;
 
   log_msg (LOG_INFO, "Varlink method \"Rotate\" called...");
@@ -542,28 +1642,121 @@ vl_method_rotate(sd_varlink *link, sd_json_variant *parameters,
   if (peer_uid != 0)
     {
       log_msg(LOG_WARNING, "Rotate: peer UID %i denied", peer_uid);
-      return sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, parameters);
+      return reply_error (sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, parameters));
     }
 
-  _cleanup_(freep) char *backup = NULL;
-  uint64_t entries = 0;
-  r = wtmpdb_rotate (_PATH_WTMPDB, p.days, &error, &backup, &entries);
-  if (r < 0 || error != NULL)
+  j = job_new (JOB_ROTATE, link);
+  if (j == NULL)
+    return -ENOMEM;
+  j->days = p.days;
+
+  pthread_mutex_lock (&rotation.lock);
+  if (rotation.running)
+    {
+      pthread_mutex_unlock (&rotation.lock);
+      log_msg(LOG_ERR, "Rotate request: rotation already running");
+      return reply_error (sd_varlink_errorbo(link, "org.openSUSE.wtmpdb.InternalError",
+					     SD_JSON_BUILD_PAIR_BOOLEAN("Success", false),
+					     SD_JSON_BUILD_PAIR_STRING("ErrorMsg", "Rotation already running")));
+    }
+  rotation.running = true;
+  rotation.phase = "counting";
+  rotation.days = p.days;
+  rotation.moved = 0;
+  rotation.total = 0;
+  rotation.start_usec = now_usec ();
+  rotation.end_usec = 0;
+  rotation.backup = mfree (rotation.backup);
+  rotation.error = mfree (rotation.error);
+  pthread_mutex_unlock (&rotation.lock);
+
+  /* The thread must not reply if we already did */
+  if (p.background)
+    j->link = sd_varlink_unref (j->link);
+
+  /* The previous thread is done with the rotation, but may still
+     be queueing its job. */
+  if (rotation.joinable)
     {
-      log_msg(LOG_ERR, "Rotate db failed: %s", error);
-      return sd_varlink_errorbo(link, "org.openSUSE.wtmpdb.NoEntryFound",
-				SD_JSON_BUILD_PAIR_BOOLEAN("Success", false),
-                                SD_JSON_BUILD_PAIR_STRING("ErrorMsg", error));
+      pthread_join (rotation.thread, NULL);
+      rotation.joinable = false;
     }
 
-  /* XXX make this nicer, build reply on demand */
-  if (backup)
-    return sd_varlink_replybo(link, SD_JSON_BUILD_PAIR_BOOLEAN("Success", true),
-			      SD_JSON_BUILD_PAIR_STRING("BackupName", backup),
-			      SD_JSON_BUILD_PAIR_INTEGER("Entries", entries));
-  else
-    return sd_varlink_replybo(link, SD_JSON_BUILD_PAIR_BOOLEAN("Success", true),
-			      SD_JSON_BUILD_PAIR_INTEGER("Entries", entries));
+  /* The database is copied in batches by a separate thread, so
+     that the event loop keeps answering requests meanwhile. */
+  r = pthread_create (&rotation.thread, NULL, rotate_thread, j);
+  if (r != 0)
+    {
+      pthread_mutex_lock (&rotation.lock);
+      rotation.running = false;
+      rotation.phase = "failed";
+      pthread_mutex_unlock (&rotation.lock);
+      log_msg (LOG_ERR, "Failed to create rotate thread: %s", strerror (r));
+      return -r;
+    }
+  rotation.joinable = true;
+
+  if (p.background)
+    {
+      /* the job is freed by the event loop, so still valid here */
+      TAKE_PTR(j);
+      return sd_varlink_replybo(link, SD_JSON_BUILD_PAIR_BOOLEAN("Success", true));
+    }
+
+  call_deferred = true;
+  TAKE_PTR(j);
+  return 0;
+}
+
+static int
+vl_method_rotate_status(sd_varlink *link, sd_json_variant *parameters,
+			sd_varlink_method_flags_t _unused_(flags),
+			void _unused_(*userdata))
+{
+  static const sd_json_dispatch_field dispatch_table[] = {
+    {}
+  };
+  _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+  uint64_t elapsed = 0, eta = 0;
+  int r;
+
+  log_msg (LOG_INFO, "Varlink method \"RotateStatus\" called...");
+
+  r = sd_varlink_dispatch(link, parameters, dispatch_table, /* userdata= */ NULL);
+  if (r != 0)
+    {
+      log_msg(LOG_ERR, "Rotate status request: varlink dispatch failed: %s", strerror (-r));
+      return r;
+    }
+
+  pthread_mutex_lock (&rotation.lock);
+  if (rotation.start_usec > 0)
+    elapsed = (rotation.end_usec ? rotation.end_usec : now_usec ()) - rotation.start_usec;
+  if (rotation.running && rotation.moved > 0 && rotation.total > rotation.moved)
+    eta = elapsed / rotation.moved * (rotation.total - rotation.moved);
+
+  r = sd_json_buildo(&v,
+		     SD_JSON_BUILD_PAIR_STRING("Phase", rotation.phase),
+		     SD_JSON_BUILD_PAIR_BOOLEAN("Running", rotation.running),
+		     SD_JSON_BUILD_PAIR_CONDITION(rotation.start_usec > 0, "Days",
+						  SD_JSON_BUILD_INTEGER(rotation.days)),
+		     SD_JSON_BUILD_PAIR_INTEGER("EntriesMoved", rotation.moved),
+		     SD_JSON_BUILD_PAIR_INTEGER("EntriesTotal", rotation.total),
+		     SD_JSON_BUILD_PAIR_INTEGER("ElapsedUSec", elapsed),
+		     SD_JSON_BUILD_PAIR_CONDITION(rotation.running && rotation.moved > 0, "ETAUSec",
+						  SD_JSON_BUILD_INTEGER(eta)),
+		     SD_JSON_BUILD_PAIR_CONDITION(rotation.backup != NULL, "BackupName",
+						  SD_JSON_BUILD_STRING(rotation.backup)),
+		     SD_JSON_BUILD_PAIR_CONDITION(rotation.error != NULL, "ErrorMsg",
+						  SD_JSON_BUILD_STRING(rotation.error)));
+  pthread_mutex_unlock (&rotation.lock);
+  if (r < 0)
+    {
+      log_msg(LOG_ERR, "Failed to build JSON data: %s", strerror(-r));
+      return r;
+    }
+
+  return sd_varlink_reply(link, v);
 }
 
 static int
@@ -602,7 +1795,7 @@ vl_method_quit (sd_varlink *link, sd_json_variant *parameters,
   if (peer_uid != 0)
     {
       log_msg(LOG_WARNING, "Quit: peer UID %i denied", peer_uid);
-      return sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, parameters);
+      return reply_error (sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, parameters));
     }
 
   r = sd_event_exit (loop, p.code);
@@ -610,13 +1803,91 @@ vl_method_quit (sd_varlink *link, sd_json_variant *parameters,
     {
       log_msg (LOG_ERR, "Quit request: disabling event loop failed: %s",
 	       strerror (-r));
-      return sd_varlink_errorbo(link, "org.openSUSE.wtmpdb.InternalError",
-                                SD_JSON_BUILD_PAIR_BOOLEAN("Success", false));
+      return reply_error (sd_varlink_errorbo(link, "org.openSUSE.wtmpdb.InternalError",
+					     SD_JSON_BUILD_PAIR_BOOLEAN("Success", false)));
     }
 
   return sd_varlink_replybo (link, SD_JSON_BUILD_PAIR_BOOLEAN("Success", true));
 }
 
+static int
+vl_method_get_statistics(sd_varlink *link, sd_json_variant *parameters,
+			 sd_varlink_method_flags_t _unused_(flags),
+			 void _unused_(*userdata))
+{
+  _cleanup_(sd_json_variant_unrefp) sd_json_variant *array = NULL;
+  int r;
+
+  log_msg (LOG_INFO, "Varlink method \"GetStatistics\" called...");
+
+  r = sd_varlink_dispatch(link, parameters, NULL, NULL);
+  if (r != 0)
+    return r;
+
+  for (size_t m = 0; m < _METHOD_MAX; m++)
+    {
+      const struct method_stats *st = &method_stats[m];
+
+      r = sd_json_variant_append_arraybo(&array,
+					 SD_JSON_BUILD_PAIR_STRING("Name", method_names[m]),
+					 SD_JSON_BUILD_PAIR_UNSIGNED("Calls", st->calls),
+					 SD_JSON_BUILD_PAIR_UNSIGNED("Errors", st->errors),
+					 SD_JSON_BUILD_PAIR_UNSIGNED("Rows", st->rows),
+					 SD_JSON_BUILD_PAIR_UNSIGNED("PayloadBytes", st->payload_bytes),
+					 SD_JSON_BUILD_PAIR_UNSIGNED("P50USec", stats_percentile (st, 50)),
+					 SD_JSON_BUILD_PAIR_UNSIGNED("P90USec", stats_percentile (st, 90)),
+					 SD_JSON_BUILD_PAIR_UNSIGNED("P99USec", stats_percentile (st, 99)),
+					 SD_JSON_BUILD_PAIR_UNSIGNED("MaxUSec", st->max_usec));
+      if (r < 0)
+	{
+	  log_msg(LOG_ERR, "Appending array failed: %s", strerror(-r));
+	  return r;
+	}
+    }
+
+  return sd_varlink_replybo(link,
+			    SD_JSON_BUILD_PAIR_UNSIGNED("UptimeUSec", now_usec () - start_usec),
+			    SD_JSON_BUILD_PAIR_UNSIGNED("Connections",
+							stats_server ? sd_varlink_server_current_connections(stats_server) : 0),
+			    SD_JSON_BUILD_PAIR_UNSIGNED("WorkerThreads", pool.n_threads),
+			    SD_JSON_BUILD_PAIR_UNSIGNED("BusyRetries", wtmpdb_get_busy_retries ()),
+			    SD_JSON_BUILD_PAIR_VARIANT("Methods", array));
+}
+
+/* Wrappers recording the statistics of every method call. Calls
+   handed to the worker pool are recorded by job_reply(), unless
+   queueing the job failed. */
+#define STATS_METHOD(name, method)					\
+  static int								\
+  vl_stats_##name (sd_varlink *link, sd_json_variant *parameters,	\
+		   sd_varlink_method_flags_t flags, void *userdata)	\
+  {									\
+    uint64_t start = now_usec ();					\
+    PROBE(method_start, method_names[method]);				\
+    call_deferred = false;						\
+    call_failed = false;						\
+    int r = vl_method_##name (link, parameters, flags, userdata);	\
+    if (!call_deferred || r < 0)					\
+      stats_record (method, start, r, 0, 0);				\
+    return r;								\
+  }
+
+STATS_METHOD(concurrency,     METHOD_CONCURRENCY)
+STATS_METHOD(get_boottime,    METHOD_GET_BOOTTIME)
+STATS_METHOD(get_environment, METHOD_GET_ENVIRONMENT)
+STATS_METHOD(get_id,          METHOD_GET_ID)
+STATS_METHOD(get_statistics,  METHOD_GET_STATISTICS)
+STATS_METHOD(login,           METHOD_LOGIN)
+STATS_METHOD(logout,          METHOD_LOGOUT)
+STATS_METHOD(ping,            METHOD_PING)
+STATS_METHOD(quit,            METHOD_QUIT)
+STATS_METHOD(read_all,        METHOD_READ_ALL)
+STATS_METHOD(report,          METHOD_REPORT)
+STATS_METHOD(rotate,          METHOD_ROTATE)
+STATS_METHOD(rotate_status,   METHOD_ROTATE_STATUS)
+STATS_METHOD(set_log_level,   METHOD_SET_LOG_LEVEL)
+STATS_METHOD(subscribe,       METHOD_SUBSCRIBE)
+
 /* Send a messages to systemd daemon, that inicialization of daemon
    is finished and daemon is ready to accept connections. */
 static void
@@ -720,16 +1991,21 @@ run_varlink (void)
     }
 
   r = sd_varlink_server_bind_method_many (varlink_server,
-					  "org.openSUSE.wtmpdb.GetBootTime",    vl_method_get_boottime,
-					  "org.openSUSE.wtmpdb.GetEnvironment", vl_method_get_environment,
-					  "org.openSUSE.wtmpdb.GetID",          vl_method_get_id,
-					  "org.openSUSE.wtmpdb.Login",          vl_method_login,
-					  "org.openSUSE.wtmpdb.Logout",         vl_method_logout,
-					  "org.openSUSE.wtmpdb.Ping",           vl_method_ping,
-					  "org.openSUSE.wtmpdb.Quit",           vl_method_quit,
-					  "org.openSUSE.wtmpdb.ReadAll",        vl_method_read_all,
-					  "org.openSUSE.wtmpdb.Rotate",         vl_method_rotate,
-					  "org.openSUSE.wtmpdb.SetLogLevel",    vl_method_set_log_level);
+					  "org.openSUSE.wtmpdb.Concurrency",    vl_stats_concurrency,
+					  "org.openSUSE.wtmpdb.GetBootTime",    vl_stats_get_boottime,
+					  "org.openSUSE.wtmpdb.GetEnvironment", vl_stats_get_environment,
+					  "org.openSUSE.wtmpdb.GetID",          vl_stats_get_id,
+					  "org.openSUSE.wtmpdb.GetStatistics",  vl_stats_get_statistics,
+					  "org.openSUSE.wtmpdb.Login",          vl_stats_login,
+					  "org.openSUSE.wtmpdb.Logout",         vl_stats_logout,
+					  "org.openSUSE.wtmpdb.Ping",           vl_stats_ping,
+					  "org.openSUSE.wtmpdb.Quit",           vl_stats_quit,
+					  "org.openSUSE.wtmpdb.ReadAll",        vl_stats_read_all,
+					  "org.openSUSE.wtmpdb.Report",         vl_stats_report,
+					  "org.openSUSE.wtmpdb.Rotate",         vl_stats_rotate,
+					  "org.openSUSE.wtmpdb.RotateStatus",   vl_stats_rotate_status,
+					  "org.openSUSE.wtmpdb.SetLogLevel",    vl_stats_set_log_level,
+					  "org.openSUSE.wtmpdb.Subscribe",      vl_stats_subscribe);
   if (r < 0)
     {
       log_msg(LOG_ERR, "Failed to bind Varlink methods: %s",
@@ -737,6 +2013,14 @@ run_varlink (void)
       return r;
     }
 
+  r = sd_varlink_server_bind_disconnect (varlink_server, subscriber_disconnect);
+  if (r < 0)
+    {
+      log_msg(LOG_ERR, "Failed to bind disconnect callback: %s",
+	      strerror(-r));
+      return r;
+    }
+
   sd_varlink_server_set_userdata (varlink_server, event);
 
   r = sd_varlink_server_attach_event (varlink_server, event, SD_EVENT_PRIORITY_NORMAL);
@@ -746,6 +2030,13 @@ run_varlink (void)
       return r;
     }
 
+  r = pool_start (event);
+  if (r < 0)
+    return r;
+
+  start_usec = now_usec ();
+  stats_server = varlink_server;
+
   r = sd_varlink_server_listen_auto (varlink_server);
   if (r < 0)
     {
@@ -771,24 +2062,73 @@ run_varlink (void)
     r = sd_event_loop(event);
   announce_stopping();
 
+  pool_stop ();
+  subscribers_free ();
+
   return r;
 }
 
+/* "auto" or a number of bytes with the optional suffix K, M or G */
+static int
+parse_size (const char *str, int64_t *size)
+{
+  char *ep;
+  long long int n;
+  int shift = 0;
+
+  if (strcmp (str, "auto") == 0)
+    {
+      *size = -1;
+      return 0;
+    }
+
+  errno = 0;
+  n = strtoll (str, &ep, 10);
+  if (errno != 0 || ep == str || n < 0)
+    return -1;
+
+  switch (*ep)
+    {
+    case 'G':
+      shift = 30;
+      ep++;
+      break;
+    case 'M':
+      shift = 20;
+      ep++;
+      break;
+    case 'K':
+      shift = 10;
+      ep++;
+      break;
+    }
+  if (*ep != '\0' || n > (INT64_MAX >> shift))
+    return -1;
+
+  *size = (int64_t)n << shift;
+  return 0;
+}
+
 static void
 print_help (void)
 {
   printf("wtmpdbd - manage wtmpdb\n");
 
-  printf("  -s, --socket   Activation through socket\n");
-  printf("  -d, --debug    Debug mode\n");
-  printf("  -v, --verbose  Verbose logging\n");
-  printf("  -?, --help     Give this help list\n");
-  printf("      --version  Print program version\n");
+  printf("  -s, --socket       Activation through socket\n");
+  printf("  -t, --threads NUM  Number of threads for read requests\n");
+  printf("      --mmap-size SIZE   Map up to SIZE bytes of the database\n");
+  printf("      --cache-size SIZE  Cache up to SIZE bytes per connection\n");
+  printf("  -d, --debug        Debug mode\n");
+  printf("  -v, --verbose      Verbose logging\n");
+  printf("  -?, --help         Give this help list\n");
+  printf("      --version      Print program version\n");
 }
 
 int
 main (int argc, char **argv)
 {
+  int64_t mmap_size = -1, cache_size = -1;
+
   while (1)
     {
       int c;
@@ -796,6 +2136,9 @@ main (int argc, char **argv)
       static struct option long_options[] =
         {
 	  {"socket", no_argument, NULL, 's'},
+	  {"threads", required_argument, NULL, 't'},
+	  {"mmap-size", required_argument, NULL, '\253'},
+	  {"cache-size", required_argument, NULL, '\254'},
           {"debug", no_argument, NULL, 'd'},
           {"verbose", no_argument, NULL, 'v'},
           {"version", no_argument, NULL, '\255'},
@@ -805,7 +2148,7 @@ main (int argc, char **argv)
         };
 
 
-      c = getopt_long (argc, argv, "sdvh?", long_options, &option_index);
+      c = getopt_long (argc, argv, "st:dvh?", long_options, &option_index);
       if (c == (-1))
         break;
       switch (c)
@@ -813,8 +2156,39 @@ main (int argc, char **argv)
 	case 's':
 	  socket_activation = true;
 	  break;
+	case 't':
+	  {
+	    char *ep;
+	    long n;
+
+	    errno = 0;
+	    n = strtol (optarg, &ep, 10);
+	    if (errno != 0 || ep == optarg || *ep != '\0' || n < 0 || n > 64)
+	      {
+		fprintf (stderr, "Invalid number of threads: %s\n", optarg);
+		return 1;
+	      }
+	    pool.n_threads = n;
+	  }
+	  break;
+	case '\253':
+	  if (parse_size (optarg, &mmap_size) < 0)
+	    {
+	      fprintf (stderr, "Invalid mmap size: %s\n", optarg);
+	      return 1;
+	    }
+	  break;
+	case '\254':
+	  if (parse_size (optarg, &cache_size) < 0)
+	    {
+	      fprintf (stderr, "Invalid cache size: %s\n", optarg);
+	      return 1;
+	    }
+	  break;
         case 'd':
 	  set_max_log_level(LOG_DEBUG);
+	  /* summary of the SQL statements into the journal at exit */
+	  setenv ("WTMPDB_PROFILE", "1", 0);
           break;
         case '?':
         case 'h':
@@ -841,6 +2215,8 @@ main (int argc, char **argv)
       return 1;
     }
 
+  wtmpdb_set_read_cache (mmap_size, cache_size);
+
   log_msg (LOG_INFO, "Starting wtmpdbd (%s) %s...", PACKAGE, VERSION);
 
   int r = run_varlink ();
@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2023, 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Test case:
+   Lock the database, check that wtmpdb_login gives up after the
+   configured timeout, for the whole call and not per wait, and that
+   the retries are counted. A reader must not block the login.
+*/
+
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sqlite3.h>
+
+#include "wtmpdb.h"
+
+static int64_t
+login (const char *db_path, char **error)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_REALTIME, &ts);
+  return wtmpdb_login (db_path, USER_PROCESS, "user", wtmpdb_timespec2usec (ts),
+		       "pts/1", NULL, "test", error);
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-busy.db";
+  char *error = NULL;
+  sqlite3 *db;
+  int64_t id;
+
+  remove (db_path);
+
+  if (login (db_path, &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+
+  if (sqlite3_open (db_path, &db) != SQLITE_OK ||
+      sqlite3_exec (db, "BEGIN EXCLUSIVE;", NULL, NULL, NULL) != SQLITE_OK)
+    {
+      fprintf (stderr, "Cannot lock database: %s\n", sqlite3_errmsg (db));
+      return 1;
+    }
+
+  wtmpdb_set_timeout (50000); /* 50 msec */
+
+  struct timespec start, end;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  id = login (db_path, &error);
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  if (id != -EBUSY)
+    {
+      fprintf (stderr, "wtmpdb_login returned %" PRId64 ", expected -EBUSY\n", id);
+      return 1;
+    }
+  int64_t msec = (end.tv_sec - start.tv_sec) * 1000 +
+    (end.tv_nsec - start.tv_nsec) / 1000000;
+  if (msec < 45 || msec > 90)
+    {
+      fprintf (stderr, "wtmpdb_login waited %" PRId64 " msec, expected 50\n", msec);
+      return 1;
+    }
+  free (error);
+  error = NULL;
+
+  if (wtmpdb_get_busy_retries () == 0)
+    {
+      fprintf (stderr, "No busy retries counted\n");
+      return 1;
+    }
+
+  sqlite3_exec (db, "COMMIT;", NULL, NULL, NULL);
+
+  /* a slow reader, e.g. "last" on a large database */
+  if (sqlite3_exec (db, "BEGIN; SELECT COUNT(*) FROM wtmp;", NULL, NULL, NULL) != SQLITE_OK)
+    {
+      fprintf (stderr, "Cannot read database: %s\n", sqlite3_errmsg (db));
+      return 1;
+    }
+  if (login (db_path, &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_login failed while reading: %s\n",
+	       error ? error : "unknown");
+      return 1;
+    }
+  sqlite3_exec (db, "COMMIT;", NULL, NULL, NULL);
+  sqlite3_close (db);
+
+  wtmpdb_set_timeout (0);
+
+  if (login (db_path, &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_login failed after unlock: %s\n",
+	       error ? error : "unknown");
+      return 1;
+    }
+
+  remove (db_path);
+
+  return 0;
+}
@@ -0,0 +1,247 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2026 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Test case:
+   Create overlapping sessions, some without duration, some never
+   closed, and boots, and check the peak and number of sessions per
+   bucket of wtmpdb_concurrency against a brute force count.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "wtmpdb.h"
+
+#define ENTRIES 300
+#define MAX_BUCKETS 2000
+
+struct entry {
+  int type;
+  uint64_t login;
+  uint64_t logout;
+  uint64_t end; /* logout, next boot or UINT64_MAX */
+};
+
+struct bucket {
+  uint64_t start;
+  uint64_t peak;
+  uint64_t sessions;
+};
+
+static struct entry entries[ENTRIES];
+static struct bucket seen[MAX_BUCKETS];
+static int n_seen = 0;
+static int max_seen = MAX_BUCKETS;
+
+static int
+collect (void *unused __attribute__((__unused__)),
+	 int argc, char **argv, char **azColName __attribute__((__unused__)))
+{
+  if (argc != 3 || n_seen >= max_seen)
+    return 1;
+
+  seen[n_seen].start = strtoull (argv[0], NULL, 10);
+  seen[n_seen].peak = strtoull (argv[1], NULL, 10);
+  seen[n_seen].sessions = strtoull (argv[2], NULL, 10);
+  n_seen++;
+  return 0;
+}
+
+/* brute force: number of sessions active at t */
+static uint64_t
+active_at (uint64_t t)
+{
+  uint64_t n = 0;
+
+  for (int i = 0; i < ENTRIES; i++)
+    if (entries[i].type == USER_PROCESS &&
+	entries[i].login <= t && t < entries[i].end)
+      n++;
+  return n;
+}
+
+static int
+check (const char *db_path, uint64_t since, uint64_t until, uint64_t size)
+{
+  char *error = NULL;
+  uint64_t start;
+  int n = 0;
+
+  n_seen = 0;
+  if (wtmpdb_concurrency (db_path, since, until, size,
+			  collect, NULL, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_concurrency failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+
+  if (since == 0)
+    since = entries[1].login; /* entries[0] is a boot */
+  for (start = since - since % size; start <= until; start += size, n++)
+    {
+      uint64_t end = start + size;
+      uint64_t peak = active_at (start);
+      uint64_t sessions = 0;
+
+      for (int i = 0; i < ENTRIES; i++)
+	{
+	  if (entries[i].type != USER_PROCESS || entries[i].login > until)
+	    continue;
+	  if (entries[i].login >= start && entries[i].login < end)
+	    {
+	      uint64_t a = active_at (entries[i].login);
+
+	      if (a > peak)
+		peak = a;
+	      sessions++;
+	    }
+	  else if (entries[i].login < start && entries[i].end > start)
+	    sessions++;
+	}
+
+      if (n >= n_seen || seen[n].start != start ||
+	  seen[n].peak != peak || seen[n].sessions != sessions)
+	{
+	  fprintf (stderr, "[%" PRIu64 ", %" PRIu64 "]/%" PRIu64 ": bucket %i is "
+		   "%" PRIu64 "/%" PRIu64 "/%" PRIu64 ", expected "
+		   "%" PRIu64 "/%" PRIu64 "/%" PRIu64 "\n", since, until, size, n,
+		   n < n_seen ? seen[n].start : 0, n < n_seen ? seen[n].peak : 0,
+		   n < n_seen ? seen[n].sessions : 0, start, peak, sessions);
+	  return 1;
+	}
+    }
+
+  if (n != n_seen)
+    {
+      fprintf (stderr, "[%" PRIu64 ", %" PRIu64 "]/%" PRIu64
+	       ": got %i buckets, expected %i\n", since, until, size, n_seen, n);
+      return 1;
+    }
+  return 0;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-concurrency.db";
+  char *error = NULL;
+  uint64_t t = 1000 * USEC_PER_SEC;
+
+  remove (db_path);
+
+  srandom (42);
+  for (int i = 0; i < ENTRIES; i++)
+    {
+      struct entry *e = &entries[i];
+      int64_t id;
+
+      /* never on a bucket border */
+      t += (1 + random () % 1800) * USEC_PER_SEC;
+      e->type = i % 40 == 0 ? BOOT_TIME : USER_PROCESS;
+      e->login = t + 1;
+      switch (random () % 10)
+	{
+	case 0:
+	  e->logout = 0;
+	  break;
+	case 1:
+	  e->logout = e->login;
+	  break;
+	default:
+	  e->logout = e->login + (random () % 4 == 0 ? random () % 86400 :
+				  random () % 3600) * USEC_PER_SEC + 1;
+	  break;
+	}
+
+      id = wtmpdb_login (db_path, e->type,
+			 e->type == BOOT_TIME ? "reboot" : "user",
+			 e->login, "pts/1", NULL, "test", &error);
+      if (id < 0)
+	{
+	  fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+	  return 1;
+	}
+      if (e->type == USER_PROCESS && e->logout &&
+	  wtmpdb_logout (db_path, id, e->logout, &error) < 0)
+	{
+	  fprintf (stderr, "wtmpdb_logout failed: %s\n", error ? error : "unknown");
+	  return 1;
+	}
+    }
+
+  /* open sessions end with the next boot */
+  for (int i = 0; i < ENTRIES; i++)
+    {
+      entries[i].end = entries[i].logout ? entries[i].logout : UINT64_MAX;
+      if (entries[i].logout == 0)
+	for (int j = i + 1; j < ENTRIES; j++)
+	  if (entries[j].type == BOOT_TIME)
+	    {
+	      entries[i].end = entries[j].login;
+	      break;
+	    }
+    }
+
+  if (check (db_path, 0, t, 3600 * USEC_PER_SEC) != 0 ||
+      check (db_path, 0, t, 86400 * USEC_PER_SEC) != 0 ||
+      check (db_path, 0, t + 7 * 86400 * USEC_PER_SEC, 86400 * USEC_PER_SEC) != 0)
+    return 1;
+
+  for (int i = 0; i < 50; i++)
+    {
+      static const uint64_t sizes[] = {60, 900, 3600, 86400};
+      uint64_t since = 1000 * USEC_PER_SEC + random () % (t - 1000 * USEC_PER_SEC);
+      uint64_t until = since + random () % (2 * 86400 * USEC_PER_SEC);
+
+      if (check (db_path, since, until, sizes[i % 4] * USEC_PER_SEC) != 0)
+	return 1;
+    }
+
+  /* the callback stops the sweep */
+  max_seen = 3;
+  n_seen = 0;
+  if (wtmpdb_concurrency (db_path, 0, t, 3600 * USEC_PER_SEC,
+			  collect, NULL, &error) != 0 || n_seen != 3)
+    {
+      fprintf (stderr, "wtmpdb_concurrency did not stop: %i buckets\n", n_seen);
+      return 1;
+    }
+
+  /* a bucket size of 0 is an error */
+  if (wtmpdb_concurrency (db_path, 0, t, 0, collect, NULL, &error) == 0)
+    {
+      fprintf (stderr, "wtmpdb_concurrency accepted a bucket size of 0\n");
+      return 1;
+    }
+  free (error);
+
+  remove (db_path);
+
+  return 0;
+}
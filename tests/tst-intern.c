@@ -0,0 +1,200 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+/* Test case:
+   Convert a database to interned strings and back and check that
+   the entries stay the same, that new entries get the right ID and
+   that report and rollup still work.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wtmpdb.h"
+
+static char dump[4096];
+
+static int
+collect (void *unused __attribute__((__unused__)),
+	 int argc, char **argv, char **azColName __attribute__((__unused__)))
+{
+  size_t len = strlen (dump);
+
+  for (int i = 0; i < argc; i++)
+    {
+      int n = snprintf (dump + len, sizeof (dump) - len, "%s%c",
+			argv[i] ? argv[i] : "(null)", i + 1 < argc ? '|' : '\n');
+      if (n < 0 || (size_t)n >= sizeof (dump) - len)
+	return 1;
+      len += n;
+    }
+  return 0;
+}
+
+static int
+read_dump (const char *db_path, char *buf, size_t size)
+{
+  char *error = NULL;
+
+  dump[0] = '\0';
+  if (wtmpdb_read_all (db_path, collect, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_read_all failed: %s\n", error ? error : "unknown");
+      free (error);
+      return 1;
+    }
+  snprintf (buf, size, "%s", dump);
+  return 0;
+}
+
+static int64_t
+login (const char *db_path, const char *user, const char *tty,
+       const char *host, const char *service, uint64_t usec)
+{
+  char *error = NULL;
+  int64_t id = wtmpdb_login (db_path, USER_PROCESS, user, usec, tty,
+			     host, service, &error);
+
+  if (id < 0)
+    {
+      fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+      exit (1);
+    }
+  return id;
+}
+
+static int
+intern (const char *db_path, int enable)
+{
+  char *error = NULL;
+
+  if (wtmpdb_intern (db_path, enable, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_intern (%i) failed: %s\n", enable,
+	       error ? error : "unknown");
+      free (error);
+      return 1;
+    }
+  return 0;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-intern.db";
+  const uint64_t start = 1700000000 * USEC_PER_SEC;
+  char before[4096], after[4096];
+  char *error = NULL;
+  int64_t id;
+
+  remove (db_path);
+
+  id = login (db_path, "alice", "pts/1", "host1", "sshd", start);
+  if (wtmpdb_logout (db_path, id, start + 10 * USEC_PER_SEC, &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_logout failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+  login (db_path, "bob", "pts/2", NULL, NULL, start + 20 * USEC_PER_SEC);
+  id = login (db_path, "carol", "tty1", "", "login", start + 30 * USEC_PER_SEC);
+
+  if (wtmpdb_rollup (db_path, 1, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_rollup failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+
+  if (read_dump (db_path, before, sizeof (before)) != 0 ||
+      intern (db_path, 1) != 0 || intern (db_path, 1) != 0 ||
+      read_dump (db_path, after, sizeof (after)) != 0)
+    return 1;
+  if (strcmp (before, after) != 0)
+    {
+      fprintf (stderr, "Entries changed:\n%s---\n%s", before, after);
+      return 1;
+    }
+
+  /* new entries through the view */
+  int64_t new_id = login (db_path, "alice", "pts/3", "host1", "sshd",
+			  start + 40 * USEC_PER_SEC);
+  if (new_id != id + 1)
+    {
+      fprintf (stderr, "Got ID %" PRId64 ", expected %" PRId64 "\n",
+	       new_id, id + 1);
+      return 1;
+    }
+  if (wtmpdb_get_id (db_path, "pts/3", &error) != new_id)
+    {
+      fprintf (stderr, "wtmpdb_get_id failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+  if (wtmpdb_logout (db_path, new_id, start + 45 * USEC_PER_SEC, &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_logout failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+  if (wtmpdb_logout (db_path, new_id + 1, start + 45 * USEC_PER_SEC, &error) == 0)
+    {
+      fprintf (stderr, "wtmpdb_logout of unknown ID succeeded\n");
+      return 1;
+    }
+  error = NULL;
+
+  /* NULL and the empty host are one group, the rollup has the new
+     session */
+  dump[0] = '\0';
+  if (wtmpdb_report (db_path, WTMPDB_REPORT_HOST, 0, 0, 0,
+		     collect, NULL, &error) != 0 ||
+      strcmp (dump, "|2|0|2|0\nhost1|2|15|1|1\n") != 0)
+    {
+      fprintf (stderr, "Unexpected report by host:\n%s", dump);
+      return 1;
+    }
+  dump[0] = '\0';
+  if (wtmpdb_report (db_path, WTMPDB_REPORT_USER, 0, 0, 1,
+		     collect, NULL, &error) != 0 ||
+      strcmp (dump, "alice|2|15|1|1\n") != 0)
+    {
+      fprintf (stderr, "Unexpected report by user:\n%s", dump);
+      return 1;
+    }
+
+  if (read_dump (db_path, before, sizeof (before)) != 0 ||
+      intern (db_path, 0) != 0 ||
+      read_dump (db_path, after, sizeof (after)) != 0)
+    return 1;
+  if (strcmp (before, after) != 0)
+    {
+      fprintf (stderr, "Entries changed:\n%s---\n%s", before, after);
+      return 1;
+    }
+
+  remove (db_path);
+
+  return 0;
+}
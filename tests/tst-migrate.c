@@ -0,0 +1,221 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+/* Test case:
+   Open a database of an old release without schema version and
+   check that it gets migrated, that a large database gets the
+   indexes and the WAL mode only from wtmpdb_migrate, and that a database with a
+   newer schema is still readable, but not writable.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sqlite3.h>
+
+#include "wtmpdb.h"
+
+static int counter = 0;
+
+static int
+count_entry (void *unused __attribute__((__unused__)),
+	     int argc __attribute__((__unused__)),
+	     char **argv __attribute__((__unused__)),
+	     char **azColName __attribute__((__unused__)))
+{
+  counter++;
+  return 0;
+}
+
+static int
+exec_sql (const char *db_path, const char *sql)
+{
+  sqlite3 *db;
+
+  if (sqlite3_open (db_path, &db) != SQLITE_OK ||
+      sqlite3_exec (db, sql, NULL, NULL, NULL) != SQLITE_OK)
+    {
+      fprintf (stderr, "%s failed: %s\n", sql, sqlite3_errmsg (db));
+      sqlite3_close (db);
+      return 1;
+    }
+  sqlite3_close (db);
+  return 0;
+}
+
+/* Returns the result of an integer query, -1 on error */
+static int
+query_int (const char *db_path, const char *sql)
+{
+  sqlite3_stmt *res;
+  sqlite3 *db;
+  int value = -1;
+
+  if (sqlite3_open (db_path, &db) != SQLITE_OK ||
+      sqlite3_prepare_v2 (db, sql, -1, &res, NULL) != SQLITE_OK)
+    {
+      fprintf (stderr, "%s failed: %s\n", sql, sqlite3_errmsg (db));
+      sqlite3_close (db);
+      return -1;
+    }
+  if (sqlite3_step (res) == SQLITE_ROW)
+    value = sqlite3_column_int (res, 0);
+  sqlite3_finalize (res);
+  sqlite3_close (db);
+  return value;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-migrate.db";
+  char *error = NULL;
+  int r;
+
+  remove (db_path);
+
+  /* written by an old release */
+  if (exec_sql (db_path, "CREATE TABLE wtmp(ID INTEGER PRIMARY KEY, Type INTEGER, User TEXT NOT NULL, "
+		"Login INTEGER, Logout INTEGER, TTY TEXT, RemoteHost TEXT, Service TEXT) STRICT;"
+		"INSERT INTO wtmp VALUES (1, 3, 'user', 1000000, NULL, 'pts/1', NULL, 'sshd')") != 0)
+    return 1;
+
+  if (wtmpdb_login (db_path, USER_PROCESS, "user", 2000000, "pts/2", NULL,
+		    "sshd", &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+  if (query_int (db_path, "PRAGMA user_version") != 4 ||
+      query_int (db_path, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'wtmp_open'") != 1 ||
+      query_int (db_path, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'wtmp_login'") != 1 ||
+      query_int (db_path, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'wtmp_span'") != 1 ||
+      query_int (db_path, "SELECT journal_mode = 'wal' FROM pragma_journal_mode") != 1)
+    {
+      fprintf (stderr, "Old database was not migrated\n");
+      return 1;
+    }
+
+  r = wtmpdb_migrate (db_path, &error);
+  if (r != 4)
+    {
+      fprintf (stderr, "wtmpdb_migrate returned %i: %s\n", r,
+	       error ? error : "unknown");
+      return 1;
+    }
+
+  /* too large to create the indexes while logging in */
+  if (exec_sql (db_path, "DROP INDEX wtmp_login; DROP INDEX wtmp_span; PRAGMA user_version = 1;"
+		"WITH RECURSIVE n(i) AS (SELECT 10 UNION ALL SELECT i + 1 FROM n WHERE i < 200000) "
+		"INSERT INTO wtmp SELECT i, 3, 'user', i * 1000000, i * 1000000 + 1, 'pts/1', NULL, 'sshd' FROM n") != 0)
+    return 1;
+  if (wtmpdb_login (db_path, USER_PROCESS, "user", 3000000, "pts/3", NULL,
+		    "sshd", &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+  if (query_int (db_path, "PRAGMA user_version") != 1 ||
+      query_int (db_path, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'wtmp_login'") != 0 ||
+      query_int (db_path, "SELECT COUNT(*) FROM wtmp_migration") != 1)
+    {
+      fprintf (stderr, "Login index was not deferred\n");
+      return 1;
+    }
+  r = wtmpdb_migrate (db_path, &error);
+  if (r != 4 ||
+      query_int (db_path, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'wtmp_login'") != 1 ||
+      query_int (db_path, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'wtmp_span'") != 1 ||
+      query_int (db_path, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'wtmp_migration'") != 0)
+    {
+      fprintf (stderr, "wtmpdb_migrate returned %i: %s\n", r,
+	       error ? error : "unknown");
+      return 1;
+    }
+
+  /* large database of an old release */
+  if (exec_sql (db_path, "DROP INDEX wtmp_open; DROP INDEX wtmp_login; DROP INDEX wtmp_span;"
+		"PRAGMA user_version = 0; PRAGMA journal_mode = DELETE;") != 0)
+    return 1;
+  if (wtmpdb_logout (db_path, 1, 5000000, &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_logout failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+  if (query_int (db_path, "PRAGMA user_version") != 0 ||
+      query_int (db_path, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'wtmp_open'") != 0 ||
+      query_int (db_path, "SELECT Version FROM wtmp_migration") != 1 ||
+      query_int (db_path, "SELECT journal_mode = 'delete' FROM pragma_journal_mode") != 1)
+    {
+      fprintf (stderr, "Index of open sessions was not deferred\n");
+      return 1;
+    }
+  r = wtmpdb_migrate (db_path, &error);
+  if (r != 4 ||
+      query_int (db_path, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'wtmp_open'") != 1 ||
+      query_int (db_path, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'wtmp_migration'") != 0 ||
+      query_int (db_path, "SELECT journal_mode = 'wal' FROM pragma_journal_mode") != 1)
+    {
+      fprintf (stderr, "wtmpdb_migrate of old database returned %i: %s\n", r,
+	       error ? error : "unknown");
+      return 1;
+    }
+
+  /* written by a newer release */
+  if (exec_sql (db_path, "PRAGMA user_version = 1000") != 0)
+    return 1;
+  if (wtmpdb_login (db_path, USER_PROCESS, "user", 4000000, "pts/4", NULL,
+		    "sshd", &error) >= 0 || error == NULL ||
+      strstr (error, "newer") == NULL)
+    {
+      fprintf (stderr, "wtmpdb_login did not refuse the newer schema\n");
+      return 1;
+    }
+  free (error);
+  error = NULL;
+
+  if (wtmpdb_read_all (db_path, count_entry, &error) != 0 || counter != 199994)
+    {
+      fprintf (stderr, "Reading newer schema failed: %s, %i entries\n",
+	       error ? error : "unknown", counter);
+      return 1;
+    }
+
+  remove (db_path);
+
+  /* new database */
+  r = wtmpdb_migrate (db_path, &error);
+  if (r != 4)
+    {
+      fprintf (stderr, "wtmpdb_migrate of new database returned %i: %s\n", r,
+	       error ? error : "unknown");
+      return 1;
+    }
+
+  remove (db_path);
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Test case:
+   Run a login and a search for its ID with WTMPDB_PROFILE set to a
+   file and check that the summary written at exit lists both
+   statements.
+*/
+
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "wtmpdb.h"
+
+#define DB_PATH "tst-profile.db"
+#define PROFILE "tst-profile.out"
+
+static int
+run_child (const char *profile)
+{
+  struct timespec ts;
+  char *error = NULL;
+  int64_t id;
+
+  setenv ("WTMPDB_PROFILE", profile, 1);
+
+  clock_gettime (CLOCK_REALTIME, &ts);
+  id = wtmpdb_login (DB_PATH, USER_PROCESS, "user",
+		     wtmpdb_timespec2usec (ts), "pts/1", NULL, "test", &error);
+  if (id < 0)
+    {
+      fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+
+  if (wtmpdb_get_id (DB_PATH, "pts/1", &error) != id)
+    {
+      fprintf (stderr, "wtmpdb_get_id failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+
+  return 0;
+}
+
+int
+main(void)
+{
+  char cwd[PATH_MAX];
+  char *profile;
+  char line[1024];
+  int insert = 0, select = 0;
+  int status;
+  pid_t pid;
+  FILE *fp;
+
+  remove (DB_PATH);
+  remove (PROFILE);
+
+  if (getcwd (cwd, sizeof (cwd)) == NULL ||
+      asprintf (&profile, "%s/%s", cwd, PROFILE) < 0)
+    {
+      fprintf (stderr, "Cannot build profile path\n");
+      return 1;
+    }
+
+  /* the summary gets written when the child exits */
+  pid = fork ();
+  if (pid < 0)
+    {
+      perror ("fork");
+      return 1;
+    }
+  if (pid == 0)
+    exit (run_child (profile));
+
+  if (waitpid (pid, &status, 0) != pid || !WIFEXITED (status) ||
+      WEXITSTATUS (status) != 0)
+    {
+      fprintf (stderr, "Child failed\n");
+      return 1;
+    }
+
+  if ((fp = fopen (profile, "r")) == NULL)
+    {
+      fprintf (stderr, "No profile written: %s\n", strerror (errno));
+      return 1;
+    }
+  while (fgets (line, sizeof (line), fp))
+    {
+      if (strstr (line, "INSERT INTO wtmp "))
+	insert = 1;
+      if (strstr (line, "SELECT ID FROM wtmp WHERE TTY = ?"))
+	select = 1;
+    }
+  fclose (fp);
+
+  if (!insert || !select)
+    {
+      fprintf (stderr, "Profile is missing statements (insert=%d, select=%d)\n",
+	       insert, select);
+      return 1;
+    }
+
+  remove (DB_PATH);
+  remove (profile);
+  free (profile);
+
+  return 0;
+}
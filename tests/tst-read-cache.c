@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2026 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Test case:
+   Read the same database with and without memory mapping and with
+   different cache sizes and check that all entries are returned
+   every time.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "wtmpdb.h"
+
+#define ENTRIES 1000
+
+static int n_seen;
+static int64_t sum_ids;
+
+static int
+collect (void *unused __attribute__((__unused__)),
+	 int argc, char **argv, char **azColName __attribute__((__unused__)))
+{
+  if (argc != 8)
+    return 1;
+
+  n_seen++;
+  sum_ids += strtoll (argv[0], NULL, 10);
+  return 0;
+}
+
+static int
+check (const char *db_path, int64_t mmap_size, int64_t cache_size,
+       int64_t expected)
+{
+  char *error = NULL;
+
+  wtmpdb_set_read_cache (mmap_size, cache_size);
+
+  n_seen = 0;
+  sum_ids = 0;
+  if (wtmpdb_read_all_v2 (db_path, collect, NULL, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_read_all_v2 failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+  if (n_seen != ENTRIES || sum_ids != expected)
+    {
+      fprintf (stderr, "mmap %" PRId64 ", cache %" PRId64 ": got %i entries "
+	       "with ID sum %" PRId64 ", expected %i with %" PRId64 "\n",
+	       mmap_size, cache_size, n_seen, sum_ids, ENTRIES, expected);
+      return 1;
+    }
+  return 0;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-read-cache.db";
+  char *error = NULL;
+  int64_t expected = 0;
+
+  remove (db_path);
+
+  for (int i = 0; i < ENTRIES; i++)
+    {
+      int64_t id = wtmpdb_login (db_path, USER_PROCESS, "user",
+				 (1000 + i) * USEC_PER_SEC, "pts/1",
+				 "host.example.com", "sshd", &error);
+      if (id < 0)
+	{
+	  fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+	  return 1;
+	}
+      expected += id;
+    }
+
+  if (check (db_path, -1, -1, expected) != 0 ||
+      check (db_path, 0, 0, expected) != 0 ||
+      check (db_path, 64 * 1024 * 1024, 0, expected) != 0 ||
+      /* smaller than the file */
+      check (db_path, 4096, 1024, expected) != 0 ||
+      check (db_path, 0, 16 * 1024 * 1024, expected) != 0)
+    return 1;
+
+  remove (db_path);
+
+  return 0;
+}
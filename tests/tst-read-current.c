@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2023, 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+/* Test case:
+   Create sessions in two boots, some closed, and check that
+   wtmpdb_read_current returns only the open sessions of the
+   last boot.
+*/
+
+#include <inttypes.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wtmpdb.h"
+
+#define MAX_SEEN 8
+
+static int64_t seen[MAX_SEEN];
+static int n_seen = 0;
+
+static int
+collect (void *unused __attribute__((__unused__)),
+	 int argc, char **argv, char **azColName __attribute__((__unused__)))
+{
+  if (argc != 8 || n_seen >= MAX_SEEN)
+    return 1;
+
+  seen[n_seen++] = strtoll (argv[0], NULL, 10);
+  return 0;
+}
+
+static int64_t
+login (const char *db_path, int type, const char *user, uint64_t usec,
+       const char *tty)
+{
+  char *error = NULL;
+  int64_t id = wtmpdb_login (db_path, type, user, usec, tty, NULL,
+			     "test", &error);
+
+  if (id < 0)
+    {
+      fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+      exit (1);
+    }
+  return id;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-read-current.db";
+  char *error = NULL;
+  struct timespec ts;
+  uint64_t now;
+  int64_t open1, open2, closed;
+
+  remove (db_path);
+
+  clock_gettime (CLOCK_REALTIME, &ts);
+  now = wtmpdb_timespec2usec (ts);
+
+  /* previous boot which crashed, its sessions stay open */
+  login (db_path, BOOT_TIME, "reboot", now - 100 * USEC_PER_SEC, "~");
+  login (db_path, USER_PROCESS, "crashed", now - 90 * USEC_PER_SEC, "pts/0");
+
+  login (db_path, BOOT_TIME, "reboot", now - 50 * USEC_PER_SEC, "~");
+  open1 = login (db_path, USER_PROCESS, "first", now - 40 * USEC_PER_SEC, "pts/1");
+  closed = login (db_path, USER_PROCESS, "closed", now - 30 * USEC_PER_SEC, "pts/2");
+  open2 = login (db_path, USER_PROCESS, "second", now - 20 * USEC_PER_SEC, "pts/3");
+
+  if (wtmpdb_logout (db_path, closed, now - 10 * USEC_PER_SEC, &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_logout failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+
+  if (wtmpdb_read_current (db_path, collect, NULL, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_read_current failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+
+  if (n_seen != 2)
+    {
+      fprintf (stderr, "Got %i entries, expected 2\n", n_seen);
+      return 1;
+    }
+
+  /* newest first */
+  if (seen[0] != open2 || seen[1] != open1)
+    {
+      fprintf (stderr, "Got IDs %" PRId64 " and %" PRId64 ", expected %"
+	       PRId64 " and %" PRId64 "\n", seen[0], seen[1], open2, open1);
+      return 1;
+    }
+
+  remove (db_path);
+
+  return 0;
+}
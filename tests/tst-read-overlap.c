@@ -0,0 +1,177 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Test case:
+   Create sessions of very different lengths, some never closed,
+   and boots, and check that wtmpdb_read_overlap returns exactly
+   the entries which were active in a time range, ordered by
+   Login and ID, newest first.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "wtmpdb.h"
+
+#define ENTRIES 500
+
+struct entry {
+  int64_t id;
+  int type;
+  uint64_t login;
+  uint64_t logout;
+};
+
+static struct entry entries[ENTRIES];
+static int64_t seen[ENTRIES];
+static int n_seen = 0;
+
+static int
+collect (void *unused __attribute__((__unused__)),
+	 int argc, char **argv, char **azColName __attribute__((__unused__)))
+{
+  if (argc != 8 || n_seen >= ENTRIES)
+    return 1;
+
+  seen[n_seen++] = strtoll (argv[0], NULL, 10);
+  return 0;
+}
+
+/* brute force: was entry i active in [since, until]? */
+static int
+is_active (int i, uint64_t since, uint64_t until)
+{
+  if (entries[i].login > until)
+    return 0;
+  if (entries[i].logout)
+    return entries[i].logout >= since;
+
+  /* open until the next boot */
+  for (int j = i + 1; j < ENTRIES; j++)
+    if (entries[j].type == BOOT_TIME && entries[j].login > entries[i].login &&
+	entries[j].login <= since)
+      return 0;
+  return 1;
+}
+
+static int
+check (const char *db_path, uint64_t since, uint64_t until)
+{
+  char *error = NULL;
+  int n = 0;
+
+  n_seen = 0;
+  /* 0 is no upper bound for wtmpdb_read_overlap */
+  if (wtmpdb_read_overlap (db_path, since, until == UINT64_MAX ? 0 : until,
+			   collect, NULL, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_read_overlap failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+
+  /* entries are created in login order, so the newest is the last */
+  for (int i = ENTRIES - 1; i >= 0; i--)
+    if (is_active (i, since, until))
+      {
+	if (n >= n_seen || seen[n] != entries[i].id)
+	  {
+	    fprintf (stderr, "[%" PRIu64 ", %" PRIu64 "]: entry %i is %" PRId64
+		     ", expected %" PRId64 "\n", since, until, n,
+		     n < n_seen ? seen[n] : -1, entries[i].id);
+	    return 1;
+	  }
+	n++;
+      }
+
+  if (n != n_seen)
+    {
+      fprintf (stderr, "[%" PRIu64 ", %" PRIu64 "]: got %i entries, expected %i\n",
+	       since, until, n_seen, n);
+      return 1;
+    }
+  return 0;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-read-overlap.db";
+  char *error = NULL;
+  uint64_t t = 1000 * USEC_PER_SEC;
+
+  remove (db_path);
+
+  srandom (42);
+  for (int i = 0; i < ENTRIES; i++)
+    {
+      struct entry *e = &entries[i];
+
+      t += (random () % 3600) * USEC_PER_SEC;
+      e->type = i % 50 == 0 ? BOOT_TIME : USER_PROCESS;
+      e->login = t;
+      /* from seconds up to week long sessions, some never closed */
+      if (random () % 10 != 0)
+	e->logout = t + (random () % 7 == 0 ? random () % (7 * 86400) :
+			 random () % 600) * USEC_PER_SEC + 1;
+      else
+	e->logout = 0;
+
+      e->id = wtmpdb_login (db_path, e->type,
+			    e->type == BOOT_TIME ? "reboot" : "user",
+			    e->login, "pts/1", NULL, "test", &error);
+      if (e->id < 0)
+	{
+	  fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+	  return 1;
+	}
+      if (e->logout &&
+	  wtmpdb_logout (db_path, e->id, e->logout, &error) < 0)
+	{
+	  fprintf (stderr, "wtmpdb_logout failed: %s\n", error ? error : "unknown");
+	  return 1;
+	}
+    }
+
+  for (int i = 0; i < 100; i++)
+    {
+      uint64_t since = 1000 * USEC_PER_SEC + random () % (t - 1000 * USEC_PER_SEC);
+      uint64_t until = since + (i % 4 == 0 ? 0 : random () % (2 * 86400 * USEC_PER_SEC));
+
+      if (check (db_path, since, until) != 0)
+	return 1;
+    }
+
+  /* no upper bound */
+  if (check (db_path, t - 3600 * USEC_PER_SEC, UINT64_MAX) != 0)
+    return 1;
+
+  remove (db_path);
+
+  return 0;
+}
@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Test case:
+   Create entries, some with the same login time, and check that
+   reading them page by page with wtmpdb_read_page returns every
+   entry exactly once, ordered by login time and ID, newest first.
+*/
+
+#include <inttypes.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "wtmpdb.h"
+
+#define ENTRIES 250
+#define PAGE 50
+
+static int64_t seen_id[ENTRIES];
+static uint64_t seen_login[ENTRIES];
+static int n_seen = 0;
+
+static int
+collect (void *unused __attribute__((__unused__)),
+	 int argc, char **argv, char **azColName __attribute__((__unused__)))
+{
+  if (argc != 8 || n_seen >= ENTRIES)
+    return 1;
+
+  seen_id[n_seen] = strtoll (argv[0], NULL, 10);
+  seen_login[n_seen] = strtoull (argv[3], NULL, 10);
+  n_seen++;
+  return 0;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-read-page.db";
+  char *error = NULL;
+  struct timespec ts;
+  uint64_t start;
+
+  remove (db_path);
+
+  clock_gettime (CLOCK_REALTIME, &ts);
+  start = wtmpdb_timespec2usec (ts);
+  for (int i = 0; i < ENTRIES; i++)
+    {
+      /* every login time three times, older ones with larger IDs */
+      if (wtmpdb_login (db_path, USER_PROCESS, "user",
+			start - (i / 3) * USEC_PER_SEC - (i % 2) * 7 * USEC_PER_SEC,
+			"pts/1", NULL, "test", &error) < 0)
+	{
+	  fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+	  return 1;
+	}
+    }
+
+  for (int pages = 0; ; pages++)
+    {
+      int before = n_seen;
+
+      if (pages > ENTRIES / PAGE)
+	{
+	  fprintf (stderr, "Too many pages\n");
+	  return 1;
+	}
+      if (wtmpdb_read_page (db_path,
+			    n_seen ? seen_login[n_seen - 1] : 0,
+			    n_seen ? seen_id[n_seen - 1] : 0,
+			    PAGE, collect, NULL, &error) != 0)
+	{
+	  fprintf (stderr, "wtmpdb_read_page failed: %s\n", error ? error : "unknown");
+	  return 1;
+	}
+      if (n_seen - before > PAGE)
+	{
+	  fprintf (stderr, "Got %i entries for one page\n", n_seen - before);
+	  return 1;
+	}
+      if (n_seen - before < PAGE)
+	break;
+    }
+
+  if (n_seen != ENTRIES)
+    {
+      fprintf (stderr, "Got %i entries, expected %i\n", n_seen, ENTRIES);
+      return 1;
+    }
+
+  /* strictly descending means also no entry twice */
+  for (int i = 1; i < n_seen; i++)
+    if (seen_login[i] > seen_login[i - 1] ||
+	(seen_login[i] == seen_login[i - 1] && seen_id[i] >= seen_id[i - 1]))
+      {
+	fprintf (stderr, "Entry %i (%" PRIu64 ", %" PRId64 ") follows (%"
+		 PRIu64 ", %" PRId64 ")\n", i, seen_login[i], seen_id[i],
+		 seen_login[i - 1], seen_id[i - 1]);
+	return 1;
+      }
+
+  remove (db_path);
+
+  return 0;
+}
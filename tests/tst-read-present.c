@@ -0,0 +1,138 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Test case:
+   Create sessions around a time and two boots and check that
+   wtmpdb_read_present returns only the entries active at that time:
+   closed sessions spanning it and open sessions without a boot in
+   between.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "wtmpdb.h"
+
+#define MAX_SEEN 10
+
+static int64_t seen[MAX_SEEN];
+static int n_seen = 0;
+
+static int
+collect (void *unused __attribute__((__unused__)),
+	 int argc, char **argv, char **azColName __attribute__((__unused__)))
+{
+  if (argc != 8 || n_seen >= MAX_SEEN)
+    return 1;
+
+  seen[n_seen++] = strtoll (argv[0], NULL, 10);
+  return 0;
+}
+
+static int64_t
+login (const char *db_path, int type, uint64_t login_t, uint64_t logout_t)
+{
+  char *error = NULL;
+  int64_t id;
+
+  id = wtmpdb_login (db_path, type, type == BOOT_TIME ? "reboot" : "user",
+		     login_t * USEC_PER_SEC, "pts/1", NULL, "test", &error);
+  if (id < 0)
+    {
+      fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+      exit (1);
+    }
+  if (logout_t &&
+      wtmpdb_logout (db_path, id, logout_t * USEC_PER_SEC, &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_logout failed: %s\n", error ? error : "unknown");
+      exit (1);
+    }
+  return id;
+}
+
+static int
+check (const char *db_path, uint64_t at, const int64_t *expected, int n)
+{
+  char *error = NULL;
+
+  n_seen = 0;
+  if (wtmpdb_read_present (db_path, at * USEC_PER_SEC, collect, NULL, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_read_present failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+
+  if (n_seen != n)
+    {
+      fprintf (stderr, "At %" PRIu64 ": got %i entries, expected %i\n",
+	       at, n_seen, n);
+      return 1;
+    }
+  for (int i = 0; i < n; i++)
+    if (seen[i] != expected[i])
+      {
+	fprintf (stderr, "At %" PRIu64 ": entry %i has ID %" PRId64
+		 ", expected %" PRId64 "\n", at, i, seen[i], expected[i]);
+	return 1;
+      }
+  return 0;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-read-present.db";
+
+  remove (db_path);
+
+  /* crashed with the first boot */
+  login (db_path, USER_PROCESS, 90, 0);
+  int64_t boot1 = login (db_path, BOOT_TIME, 100, 0);
+  int64_t spanning = login (db_path, USER_PROCESS, 110, 200);
+  login (db_path, USER_PROCESS, 120, 140);
+  int64_t open = login (db_path, USER_PROCESS, 130, 0);
+  login (db_path, USER_PROCESS, 160, 0);
+  int64_t boot2 = login (db_path, BOOT_TIME, 300, 0);
+
+  const int64_t at_150[] = { open, spanning, boot1 };
+  if (check (db_path, 150, at_150, 3) != 0)
+    return 1;
+
+  const int64_t at_350[] = { boot2 };
+  if (check (db_path, 350, at_350, 1) != 0)
+    return 1;
+
+  if (check (db_path, 50, NULL, 0) != 0)
+    return 1;
+
+  remove (db_path);
+
+  return 0;
+}
@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2023, 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Test case:
+   Create some entries and check that wtmpdb_read_since_id returns
+   only the newer ones in the order of their ID, and wtmpdb_read_id
+   only the requested one.
+*/
+
+#include <inttypes.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "wtmpdb.h"
+
+#define ENTRIES 5
+
+static int64_t seen[ENTRIES];
+static int n_seen = 0;
+
+static int
+collect (void *unused __attribute__((__unused__)),
+	 int argc, char **argv, char **azColName __attribute__((__unused__)))
+{
+  if (argc != 8 || n_seen >= ENTRIES)
+    return 1;
+
+  seen[n_seen++] = strtoll (argv[0], NULL, 10);
+  return 0;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-read-since-id.db";
+  char *error = NULL;
+  int64_t ids[ENTRIES];
+  struct timespec ts;
+
+  remove (db_path);
+
+  clock_gettime (CLOCK_REALTIME, &ts);
+  for (int i = 0; i < ENTRIES; i++)
+    {
+      /* newest login first, ID order differs from login order */
+      ids[i] = wtmpdb_login (db_path, USER_PROCESS, "user",
+			     wtmpdb_timespec2usec (ts) - i * USEC_PER_SEC,
+			     "pts/1", NULL, "test", &error);
+      if (ids[i] < 0)
+	{
+	  fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+	  return 1;
+	}
+    }
+
+  if (wtmpdb_read_since_id (db_path, ids[1], collect, NULL, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_read_since_id failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+
+  if (n_seen != ENTRIES - 2)
+    {
+      fprintf (stderr, "Got %i entries, expected %i\n", n_seen, ENTRIES - 2);
+      return 1;
+    }
+
+  for (int i = 0; i < n_seen; i++)
+    if (seen[i] != ids[i + 2])
+      {
+	fprintf (stderr, "Entry %i has ID %" PRId64 ", expected %" PRId64 "\n",
+		 i, seen[i], ids[i + 2]);
+	return 1;
+      }
+
+  n_seen = 0;
+  if (wtmpdb_read_id (db_path, ids[2], collect, NULL, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_read_id failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+
+  if (n_seen != 1 || seen[0] != ids[2])
+    {
+      fprintf (stderr, "wtmpdb_read_id returned %i entries, expected ID %" PRId64 "\n",
+	       n_seen, ids[2]);
+      return 1;
+    }
+
+  n_seen = 0;
+  if (wtmpdb_read_id (db_path, ids[ENTRIES - 1] + 1, collect, NULL, &error) != 0 ||
+      n_seen != 0)
+    {
+      fprintf (stderr, "wtmpdb_read_id of an unknown ID failed\n");
+      return 1;
+    }
+
+  remove (db_path);
+
+  return 0;
+}
@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2023, 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+/* Test case:
+   Create some sessions and check the aggregation by user of
+   wtmpdb_report, including the time range and the limit.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wtmpdb.h"
+
+#define MAX_SEEN 8
+
+struct row {
+  char key[32];
+  uint64_t sessions;
+  uint64_t seconds;
+  uint64_t hosts;
+};
+
+static struct row seen[MAX_SEEN];
+static int n_seen = 0;
+
+static int
+collect (void *unused __attribute__((__unused__)),
+	 int argc, char **argv, char **azColName __attribute__((__unused__)))
+{
+  if (argc != 5 || n_seen >= MAX_SEEN)
+    return 1;
+
+  snprintf (seen[n_seen].key, sizeof (seen[n_seen].key), "%s", argv[0]);
+  seen[n_seen].sessions = strtoull (argv[1], NULL, 10);
+  seen[n_seen].seconds = strtoull (argv[2], NULL, 10);
+  seen[n_seen].hosts = strtoull (argv[4], NULL, 10);
+  n_seen++;
+  return 0;
+}
+
+static void
+session (const char *db_path, const char *user, const char *host,
+	 uint64_t login, uint64_t logout)
+{
+  char *error = NULL;
+  int64_t id = wtmpdb_login (db_path, USER_PROCESS, user, login, "pts/1",
+			     host, "test", &error);
+
+  if (id < 0)
+    {
+      fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+      exit (1);
+    }
+  if (logout && wtmpdb_logout (db_path, id, logout, &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_logout failed: %s\n", error ? error : "unknown");
+      exit (1);
+    }
+}
+
+static int
+check (int i, const char *key, uint64_t sessions, uint64_t seconds,
+       uint64_t hosts)
+{
+  if (i >= n_seen || strcmp (seen[i].key, key) != 0 ||
+      seen[i].sessions != sessions || seen[i].seconds != seconds ||
+      seen[i].hosts != hosts)
+    {
+      fprintf (stderr, "Row %i: expected %s/%" PRIu64 "/%" PRIu64 "/%" PRIu64 "\n",
+	       i, key, sessions, seconds, hosts);
+      return 1;
+    }
+  return 0;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-report.db";
+  const uint64_t start = 1700000000 * USEC_PER_SEC;
+  char *error = NULL;
+
+  remove (db_path);
+
+  /* every session is rounded down to full seconds, like last does */
+  session (db_path, "alice", "host1", start, start + 10 * USEC_PER_SEC + 900000);
+  session (db_path, "alice", "host2", start + 100 * USEC_PER_SEC,
+	   start + 105 * USEC_PER_SEC + 900000);
+  session (db_path, "alice", "host2", start + 200 * USEC_PER_SEC, 0);
+  session (db_path, "bob", NULL, start + 300 * USEC_PER_SEC,
+	   start + 360 * USEC_PER_SEC);
+
+  if (wtmpdb_report (db_path, WTMPDB_REPORT_USER, 0, 0, 0,
+		     collect, NULL, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_report failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+  if (n_seen != 2 ||
+      check (0, "alice", 3, 15, 2) ||
+      check (1, "bob", 1, 60, 0))
+    return 1;
+
+  /* only the top group */
+  n_seen = 0;
+  if (wtmpdb_report (db_path, WTMPDB_REPORT_HOST, 0, 0, 1,
+		     collect, NULL, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_report failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+  if (n_seen != 1 || check (0, "host2", 2, 5, 1))
+    return 1;
+
+  /* time range */
+  n_seen = 0;
+  if (wtmpdb_report (db_path, WTMPDB_REPORT_USER,
+		     start + 100 * USEC_PER_SEC, start + 300 * USEC_PER_SEC, 0,
+		     collect, NULL, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_report failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+  if (n_seen != 2 ||
+      check (0, "alice", 2, 5, 1) ||
+      check (1, "bob", 1, 60, 0))
+    return 1;
+
+  remove (db_path);
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2026 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Test case:
+   Read with a reused read-only connection and check that it sees
+   new entries, does not block writers, also if a read was aborted,
+   and follows a replaced database file.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "wtmpdb.h"
+
+static int n_seen;
+static int max_seen;
+
+static int
+count_cb (void *unused __attribute__((__unused__)),
+	  int argc __attribute__((__unused__)),
+	  char **argv __attribute__((__unused__)),
+	  char **azColName __attribute__((__unused__)))
+{
+  n_seen++;
+  return max_seen && n_seen >= max_seen;
+}
+
+static int
+add (const char *db_path, int i)
+{
+  char *error = NULL;
+  int64_t id;
+
+  id = wtmpdb_login (db_path, USER_PROCESS, "user", (1000 + i) * USEC_PER_SEC,
+		     "pts/1", NULL, "test", &error);
+  if (id < 0 || wtmpdb_logout (db_path, id, (2000 + i) * USEC_PER_SEC,
+			       &error) < 0)
+    {
+      fprintf (stderr, "writing entry %i failed: %s\n", i,
+	       error ? error : "unknown");
+      free (error);
+      return 1;
+    }
+  return 0;
+}
+
+static int
+check (const char *db_path, int expected)
+{
+  char *error = NULL;
+
+  n_seen = 0;
+  max_seen = 0;
+  if (wtmpdb_read_all_v2 (db_path, count_cb, NULL, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_read_all_v2 failed: %s\n",
+	       error ? error : "unknown");
+      free (error);
+      return 1;
+    }
+  if (n_seen != expected)
+    {
+      fprintf (stderr, "got %i entries, expected %i\n", n_seen, expected);
+      return 1;
+    }
+  return 0;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-reuse-connection.db";
+  char *error = NULL;
+
+  remove (db_path);
+
+  /* short, so that a blocked writer fails instead of waiting */
+  wtmpdb_set_timeout (100 * 1000);
+  wtmpdb_reuse_connection (1);
+
+  for (int i = 0; i < 10; i++)
+    if (add (db_path, i) != 0 || check (db_path, i + 1) != 0)
+      return 1;
+
+  /* an aborted read must not keep the database locked */
+  n_seen = 0;
+  max_seen = 3;
+  wtmpdb_read_all_v2 (db_path, count_cb, NULL, &error);
+  free (error);
+  error = NULL;
+  if (add (db_path, 10) != 0 || check (db_path, 11) != 0)
+    return 1;
+
+  if (wtmpdb_get_id (db_path, "pts/1", &error) >= 0 ||
+      wtmpdb_get_boottime (db_path, &error) != 0)
+    {
+      /* all sessions are closed and there is no boot entry */
+      fprintf (stderr, "unexpected open session or boot entry\n");
+      return 1;
+    }
+  free (error);
+  error = NULL;
+
+  /* a new file with the same name */
+  remove (db_path);
+  if (add (db_path, 0) != 0 || check (db_path, 1) != 0)
+    return 1;
+
+  wtmpdb_reuse_connection (0);
+  if (check (db_path, 1) != 0)
+    return 1;
+
+  remove (db_path);
+
+  return 0;
+}
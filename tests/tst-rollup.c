@@ -0,0 +1,238 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+/* Test case:
+   Create sessions before and after enabling the daily rollup, check
+   that wtmpdb_report gets the same numbers from the rollup, that the
+   time zone of the writer does not matter and that after a rotation
+   the reports from the rollup match the ones from the remaining
+   sessions.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wtmpdb.h"
+
+#define MAX_SEEN 8
+#define DAY (86400 * USEC_PER_SEC)
+
+struct row {
+  char key[32];
+  uint64_t sessions;
+  uint64_t seconds;
+  uint64_t users;
+  uint64_t hosts;
+};
+
+static struct row seen[MAX_SEEN];
+static int n_seen = 0;
+
+static int
+collect (void *unused __attribute__((__unused__)),
+	 int argc, char **argv, char **azColName __attribute__((__unused__)))
+{
+  if (argc != 5 || n_seen >= MAX_SEEN)
+    return 1;
+
+  snprintf (seen[n_seen].key, sizeof (seen[n_seen].key), "%s", argv[0]);
+  seen[n_seen].sessions = strtoull (argv[1], NULL, 10);
+  seen[n_seen].seconds = strtoull (argv[2], NULL, 10);
+  seen[n_seen].users = strtoull (argv[3], NULL, 10);
+  seen[n_seen].hosts = strtoull (argv[4], NULL, 10);
+  n_seen++;
+  return 0;
+}
+
+static int64_t
+login (const char *db_path, const char *user, const char *host,
+       uint64_t usec)
+{
+  char *error = NULL;
+  int64_t id = wtmpdb_login (db_path, USER_PROCESS, user, usec, "pts/1",
+			     host, "test", &error);
+
+  if (id < 0)
+    {
+      fprintf (stderr, "wtmpdb_login failed: %s\n", error ? error : "unknown");
+      exit (1);
+    }
+  return id;
+}
+
+static void
+logout (const char *db_path, int64_t id, uint64_t usec)
+{
+  char *error = NULL;
+
+  if (wtmpdb_logout (db_path, id, usec, &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_logout failed: %s\n", error ? error : "unknown");
+      exit (1);
+    }
+}
+
+static int
+report (const char *db_path, int group_by)
+{
+  char *error = NULL;
+
+  n_seen = 0;
+  if (wtmpdb_report (db_path, group_by, 0, 0, 0, collect, NULL, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_report failed: %s\n", error ? error : "unknown");
+      free (error);
+      return 1;
+    }
+  return 0;
+}
+
+static int
+check (int i, const char *key, uint64_t sessions, uint64_t seconds,
+       uint64_t users, uint64_t hosts)
+{
+  if (i >= n_seen || strcmp (seen[i].key, key) != 0 ||
+      seen[i].sessions != sessions || seen[i].seconds != seconds ||
+      seen[i].users != users || seen[i].hosts != hosts)
+    {
+      fprintf (stderr, "Row %i: expected %s/%" PRIu64 "/%" PRIu64 "/%"
+	       PRIu64 "/%" PRIu64 "\n", i, key, sessions, seconds, users, hosts);
+      return 1;
+    }
+  return 0;
+}
+
+static int
+check_all (const char *db_path)
+{
+  if (report (db_path, WTMPDB_REPORT_USER) != 0 || n_seen != 3 ||
+      check (0, "alice", 3, 35, 1, 2) ||
+      check (1, "bob", 1, 30, 1, 0) ||
+      check (2, "dave", 1, 60, 1, 1))
+    return 1;
+  if (report (db_path, WTMPDB_REPORT_SERVICE) != 0 || n_seen != 1 ||
+      check (0, "test", 5, 125, 3, 3))
+    return 1;
+  if (report (db_path, WTMPDB_REPORT_DAY) != 0 || n_seen != 2 ||
+      check (0, "2023-11-15", 3, 75, 2, 3) ||
+      check (1, "2023-11-16", 2, 50, 2, 1))
+    return 1;
+  return 0;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-rollup.db";
+  /* 2023-11-15 00:00:00 UTC */
+  const uint64_t start = 1700006400 * USEC_PER_SEC;
+  char *error = NULL;
+  char *backup = NULL;
+  int64_t id;
+
+  /* the rollup counts UTC days, the report by day local ones */
+  setenv ("TZ", "UTC", 1);
+  tzset ();
+
+  remove (db_path);
+
+  id = login (db_path, "alice", "host1", start + 100 * USEC_PER_SEC);
+  logout (db_path, id, start + 110 * USEC_PER_SEC);
+  /* still open while the rollup gets created */
+  int64_t open_id = login (db_path, "dave", "host3", start + 200 * USEC_PER_SEC);
+
+  if (wtmpdb_rollup (db_path, 1, &error) != 0 ||
+      wtmpdb_rollup (db_path, 1, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_rollup failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+
+  /* maintained by the triggers */
+  logout (db_path, open_id, start + 260 * USEC_PER_SEC + 500000);
+  /* still 2023-11-14 in local time of this writer */
+  setenv ("TZ", "EST5", 1);
+  tzset ();
+  id = login (db_path, "alice", "host2", start + 300 * USEC_PER_SEC);
+  logout (db_path, id, start + 305 * USEC_PER_SEC);
+  setenv ("TZ", "UTC", 1);
+  tzset ();
+  id = login (db_path, "alice", "host1", start + DAY + 100 * USEC_PER_SEC);
+  logout (db_path, id, start + DAY + 120 * USEC_PER_SEC);
+  id = login (db_path, "bob", NULL, start + DAY + 200 * USEC_PER_SEC);
+  logout (db_path, id, start + DAY + 230 * USEC_PER_SEC);
+
+  if (check_all (db_path) != 0)
+    return 1;
+
+  /* all sessions but this one are older than one day */
+  struct timespec ts;
+  clock_gettime (CLOCK_REALTIME, &ts);
+  id = login (db_path, "erin", "host4", wtmpdb_timespec2usec (ts));
+  logout (db_path, id, wtmpdb_timespec2usec (ts) + 7 * USEC_PER_SEC);
+
+  if (wtmpdb_rotate (db_path, 1, &error, &backup, NULL) != 0)
+    {
+      fprintf (stderr, "wtmpdb_rotate failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+  /* user and service come from the rollup, host from wtmp */
+  if (report (db_path, WTMPDB_REPORT_USER) != 0 || n_seen != 1 ||
+      check (0, "erin", 1, 7, 1, 1) ||
+      report (db_path, WTMPDB_REPORT_SERVICE) != 0 || n_seen != 1 ||
+      check (0, "test", 1, 7, 1, 1) ||
+      report (db_path, WTMPDB_REPORT_HOST) != 0 || n_seen != 1 ||
+      check (0, "host4", 1, 7, 1, 1))
+    {
+      fprintf (stderr, "Rollup includes rotated sessions\n");
+      return 1;
+    }
+
+  /* the same without rollup */
+  if (wtmpdb_rollup (db_path, 0, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_rollup failed: %s\n", error ? error : "unknown");
+      return 1;
+    }
+  if (report (db_path, WTMPDB_REPORT_USER) != 0 || n_seen != 1 ||
+      check (0, "erin", 1, 7, 1, 1))
+    {
+      fprintf (stderr, "Report without rollup differs\n");
+      return 1;
+    }
+
+  if (backup)
+    {
+      remove (backup);
+      free (backup);
+    }
+  remove (db_path);
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+
+  Copyright (c) 2023, 2025 Thorsten Kukuk <kukuk@suse.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Test case:
+   Create more entries than fit into one rotate batch, rotate them
+   and check the reported progress, and that the archive contains
+   every entry once, with its logout time.
+*/
+
+#include <inttypes.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include "basics.h"
+
+#include "wtmpdb.h"
+
+#define ENTRIES 2100
+
+static uint64_t last_moved = 0;
+static uint64_t last_total = 0;
+static int calls = 0;
+
+static int
+progress (void *userdata, uint64_t moved, uint64_t total)
+{
+  int *abort_at = userdata;
+
+  if (moved < last_moved)
+    {
+      fprintf (stderr, "progress went backwards: %" PRIu64 " < %" PRIu64 "\n",
+	       moved, last_moved);
+      return 1;
+    }
+  last_moved = moved;
+  last_total = total;
+  calls++;
+
+  if (abort_at && calls == *abort_at)
+    return 1;
+
+  return 0;
+}
+
+static int counter = 0;
+static int closed = 0;
+
+static int
+count_entry (void *unused __attribute__((__unused__)),
+	     int argc, char **argv, char **azColName)
+{
+  (void)azColName;
+  counter++;
+  if (argc == 8 && argv[4] != NULL)
+    closed++;
+  return 0;
+}
+
+int
+main(void)
+{
+  const char *db_path = "tst-rotate.db";
+  _cleanup_(freep) char *backup = NULL;
+  char *error = NULL;
+  uint64_t entries = 0;
+  struct timespec ts;
+
+  remove (db_path);
+
+  clock_gettime (CLOCK_REALTIME, &ts);
+  ts.tv_sec -= 86400 * 10;
+
+  for (int i = 0; i < ENTRIES; i++)
+    {
+      int64_t id;
+
+      ts.tv_sec++;
+      id = wtmpdb_login (db_path, USER_PROCESS, "user", wtmpdb_timespec2usec (ts),
+			 "tty1", NULL, NULL, &error);
+      if (id < 0 ||
+	  (i % 2 == 0 && wtmpdb_logout (db_path, id, wtmpdb_timespec2usec (ts) + 1,
+					&error) < 0))
+	{
+	  fprintf (stderr, "wtmpdb_login/logout failed: %s\n", error);
+	  free (error);
+	  return 1;
+	}
+    }
+  /* one recent entry, which should stay */
+  clock_gettime (CLOCK_REALTIME, &ts);
+  if (wtmpdb_login (db_path, USER_PROCESS, "user", wtmpdb_timespec2usec (ts),
+		    "tty1", NULL, NULL, &error) < 0)
+    {
+      fprintf (stderr, "wtmpdb_login failed: %s\n", error);
+      free (error);
+      return 1;
+    }
+
+  /* abort after the first batch */
+  int abort_at = 2;
+  if (wtmpdb_rotate_v2 (db_path, 5, progress, &abort_at, &error,
+			&backup, &entries) >= 0)
+    {
+      fprintf (stderr, "wtmpdb_rotate_v2 was not aborted\n");
+      return 1;
+    }
+  error = mfree (error);
+
+  if (wtmpdb_read_all (db_path, count_entry, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_read_all failed: %s\n", error);
+      free (error);
+      return 1;
+    }
+  if (counter != ENTRIES + 1 - (int)entries)
+    {
+      fprintf (stderr, "After abort: %d entries left, %" PRIu64 " moved\n",
+	       counter, entries);
+      return 1;
+    }
+
+  last_moved = 0;
+  calls = 0;
+  uint64_t moved_before = entries;
+  backup = mfree (backup);
+  if (wtmpdb_rotate_v2 (db_path, 5, progress, NULL, &error,
+			&backup, &entries) != 0)
+    {
+      fprintf (stderr, "wtmpdb_rotate_v2 failed: %s\n", error);
+      free (error);
+      return 1;
+    }
+
+  if (moved_before + entries != ENTRIES || last_moved != entries ||
+      last_total != entries || calls < 3)
+    {
+      fprintf (stderr, "Unexpected progress: moved %" PRIu64 "+%" PRIu64
+	       ", reported %" PRIu64 "/%" PRIu64 " in %d calls\n",
+	       moved_before, entries, last_moved, last_total, calls);
+      return 1;
+    }
+
+  counter = 0;
+  if (wtmpdb_read_all (db_path, count_entry, &error) != 0)
+    {
+      fprintf (stderr, "wtmpdb_read_all failed: %s\n", error);
+      free (error);
+      return 1;
+    }
+  if (counter != 1)
+    {
+      fprintf (stderr, "%d entries left, expected 1\n", counter);
+      return 1;
+    }
+
+  counter = closed = 0;
+  if (backup == NULL ||
+      wtmpdb_read_all (backup, count_entry, &error) != 0)
+    {
+      fprintf (stderr, "reading the archive failed: %s\n", error);
+      free (error);
+      return 1;
+    }
+  if (counter != ENTRIES || closed != ENTRIES / 2)
+    {
+      fprintf (stderr, "archive has %d entries, %d closed, expected %d, %d\n",
+	       counter, closed, ENTRIES, ENTRIES / 2);
+      return 1;
+    }
+
+  if (backup)
+    remove (backup);
+  remove (db_path);
+
+  return 0;
+}